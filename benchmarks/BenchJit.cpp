@@ -0,0 +1,86 @@
+#include "BenchJit.h"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+#include "frontend/code_generator.h"
+#include "frontend/compilation_context.h"
+#include "frontend/parse/parser.h"
+#include "frontend/visitor/ApplyTypesBuilder.h"
+
+namespace {
+template <class T>
+T exitOnError(llvm::Expected<T> value) {
+  if (!value) {
+    llvm::errs() << value.takeError() << "\n";
+    std::exit(1);
+  }
+  return std::move(*value);
+}
+
+// parse, type and optimize the whole program into one bitcode module
+llvm::SmallVector<char, 0> compile(const std::string& source, bool fast_math,
+                                   frontend::OptLevel opt_level) {
+  std::filesystem::path file =
+      std::filesystem::temp_directory_path() / "bench_jit.program";
+  std::ofstream(file, std::ios::binary) << source;
+  frontend::CompilationContext compilation;
+  frontend::Program p = frontend::parseFile(compilation, file.c_str());
+  std::filesystem::remove(file);
+  frontend::ApplyTypesBuilder builder(compilation);
+  builder.apply_types(p);
+  frontend::CodeGenerator cg(compilation);
+  if (fast_math) {
+    cg.enableFastMath();
+  }
+  cg.setOptLevel(opt_level);
+  for (const auto* f : p.functions) {
+    cg.declareFunction(*f);
+  }
+  for (const auto* f : p.functions) {
+    cg.generateFunction(f);
+  }
+  cg.optimize();
+  return cg.writeBitcode();
+}
+}  // namespace
+
+BenchJit::BenchJit(const std::string& source, bool fast_math,
+                   frontend::OptLevel opt_level) {
+  llvm::SmallVector<char, 0> bitcode = compile(source, fast_math, opt_level);
+  auto target = exitOnError(llvm::orc::JITTargetMachineBuilder::detectHost());
+  target.setCodeGenOptLevel(frontend::codegenOptLevel(opt_level));
+  jit_ = exitOnError(llvm::orc::LLJITBuilder()
+                         .setJITTargetMachineBuilder(std::move(target))
+                         .create());
+  // arrays are copied with memcpy from the process
+  jit_->getMainJITDylib().addGenerator(
+      exitOnError(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          jit_->getDataLayout().getGlobalPrefix())));
+  auto context = std::make_unique<llvm::LLVMContext>();
+  auto module = exitOnError(llvm::parseBitcodeFile(
+      llvm::MemoryBufferRef(llvm::StringRef(bitcode.data(), bitcode.size()),
+                            "bench_jit"),
+      *context));
+  if (auto err = jit_->addIRModule(
+          llvm::orc::ThreadSafeModule(std::move(module), std::move(context)))) {
+    llvm::errs() << err << "\n";
+    std::exit(1);
+  }
+}
+
+uint64_t BenchJit::address(const std::string& name) {
+  return exitOnError(jit_->lookup(name)).getAddress();
+}
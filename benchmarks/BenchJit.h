@@ -0,0 +1,32 @@
+#pragma once
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "frontend/code_generator.h"
+
+/* @brief A program compiled by the frontend and loaded into an LLJIT, so
+ * benchmarks can time the code the compiler generates.
+ *
+ * Errors are printed and exit, like the compiler does.
+ */
+class BenchJit {
+ public:
+  // parses, types and optimizes source; fast_math is the -ffast-math flag,
+  // opt_level the -O level, which also picks the JIT's backend level
+  explicit BenchJit(const std::string& source, bool fast_math = false,
+                    frontend::OptLevel opt_level = frontend::OptLevel::O2);
+
+  // a function of the program, as a pointer of type Fn
+  template <class Fn>
+  Fn lookup(const std::string& name) {
+    return reinterpret_cast<Fn>(address(name));
+  }
+
+ private:
+  uint64_t address(const std::string& name);
+
+  std::unique_ptr<llvm::orc::LLJIT> jit_;
+};
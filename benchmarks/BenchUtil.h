@@ -0,0 +1,46 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct BenchResult {
+  double best_ms = 0;
+  double median_ms = 0;
+};
+
+// runs fn `iterations` times and reports the best and median wall time
+template <class Fn>
+BenchResult run_bench(int iterations, Fn&& fn) {
+  std::vector<double> samples;
+  samples.reserve(iterations);
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  return {samples.front(), samples[samples.size() / 2]};
+}
+
+inline void print_result(const std::string& name, const BenchResult& result,
+                         uint64_t bytes) {
+  double mb_per_s = (static_cast<double>(bytes) / (1024.0 * 1024.0)) /
+                    (result.best_ms / 1000.0);
+  std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+            << std::setprecision(3) << " best " << std::setw(10)
+            << result.best_ms << " ms  median " << std::setw(10)
+            << result.median_ms << " ms  " << std::setw(10) << mb_per_s
+            << " MB/s" << std::endl;
+}
+
+inline uint64_t file_size(const std::string& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  return static_cast<uint64_t>(file.tellg());
+}
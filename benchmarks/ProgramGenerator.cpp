@@ -0,0 +1,146 @@
+#include "ProgramGenerator.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace {
+const char* const kVariables[] = {"a", "b", "v0", "v1", "v2", "v3"};
+// comparisons come last, so they can be left out by picking from the front
+const char* const kOperators[] = {" + ", " - ", " * ", " & ", " < ", " == "};
+const int kArithmeticOperators = 4;
+
+class Generator {
+ public:
+  explicit Generator(const GeneratorOptions& options)
+      : options_(options), rng_(options.seed) {}
+
+  GeneratedProgram run() {
+    for (int i = 0; i < options_.structs; i++) {
+      structure(i);
+    }
+    for (int i = 0; i < options_.functions; i++) {
+      function(i);
+    }
+    return {std::move(out_), statements_};
+  }
+
+ private:
+  int pick(int n) { return std::uniform_int_distribution<int>(0, n - 1)(rng_); }
+  bool chance(double p) {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < p;
+  }
+
+  void indent(int level) { out_.append(2 * level, ' '); }
+
+  void comment(int level) {
+    if (chance(options_.comment_density)) {
+      indent(level);
+      out_ += "// generated comment { with braces } and ( parens ) inside\n";
+    }
+  }
+
+  // calls only go to functions that are already defined
+  void call(int depth) {
+    out_ += "bench_f" + std::to_string(pick(defined_functions_)) + "(";
+    expression(depth - 1);
+    out_ += ", ";
+    expression(depth - 1);
+    out_ += ")";
+  }
+
+  void operand(int depth) {
+    if (depth > 0 && defined_functions_ > 0 && chance(0.25)) {
+      call(depth);
+    } else if (chance(0.3)) {
+      out_ += std::to_string(pick(1000));
+    } else {
+      out_ += kVariables[pick(std::size(kVariables))];
+    }
+  }
+
+  void expression(int depth) {
+    // the first operand always nests, so the requested depth is reached
+    if (depth > 0 && defined_functions_ > 0) {
+      call(depth);
+    } else {
+      operand(0);
+    }
+    for (int i = 1; i < options_.expression_operands; i++) {
+      out_ += kOperators[pick(options_.comparisons ? std::size(kOperators)
+                                                   : kArithmeticOperators)];
+      operand(depth);
+    }
+  }
+
+  void statement(int level, int scope_depth) {
+    comment(level);
+    indent(level);
+    statements_++;
+    int kind = pick(10);
+    if (scope_depth > 0 && kind < 2) {
+      out_ += kind == 0 ? "if (" : "while (";
+      expression(options_.expression_depth);
+      out_ += ") {\n";
+      body(level + 1, scope_depth - 1);
+      indent(level);
+      out_ += "}\n";
+      return;
+    }
+    if (kind == 2 && defined_functions_ > 0) {
+      call(options_.expression_depth);
+      out_ += "\n";
+      return;
+    }
+    out_ += "v" + std::to_string(pick(4)) + " = ";
+    expression(options_.expression_depth);
+    out_ += "\n";
+  }
+
+  void body(int level, int scope_depth) {
+    for (int i = 0; i < options_.statements; i++) {
+      statement(level, scope_depth);
+    }
+  }
+
+  void function(int index) {
+    out_ += "int64 bench_f" + std::to_string(index) + "(int64 a, int64 b){\n";
+    indent(1);
+    out_ += "int64 v0, v1, v2, v3\n";
+    statements_++;
+    if (options_.structs > 0) {
+      indent(1);
+      out_ += "bench_s" + std::to_string(pick(options_.structs)) + " s\n";
+      statements_++;
+    }
+    body(1, options_.scope_depth);
+    comment(1);
+    indent(1);
+    out_ += "return ";
+    expression(options_.expression_depth);
+    out_ += "\n}\n\n";
+    statements_++;
+    defined_functions_++;
+  }
+
+  void structure(int index) {
+    out_ += "struct bench_s" + std::to_string(index) + " {\n";
+    for (int i = 0; i < 4; i++) {
+      comment(1);
+      indent(1);
+      out_ += "int64 m" + std::to_string(i) + "\n";
+    }
+    out_ += "}\n\n";
+  }
+
+  const GeneratorOptions& options_;
+  std::mt19937_64 rng_;
+  std::string out_;
+  uint64_t statements_ = 0;
+  int defined_functions_ = 0;
+};
+}  // namespace
+
+GeneratedProgram generate_program(const GeneratorOptions& options) {
+  return Generator(options).run();
+}
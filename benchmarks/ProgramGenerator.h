@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Shape of a synthetic .program source. Every knob scales one thing the
+// grammar has to work through, so a regression in one rule shows up as a
+// drop on the workloads that stress it.
+struct GeneratorOptions {
+  int functions = 100;           // function definitions
+  int statements = 20;           // statements per scope body
+  int expression_depth = 1;      // nesting of calls inside call arguments
+  int expression_operands = 4;   // operands per binary operator chain
+  int scope_depth = 1;           // nesting of if/while bodies
+  int structs = 0;               // struct definitions
+  double comment_density = 0.0;  // comment lines per statement, 0 to 1
+  bool comparisons = true;       // < and == among the binary operators
+  uint64_t seed = 1;             // same options and seed, same program
+};
+
+struct GeneratedProgram {
+  std::string source;
+  uint64_t statements = 0;  // every instruction, nested ones included
+};
+
+/* @brief Generates a program the parser accepts.
+ *
+ * Functions only call functions defined before them, so the output parses
+ * with any ParseOptions.
+ */
+GeneratedProgram generate_program(const GeneratorOptions& options);
@@ -0,0 +1,132 @@
+// Times the passes that walk a parsed AST: the typing pass, DumpAST and IR
+// generation (without the optimizer), on one large generated program. IR
+// generation is timed both straight from the AST and through the mid-level
+// IR, with lowering to it timed on its own. Parsing is not timed.
+//
+// usage: ast_bench [-n iterations] [--functions N] [--statements N]
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include "BenchUtil.h"
+#include "ProgramGenerator.h"
+#include "frontend/code_generator.h"
+#include "frontend/mir/LowerAst.h"
+#include "frontend/mir/mir.h"
+#include "frontend/parse/parser.h"
+#include "frontend/visitor/ApplyTypesBuilder.h"
+#include "frontend/visitor/DumpAST.h"
+
+namespace {
+// DumpAST output goes nowhere, so the dump is timed without terminal I/O
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = 10;
+  GeneratorOptions options;
+  options.functions = 500;
+  options.statements = 100;
+  // codegen does not widen the i1 result of comparisons and only branches on
+  // i1, so the program sticks to straight-line arithmetic
+  options.scope_depth = 0;
+  options.comparisons = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = std::atoi(argv[++i]);
+    } else if (arg == "--functions" && i + 1 < argc) {
+      options.functions = std::atoi(argv[++i]);
+    } else if (arg == "--statements" && i + 1 < argc) {
+      options.statements = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [-n iterations] [--functions N] [--statements N]\n";
+      return 1;
+    }
+  }
+  if (iterations <= 0 || options.functions <= 0) {
+    std::cerr << "iterations and functions must be positive\n";
+    return 1;
+  }
+
+  GeneratedProgram program = generate_program(options);
+  std::filesystem::path file =
+      std::filesystem::temp_directory_path() / "ast_bench.program";
+  std::ofstream(file, std::ios::binary) << program.source;
+  frontend::CompilationContext compilation;
+  frontend::Program parsed = frontend::parseFile(compilation, file.c_str());
+  frontend::Program typed_in_place =
+      frontend::parseFile(compilation, file.c_str());
+  std::filesystem::remove(file);
+
+  frontend::ApplyTypesBuilder builder(compilation);
+  frontend::Program typed = builder.build_program(parsed);
+  builder.apply_types(typed_in_place);
+  uint64_t bytes = program.source.size();
+  std::cout << program.statements << " statements, "
+            << typed.functions.size() << " functions" << std::endl;
+
+  print_result("  typing pass", run_bench(iterations, [&] {
+                 frontend::ApplyTypesBuilder builder(compilation);
+                 builder.build_program(parsed);
+               }),
+               bytes);
+  print_result("  typing in place", run_bench(iterations, [&] {
+                 frontend::ApplyTypesBuilder builder(compilation);
+                 builder.apply_types(typed_in_place);
+               }),
+               bytes);
+
+  NullBuffer null_buffer;
+  std::ostream null_stream(&null_buffer);
+  print_result("  DumpAST", run_bench(iterations, [&] {
+                 frontend::DumpAST dump(null_stream);
+                 dump.dump_program(typed);
+               }),
+               bytes);
+
+  // a fresh module every time, the functions would already be defined
+  print_result("  IR generation", run_bench(iterations, [&] {
+                 frontend::CodeGenerator cg(compilation);
+                 for (const auto* f : typed.functions) {
+                   cg.declareFunction(*f);
+                 }
+                 for (const auto* f : typed.functions) {
+                   cg.generateFunction(f);
+                 }
+               }),
+               bytes);
+
+  print_result("  lowering to MIR", run_bench(iterations, [&] {
+                 frontend::mir::lowerProgram(typed);
+               }),
+               bytes);
+  frontend::mir::Module lowered = frontend::mir::lowerProgram(typed);
+  print_result("  IR generation from MIR", run_bench(iterations, [&] {
+                 frontend::CodeGenerator cg(compilation);
+                 for (const auto& f : lowered.functions) {
+                   cg.declareFunction(*f.source);
+                 }
+                 for (const auto& f : lowered.functions) {
+                   cg.generateFunction(f);
+                 }
+               }),
+               bytes);
+  size_t instructions = 0;
+  for (const auto& f : lowered.functions) {
+    instructions += f.size();
+  }
+  std::cout << "    " << instructions << " MIR instructions" << std::endl;
+  return 0;
+}
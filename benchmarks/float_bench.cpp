@@ -0,0 +1,181 @@
+// Times a dot product and a 3-point stencil written in the language, in
+// float32 and float64, against the same loops in C++. Each kernel is compiled
+// twice: with strict IEEE semantics the dot product has to add in order, so
+// only -ffast-math lets the vectorizer split it into partial sums. The stencil
+// has no reduction and vectorizes either way.
+//
+// usage: float_bench [-n iterations] [--elements N] [--calls N]
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BenchJit.h"
+#include "BenchUtil.h"
+
+namespace {
+// arrays are passed by pointer, a returned array last
+template <class T>
+using DotKernel = T (*)(T*, T*);
+template <class T>
+using StencilKernel = T* (*)(T*, T*);
+
+std::string kernel_source(const std::string& type, int elements) {
+  std::string n = std::to_string(elements);
+  std::string array = type + "[" + n + "]";
+  return type + " dot_" + type + "(" + array + " a, " + array +
+         " b){\n"
+         "  " + type + " s\n"
+         "  int64 i\n"
+         "  s = 0\n"
+         "  i = 0\n"
+         "  while(i < " + n + "){\n"
+         "    s = s + a[i] * b[i]\n"
+         "    i = i + 1\n"
+         "  }\n"
+         "  return s\n"
+         "}\n\n" +
+         array + " stencil_" + type + "(" + array +
+         " a){\n"
+         "  " + array + " out\n"
+         "  int64 i\n"
+         "  i = 1\n"
+         "  while(i < " + std::to_string(elements - 1) + "){\n"
+         "    out[i] = 0.25 * a[i - 1] + 0.5 * a[i] + 0.25 * a[i + 1]\n"
+         "    i = i + 1\n"
+         "  }\n"
+         "  return out\n"
+         "}\n\n";
+}
+
+template <class T>
+__attribute__((noinline)) T reference_dot(const T* a, const T* b, int n) {
+  T s = 0;
+  for (int i = 0; i < n; i++) {
+    s = s + a[i] * b[i];
+  }
+  return s;
+}
+
+template <class T>
+__attribute__((noinline)) void reference_stencil(const T* a, T* out, int n) {
+  for (int i = 1; i < n - 1; i++) {
+    out[i] = T(0.25) * a[i - 1] + T(0.5) * a[i] + T(0.25) * a[i + 1];
+  }
+}
+
+void print_elements(const std::string& name, const BenchResult& result,
+                    uint64_t elements) {
+  std::cout << "  " << std::left << std::setw(26) << name << std::right
+            << std::fixed << std::setprecision(3) << " best " << std::setw(10)
+            << result.best_ms << " ms  median " << std::setw(10)
+            << result.median_ms << " ms  " << std::setw(10)
+            << static_cast<double>(elements) / 1e6 / (result.best_ms / 1000.0)
+            << " Melem/s" << std::endl;
+}
+
+template <class T>
+void run_type(BenchJit& strict, BenchJit& fast, const std::string& type,
+              int elements, int iterations, int calls) {
+  // small integers and halves, so every sum is exact in any order and all
+  // three agree bit for bit
+  std::vector<T> a(elements), b(elements), out(elements), expected(elements);
+  for (int i = 0; i < elements; i++) {
+    a[i] = static_cast<T>(i % 7);
+    b[i] = static_cast<T>(i % 5) * T(0.5);
+  }
+  uint64_t total = static_cast<uint64_t>(elements) * calls;
+  // keeps the dot products from being thrown away
+  volatile T sink = 0;
+
+  T dot = reference_dot(a.data(), b.data(), elements);
+  print_elements("dot_" + type + " C++", run_bench(iterations, [&] {
+                   for (int i = 0; i < calls; i++) {
+                     sink = reference_dot(a.data(), b.data(), elements);
+                   }
+                 }),
+                 total);
+  for (BenchJit* jit : {&strict, &fast}) {
+    auto kernel = jit->lookup<DotKernel<T>>("dot_" + type);
+    std::string name =
+        "dot_" + type + (jit == &fast ? " fast-math" : " strict");
+    if (kernel(a.data(), b.data()) != dot) {
+      std::cerr << name << " is wrong\n";
+      std::exit(1);
+    }
+    print_elements(name, run_bench(iterations, [&] {
+                     for (int i = 0; i < calls; i++) {
+                       sink = kernel(a.data(), b.data());
+                     }
+                   }),
+                   total);
+  }
+
+  reference_stencil(a.data(), expected.data(), elements);
+  print_elements("stencil_" + type + " C++", run_bench(iterations, [&] {
+                   for (int i = 0; i < calls; i++) {
+                     reference_stencil(a.data(), out.data(), elements);
+                   }
+                 }),
+                 total);
+  for (BenchJit* jit : {&strict, &fast}) {
+    auto kernel = jit->lookup<StencilKernel<T>>("stencil_" + type);
+    std::string name =
+        "stencil_" + type + (jit == &fast ? " fast-math" : " strict");
+    kernel(a.data(), out.data());
+    for (int i = 1; i < elements - 1; i++) {
+      if (out[i] != expected[i]) {
+        std::cerr << name << " is wrong at element " << i << "\n";
+        std::exit(1);
+      }
+    }
+    print_elements(name, run_bench(iterations, [&] {
+                     for (int i = 0; i < calls; i++) {
+                       kernel(a.data(), out.data());
+                     }
+                   }),
+                   total);
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = 10;
+  // the arrays are copied onto the stack, so they are kept well under its
+  // size limit
+  int elements = 4096;
+  int calls = 1000;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = std::atoi(argv[++i]);
+    } else if (arg == "--elements" && i + 1 < argc) {
+      elements = std::atoi(argv[++i]);
+    } else if (arg == "--calls" && i + 1 < argc) {
+      calls = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [-n iterations] [--elements N] [--calls N]\n";
+      return 1;
+    }
+  }
+  if (iterations <= 0 || elements < 3 || calls <= 0) {
+    std::cerr << "iterations and calls must be positive, elements at least "
+                 "3\n";
+    return 1;
+  }
+
+  std::string source =
+      kernel_source("float32", elements) + kernel_source("float64", elements);
+  BenchJit strict(source);
+  BenchJit fast(source, /*fast_math=*/true);
+
+  std::cout << elements << " elements, " << calls << " calls per sample"
+            << std::endl;
+  run_type<float>(strict, fast, "float32", elements, iterations, calls);
+  run_type<double>(strict, fast, "float64", elements, iterations, calls);
+  return 0;
+}
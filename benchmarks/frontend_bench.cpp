@@ -0,0 +1,101 @@
+// Compares the parser front ends: the grammar running over the raw source
+// characters, over the lexer's normalized token stream, with memoized
+// rules and split across threads. Also reports how many grammar rules and
+// heap allocations each one needs per parse.
+//
+// usage: frontend_bench [-n iterations] file.program...
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "frontend/parse/parser.h"
+#include "frontend/symbol/Symbol.h"
+
+// every heap allocation made by the process, so the parsers can be compared
+// by how much they allocate and not only by time
+static std::atomic<uint64_t> allocations = 0;
+
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+int main(int argc, char** argv) {
+  int iterations = 10;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = std::atoi(argv[++i]);
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (files.empty() || iterations <= 0) {
+    std::cerr << "usage: " << argv[0] << " [-n iterations] file.program...\n";
+    return 1;
+  }
+
+  for (const auto& file : files) {
+    uint64_t bytes = file_size(file);
+    std::cout << file << " (" << bytes << " bytes)" << std::endl;
+
+    struct Config {
+      const char* name;
+      frontend::ParseOptions options;
+    };
+    std::vector<Config> configs(5);
+    configs[0].name = "  characters";
+    configs[1].name = "  lexer + tokens";
+    configs[1].options.use_lexer = true;
+    configs[2].name = "  memoized";
+    configs[2].options.memoize = true;
+    configs[3].name = "  lexer + memoized";
+    configs[3].options.use_lexer = true;
+    configs[3].options.memoize = true;
+    configs[4].name = "  parallel";
+    configs[4].options.num_threads =
+        std::max(2u, std::thread::hardware_concurrency());
+
+    for (const Config& config : configs) {
+      frontend::ParseStats stats;
+      uint64_t allocations_before = allocations;
+      {
+        frontend::CompilationContext compilation;
+        frontend::parseFile(compilation, file.c_str(), config.options, &stats);
+      }
+      uint64_t parse_allocations = allocations - allocations_before;
+      print_result(config.name, run_bench(iterations, [&] {
+                     frontend::CompilationContext compilation;
+                     frontend::parseFile(compilation, file.c_str(),
+                                         config.options);
+                   }),
+                   bytes);
+      std::cout << "    rule invocations " << stats.rule_invocations
+                << ", memo hits " << stats.memo_hits << ", allocations "
+                << parse_allocations << std::endl;
+    }
+    std::cout << "  interned symbols " << frontend::Symbol::tableSize()
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Times the same element-wise array addition compiled for every integer
+// width, run through the JIT. The loop is identical for all of them, so the
+// difference is how many elements fit in a vector register and how many
+// bytes go through memory: a uint8 kernel adds 16 elements per 128-bit
+// register where the int64 one adds 2.
+//
+// usage: int_width_bench [-n iterations] [--elements N] [--calls N]
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BenchJit.h"
+#include "BenchUtil.h"
+
+namespace {
+// an array argument and the returned array are passed by pointer, the
+// returned one last
+template <class T>
+using Kernel = T* (*)(T*, T*, T*);
+
+// a = a + b over the whole array, for one element type
+std::string kernel_source(const std::string& type, int elements) {
+  std::string array = type + "[" + std::to_string(elements) + "]";
+  return array + " add_" + type + "(" + array + " a, " + array +
+         " b){\n"
+         "  int64 i\n"
+         "  i = 0\n"
+         "  while(i < " +
+         std::to_string(elements) +
+         "){\n"
+         "    a[i] = a[i] + b[i]\n"
+         "    i = i + 1\n"
+         "  }\n"
+         "  return a\n"
+         "}\n\n";
+}
+
+template <class T>
+void run_kernel(BenchJit& jit, const std::string& type, int elements,
+                int iterations, int calls) {
+  auto kernel = jit.lookup<Kernel<T>>("add_" + type);
+
+  std::vector<T> a(elements), b(elements), out(elements);
+  for (int i = 0; i < elements; i++) {
+    a[i] = static_cast<T>(i);
+    b[i] = static_cast<T>(3 * i + 1);
+  }
+  kernel(a.data(), b.data(), out.data());
+  for (int i = 0; i < elements; i++) {
+    if (out[i] != static_cast<T>(a[i] + b[i])) {
+      std::cerr << "add_" << type << " is wrong at element " << i << "\n";
+      std::exit(1);
+    }
+  }
+
+  BenchResult result = run_bench(iterations, [&] {
+    for (int i = 0; i < calls; i++) {
+      kernel(a.data(), b.data(), out.data());
+    }
+  });
+  uint64_t total = static_cast<uint64_t>(elements) * calls;
+  std::cout << "  " << std::left << std::setw(26) << type << std::right
+            << std::fixed << std::setprecision(3) << " best " << std::setw(10)
+            << result.best_ms << " ms  median " << std::setw(10)
+            << result.median_ms << " ms  " << std::setw(10)
+            << static_cast<double>(total) / 1e6 / (result.best_ms / 1000.0)
+            << " Melem/s" << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = 10;
+  // the arrays are copied onto the stack, so they are kept well under its
+  // size limit
+  int elements = 16384;
+  int calls = 1000;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = std::atoi(argv[++i]);
+    } else if (arg == "--elements" && i + 1 < argc) {
+      elements = std::atoi(argv[++i]);
+    } else if (arg == "--calls" && i + 1 < argc) {
+      calls = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [-n iterations] [--elements N] [--calls N]\n";
+      return 1;
+    }
+  }
+  if (iterations <= 0 || elements <= 0 || calls <= 0) {
+    std::cerr << "iterations, elements and calls must be positive\n";
+    return 1;
+  }
+
+  const std::vector<std::string> types = {"uint8", "int16", "int32", "int64"};
+  std::string source;
+  for (const auto& type : types) {
+    source += kernel_source(type, elements);
+  }
+  BenchJit jit(source);
+
+  std::cout << elements << " elements, " << calls << " calls per sample"
+            << std::endl;
+  run_kernel<uint8_t>(jit, "uint8", elements, iterations, calls);
+  run_kernel<int16_t>(jit, "int16", elements, iterations, calls);
+  run_kernel<int32_t>(jit, "int32", elements, iterations, calls);
+  run_kernel<int64_t>(jit, "int64", elements, iterations, calls);
+  return 0;
+}
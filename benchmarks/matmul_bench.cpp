@@ -0,0 +1,203 @@
+// Times float64 matrix multiplication written in the language against the
+// same loops in C++. The matrices are float64[N][N], one row-major block each,
+// and every a[i][j] is a single getelementptr, so LLVM sees the same accesses
+// as for a C array of arrays. matmul_ijk keeps a dot product in the inner loop,
+// an ordered reduction that strict IEEE semantics leave scalar. matmul_ikj
+// walks rows of b and c in the inner loop, which vectorizes. matmul_flat is
+// matmul_ikj on float64[N*N] arrays indexed by hand, for comparison.
+//
+// usage: matmul_bench [-n iterations] [--size N] [--calls N]
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BenchJit.h"
+#include "BenchUtil.h"
+
+namespace {
+// arrays are passed by pointer, the returned array last
+using MatmulKernel = double* (*)(double*, double*, double*);
+
+std::string kernel_source(int size) {
+  std::string n = std::to_string(size);
+  std::string matrix = "float64[" + n + "][" + n + "]";
+  std::string flat = "float64[" + std::to_string(size * size) + "]";
+  return matrix + " matmul_ijk(" + matrix + " a, " + matrix +
+         " b){\n"
+         "  " + matrix + " c\n"
+         "  int64 i\n"
+         "  int64 j\n"
+         "  int64 k\n"
+         "  float64 s\n"
+         "  i = 0\n"
+         "  while(i < " + n + "){\n"
+         "    j = 0\n"
+         "    while(j < " + n + "){\n"
+         "      s = 0\n"
+         "      k = 0\n"
+         "      while(k < " + n + "){\n"
+         "        s = s + a[i][k] * b[k][j]\n"
+         "        k = k + 1\n"
+         "      }\n"
+         "      c[i][j] = s\n"
+         "      j = j + 1\n"
+         "    }\n"
+         "    i = i + 1\n"
+         "  }\n"
+         "  return c\n"
+         "}\n\n" +
+         matrix + " matmul_ikj(" + matrix + " a, " + matrix +
+         " b){\n"
+         "  " + matrix + " c\n"
+         "  int64 i\n"
+         "  int64 j\n"
+         "  int64 k\n"
+         "  float64 r\n"
+         "  i = 0\n"
+         "  while(i < " + n + "){\n"
+         "    j = 0\n"
+         "    while(j < " + n + "){\n"
+         "      c[i][j] = 0\n"
+         "      j = j + 1\n"
+         "    }\n"
+         "    k = 0\n"
+         "    while(k < " + n + "){\n"
+         "      r = a[i][k]\n"
+         "      j = 0\n"
+         "      while(j < " + n + "){\n"
+         "        c[i][j] = c[i][j] + r * b[k][j]\n"
+         "        j = j + 1\n"
+         "      }\n"
+         "      k = k + 1\n"
+         "    }\n"
+         "    i = i + 1\n"
+         "  }\n"
+         "  return c\n"
+         "}\n\n" +
+         flat + " matmul_flat(" + flat + " a, " + flat +
+         " b){\n"
+         "  " + flat + " c\n"
+         "  int64 i\n"
+         "  int64 j\n"
+         "  int64 k\n"
+         "  float64 r\n"
+         "  i = 0\n"
+         "  while(i < " + n + "){\n"
+         "    j = 0\n"
+         "    while(j < " + n + "){\n"
+         "      c[i * " + n + " + j] = 0\n"
+         "      j = j + 1\n"
+         "    }\n"
+         "    k = 0\n"
+         "    while(k < " + n + "){\n"
+         "      r = a[i * " + n + " + k]\n"
+         "      j = 0\n"
+         "      while(j < " + n + "){\n"
+         "        c[i * " + n + " + j] = c[i * " + n + " + j] + r * b[k * " +
+         n + " + j]\n"
+         "        j = j + 1\n"
+         "      }\n"
+         "      k = k + 1\n"
+         "    }\n"
+         "    i = i + 1\n"
+         "  }\n"
+         "  return c\n"
+         "}\n\n";
+}
+
+__attribute__((noinline)) void reference_matmul(const double* a,
+                                                const double* b, double* c,
+                                                int n) {
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      c[i * n + j] = 0;
+    }
+    for (int k = 0; k < n; k++) {
+      double r = a[i * n + k];
+      for (int j = 0; j < n; j++) {
+        c[i * n + j] = c[i * n + j] + r * b[k * n + j];
+      }
+    }
+  }
+}
+
+void print_flops(const std::string& name, const BenchResult& result,
+                 uint64_t flops) {
+  std::cout << "  " << std::left << std::setw(16) << name << std::right
+            << std::fixed << std::setprecision(3) << " best " << std::setw(10)
+            << result.best_ms << " ms  median " << std::setw(10)
+            << result.median_ms << " ms  " << std::setw(10)
+            << static_cast<double>(flops) / 1e9 / (result.best_ms / 1000.0)
+            << " GFLOP/s" << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = 10;
+  // the matrices are copied onto the stack, so they are kept well under its
+  // size limit
+  int size = 64;
+  int calls = 100;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = std::atoi(argv[++i]);
+    } else if (arg == "--size" && i + 1 < argc) {
+      size = std::atoi(argv[++i]);
+    } else if (arg == "--calls" && i + 1 < argc) {
+      calls = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [-n iterations] [--size N] [--calls N]\n";
+      return 1;
+    }
+  }
+  if (iterations <= 0 || size <= 0 || calls <= 0) {
+    std::cerr << "iterations, size and calls must be positive\n";
+    return 1;
+  }
+
+  BenchJit jit(kernel_source(size));
+
+  // small integers, so every sum is exact in any order and all kernels agree
+  // bit for bit
+  int elements = size * size;
+  std::vector<double> a(elements), b(elements), c(elements),
+      expected(elements);
+  for (int i = 0; i < size; i++) {
+    for (int j = 0; j < size; j++) {
+      a[i * size + j] = (i + j) % 5;
+      b[i * size + j] = (i * j) % 3;
+    }
+  }
+  uint64_t flops = uint64_t{2} * size * size * size * calls;
+
+  std::cout << size << "x" << size << " float64, " << calls
+            << " calls per sample" << std::endl;
+  reference_matmul(a.data(), b.data(), expected.data(), size);
+  print_flops("C++", run_bench(iterations, [&] {
+                for (int i = 0; i < calls; i++) {
+                  reference_matmul(a.data(), b.data(), c.data(), size);
+                }
+              }),
+              flops);
+  for (const char* name : {"matmul_ijk", "matmul_ikj", "matmul_flat"}) {
+    auto kernel = jit.lookup<MatmulKernel>(name);
+    kernel(a.data(), b.data(), c.data());
+    if (c != expected) {
+      std::cerr << name << " is wrong\n";
+      return 1;
+    }
+    print_flops(name, run_bench(iterations, [&] {
+                  for (int i = 0; i < calls; i++) {
+                    kernel(a.data(), b.data(), c.data());
+                  }
+                }),
+                flops);
+  }
+  return 0;
+}
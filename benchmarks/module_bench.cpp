@@ -0,0 +1,156 @@
+// Times building a project of many files that all call into one large shared
+// module, with the module's source copied into every file and with the module
+// imported through its binary interface. Every file is built up to an object
+// file in a CompilationContext of its own, like separate compiler runs.
+//
+//   copied source     each file starts with the module's source, so every
+//                     build parses, types and generates the module again
+//   import            the module is built once and writes its interface,
+//                     then every file imports it
+//   import, files     the same without building the module
+//
+// usage: module_bench [-n iterations] [--files N] [--module-functions N]
+//                     [--calls N]
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "ProgramGenerator.h"
+#include "frontend/code_generator.h"
+#include "frontend/compilation_context.h"
+#include "frontend/module/ModuleInterface.h"
+#include "frontend/parse/parser.h"
+#include "frontend/visitor/ApplyTypesBuilder.h"
+
+namespace {
+const char* const kModuleName = "bench_module";
+
+// a few functions that each call two functions of the module
+std::string file_source(int file, int calls, int module_functions) {
+  std::string out;
+  for (int i = 0; i < calls; i++) {
+    int callee = (file * calls + i) % module_functions;
+    int other = (callee * 7 + 3) % module_functions;
+    out += "int64 bench_file" + std::to_string(file) + "_f" +
+           std::to_string(i) + "(int64 a, int64 b){\n  return bench_f" +
+           std::to_string(callee) + "(a, b) + bench_f" +
+           std::to_string(other) + "(b, a)\n}\n\n";
+  }
+  return out;
+}
+
+void write_file(const std::filesystem::path& path, const std::string& text) {
+  std::ofstream(path, std::ios::binary) << text;
+}
+
+// parse, type and generate an object file, the interface is written too when
+// interface is not empty
+void build(const std::filesystem::path& source, const std::string& object,
+           const std::string& interface = {}) {
+  frontend::CompilationContext compilation;
+  frontend::Program p = frontend::parseFile(compilation, source.c_str());
+  if (!interface.empty()) {
+    frontend::ModuleInterface::write(p, interface);
+  }
+  frontend::ApplyTypesBuilder builder(compilation);
+  builder.apply_types(p);
+  frontend::CodeGenerator cg(compilation);
+  cg.generateCode(p, object);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = 3;
+  int files = 20;
+  int calls = 4;
+  GeneratorOptions options;
+  options.functions = 200;
+  options.statements = 20;
+  // codegen does not widen the i1 result of comparisons and only branches on
+  // i1, so the module sticks to straight-line arithmetic
+  options.scope_depth = 0;
+  options.comparisons = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = std::atoi(argv[++i]);
+    } else if (arg == "--files" && i + 1 < argc) {
+      files = std::atoi(argv[++i]);
+    } else if (arg == "--module-functions" && i + 1 < argc) {
+      options.functions = std::atoi(argv[++i]);
+    } else if (arg == "--calls" && i + 1 < argc) {
+      calls = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [-n iterations] [--files N] [--module-functions N]"
+                   " [--calls N]\n";
+      return 1;
+    }
+  }
+  if (iterations <= 0 || files <= 0 || options.functions <= 0 || calls <= 0) {
+    std::cerr << "iterations, files, module functions and calls must be "
+                 "positive\n";
+    return 1;
+  }
+
+  std::filesystem::path dir =
+      std::filesystem::temp_directory_path() / "module_bench";
+  std::filesystem::create_directories(dir);
+  std::string module_source = generate_program(options).source;
+  std::filesystem::path module_file =
+      dir / (std::string(kModuleName) + ".program");
+  std::string interface =
+      (dir / (std::string(kModuleName) +
+              std::string(frontend::kModuleInterfaceExtension)))
+          .string();
+  std::string object = (dir / "out.o").string();
+  write_file(module_file, module_source);
+
+  uint64_t bytes = module_source.size();
+  std::vector<std::filesystem::path> copied_files;
+  std::vector<std::filesystem::path> importing_files;
+  for (int i = 0; i < files; i++) {
+    std::string own = file_source(i, calls, options.functions);
+    bytes += own.size();
+    copied_files.push_back(dir / ("copied" + std::to_string(i) + ".program"));
+    write_file(copied_files.back(), module_source + own);
+    importing_files.push_back(dir /
+                              ("import" + std::to_string(i) + ".program"));
+    write_file(importing_files.back(),
+               "import " + std::string(kModuleName) + "\n\n" + own);
+  }
+  build(module_file, object, interface);
+  std::cout << files << " files calling a module of " << options.functions
+            << " functions (" << module_source.size()
+            << " bytes), interface " << file_size(interface) << " bytes"
+            << std::endl;
+
+  print_result("  copied source", run_bench(iterations, [&] {
+                 for (const auto& file : copied_files) {
+                   build(file, object);
+                 }
+               }),
+               bytes);
+  print_result("  import", run_bench(iterations, [&] {
+                 build(module_file, object, interface);
+                 for (const auto& file : importing_files) {
+                   build(file, object);
+                 }
+               }),
+               bytes);
+  print_result("  import, files", run_bench(iterations, [&] {
+                 for (const auto& file : importing_files) {
+                   build(file, object);
+                 }
+               }),
+               bytes);
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,203 @@
+// Compares the -O levels on the e2e programs: how long the compiler takes for
+// each program, from parsing to the object file like the compiler driver,
+// and how fast a few of their functions run when JIT-compiled at each level.
+// The functions must return the same at every level.
+//
+// usage: opt_level_bench [-n iterations] [--calls N] tests/e2e
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BenchJit.h"
+#include "BenchUtil.h"
+#include "frontend/code_generator.h"
+#include "frontend/compilation_context.h"
+#include "frontend/parse/parser.h"
+#include "frontend/visitor/ApplyTypesBuilder.h"
+#include "frontend/visitor/ConstEvaluator.h"
+
+namespace {
+struct Level {
+  const char* name;
+  frontend::OptLevel level;
+};
+constexpr Level kLevels[] = {
+    {"O0", frontend::OptLevel::O0}, {"O1", frontend::OptLevel::O1},
+    {"O2", frontend::OptLevel::O2}, {"O3", frontend::OptLevel::O3},
+    {"Os", frontend::OptLevel::Os}, {"Oz", frontend::OptLevel::Oz}};
+
+// the e2e programs that import no modules
+constexpr const char* kPrograms[] = {
+    "test1.program",  "test2.program",      "test3.program",
+    "test4.program",  "minitests.program",  "structs.program",
+    "ints.program",   "floats.program",     "const_eval.program",
+    "matrix.program", "slices.program"};
+
+std::string read_file(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "could not read " << path << "\n";
+    std::exit(1);
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+// what the compiler does for one program at level
+void compile(const std::filesystem::path& program,
+             const std::filesystem::path& object, frontend::OptLevel level) {
+  frontend::CompilationContext compilation;
+  frontend::Program p = frontend::parseFile(compilation, program.c_str());
+  frontend::ApplyTypesBuilder builder(compilation);
+  builder.apply_types(p);
+  frontend::evaluateConstCalls(p);
+  frontend::CodeGenerator cg(compilation);
+  cg.setOptLevel(level);
+  cg.generateCode(p, object);
+}
+
+void print_header(const std::string& first_column) {
+  std::cout << "  " << std::left << std::setw(20) << first_column
+            << std::right;
+  for (const Level& level : kLevels) {
+    std::cout << std::setw(10) << level.name;
+  }
+  std::cout << std::endl;
+}
+
+// a function of an e2e program, called calls times per sample; returns what
+// the last call returned, as a number to compare across levels
+struct Kernel {
+  const char* program;
+  const char* name;
+  std::function<double(BenchJit&, int)> run;
+};
+
+std::vector<Kernel> kernels() {
+  // arrays are passed by pointer, a returned array last; a slice as its data
+  // pointer and length
+  using Fib = int64_t (*)(int64_t);
+  using MatrixMul = double* (*)(double*, double*, double*);
+  using Dot = double (*)(double*, double*);
+  using SliceSum = int64_t (*)(int64_t*, int64_t);
+  static std::vector<double> a(16), b(16), c(16);
+  static std::vector<int64_t> elements(1 << 16);
+  for (int i = 0; i < 16; i++) {
+    a[i] = i % 5;
+    b[i] = (i * 3) % 7;
+  }
+  for (size_t i = 0; i < elements.size(); i++) {
+    elements[i] = static_cast<int64_t>(i % 11);
+  }
+  return {
+      {"const_eval.program", "const_eval_runtime",
+       [](BenchJit& jit, int calls) {
+         auto fib = jit.lookup<Fib>("const_eval_runtime");
+         int64_t result = 0;
+         for (int i = 0; i < calls; i++) {
+           result = fib(20);
+         }
+         return static_cast<double>(result);
+       }},
+      {"matrix.program", "matrix_mul",
+       [](BenchJit& jit, int calls) {
+         auto mul = jit.lookup<MatrixMul>("matrix_mul");
+         for (int i = 0; i < calls; i++) {
+           mul(a.data(), b.data(), c.data());
+         }
+         return c[5];
+       }},
+      {"floats.program", "floats_dot",
+       [](BenchJit& jit, int calls) {
+         auto dot = jit.lookup<Dot>("floats_dot");
+         double result = 0;
+         for (int i = 0; i < calls; i++) {
+           result = dot(a.data(), b.data());
+         }
+         return result;
+       }},
+      {"slices.program", "slice_sum",
+       [](BenchJit& jit, int calls) {
+         auto sum = jit.lookup<SliceSum>("slice_sum");
+         int64_t result = 0;
+         for (int i = 0; i < calls; i++) {
+           result = sum(elements.data(),
+                        static_cast<int64_t>(elements.size()));
+         }
+         return static_cast<double>(result);
+       }},
+  };
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = 10;
+  int calls = 1000;
+  std::filesystem::path dir;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = std::atoi(argv[++i]);
+    } else if (arg == "--calls" && i + 1 < argc) {
+      calls = std::atoi(argv[++i]);
+    } else {
+      dir = arg;
+    }
+  }
+  if (dir.empty() || iterations <= 0 || calls <= 0) {
+    std::cerr << "usage: " << argv[0]
+              << " [-n iterations] [--calls N] tests/e2e\n";
+    return 1;
+  }
+
+  std::filesystem::path object =
+      std::filesystem::temp_directory_path() / "opt_level_bench.o";
+  std::cout << "compile time, best ms" << std::endl;
+  print_header("program");
+  for (const char* program : kPrograms) {
+    std::cout << "  " << std::left << std::setw(20) << program << std::right
+              << std::fixed << std::setprecision(3);
+    for (const Level& level : kLevels) {
+      BenchResult result = run_bench(
+          iterations, [&] { compile(dir / program, object, level.level); });
+      std::cout << std::setw(10) << result.best_ms;
+    }
+    std::cout << std::endl;
+  }
+  std::filesystem::remove(object);
+  std::filesystem::remove(object.string() + ".asm");
+
+  std::cout << "\nrun time, best ms for " << calls << " calls" << std::endl;
+  print_header("function");
+  for (const Kernel& kernel : kernels()) {
+    std::string source = read_file(dir / kernel.program);
+    std::cout << "  " << std::left << std::setw(20) << kernel.name
+              << std::right << std::fixed << std::setprecision(3);
+    double expected = 0;
+    for (const Level& level : kLevels) {
+      BenchJit jit(source, /*fast_math=*/false, level.level);
+      double result = kernel.run(jit, 1);
+      if (&level == &kLevels[0]) {
+        expected = result;
+      } else if (result != expected) {
+        std::cerr << "\n" << kernel.name << " returns " << result << " at "
+                  << level.name << " and " << expected << " at O0\n";
+        return 1;
+      }
+      BenchResult bench =
+          run_bench(iterations, [&] { kernel.run(jit, calls); });
+      std::cout << std::setw(10) << bench.best_ms;
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,145 @@
+// Parser throughput on a fixed set of generated workloads, each stressing
+// one part of the grammar. The programs are generated with fixed seeds, so
+// numbers from two builds are comparable; use the median to compare and the
+// best time as a noise floor. Also reports how much memory the AST takes and
+// how long the typing pass needs to walk it, building a typed copy and typing
+// the tree in place.
+//
+// usage: parse_bench [-n iterations] [--scale N]
+
+#include <sys/resource.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "ProgramGenerator.h"
+#include "frontend/parse/parser.h"
+#include "frontend/visitor/ApplyTypesBuilder.h"
+
+namespace {
+struct Workload {
+  const char* name;
+  GeneratorOptions options;
+};
+
+// every workload is one to a few MB of source at scale 1
+std::vector<Workload> workloads(int scale) {
+  std::vector<Workload> list;
+  GeneratorOptions base;
+  base.functions = 200 * scale;
+
+  list.push_back({"baseline", base});
+
+  Workload many_functions{"many small functions", base};
+  many_functions.options.functions = 2000 * scale;
+  many_functions.options.statements = 2;
+  list.push_back(many_functions);
+
+  Workload long_bodies{"long function bodies", base};
+  long_bodies.options.functions = 50 * scale;
+  long_bodies.options.statements = 400;
+  long_bodies.options.scope_depth = 0;
+  list.push_back(long_bodies);
+
+  Workload deep_expressions{"deep expressions", base};
+  deep_expressions.options.functions = 100 * scale;
+  deep_expressions.options.statements = 5;
+  deep_expressions.options.expression_depth = 5;
+  deep_expressions.options.expression_operands = 2;
+  list.push_back(deep_expressions);
+
+  Workload long_chains{"long operator chains", base};
+  long_chains.options.expression_depth = 0;
+  long_chains.options.expression_operands = 20;
+  list.push_back(long_chains);
+
+  Workload nested_scopes{"nested scopes", base};
+  nested_scopes.options.functions = 15 * scale;
+  nested_scopes.options.statements = 10;
+  nested_scopes.options.scope_depth = 6;
+  list.push_back(nested_scopes);
+
+  Workload structs{"structs", base};
+  structs.options.structs = 1000 * scale;
+  list.push_back(structs);
+
+  Workload comments{"comment heavy", base};
+  comments.options.comment_density = 1.0;
+  list.push_back(comments);
+  return list;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = 10;
+  int scale = 1;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = std::atoi(argv[++i]);
+    } else if (arg == "--scale" && i + 1 < argc) {
+      scale = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: " << argv[0] << " [-n iterations] [--scale N]\n";
+      return 1;
+    }
+  }
+  if (iterations <= 0 || scale <= 0) {
+    std::cerr << "iterations and scale must be positive\n";
+    return 1;
+  }
+
+  // parseFile reads from disk, the file stays in the page cache between runs
+  std::filesystem::path file =
+      std::filesystem::temp_directory_path() / "parse_bench.program";
+  for (const Workload& workload : workloads(scale)) {
+    GeneratedProgram program = generate_program(workload.options);
+    std::ofstream(file, std::ios::binary) << program.source;
+
+    // the first parse warms up caches and the symbol table, every parse
+    // starts with an empty type table of its own
+    auto parse = [&] {
+      frontend::CompilationContext compilation;
+      frontend::parseFile(compilation, file.c_str());
+    };
+    parse();
+    BenchResult result = run_bench(iterations, parse);
+    print_result(workload.name, result, program.source.size());
+    std::cout << "    " << program.statements << " statements, "
+              << std::fixed << std::setprecision(0)
+              << program.statements / (result.median_ms / 1000.0)
+              << " statements/s (median)" << std::endl;
+
+    frontend::CompilationContext compilation;
+    frontend::Program parsed = frontend::parseFile(compilation, file.c_str());
+    frontend::ApplyTypesBuilder builder(compilation);
+    size_t copy_bytes = builder.build_program(parsed).arena->bytesAllocated();
+    BenchResult copy_typing = run_bench(
+        iterations, [&] { builder.build_program(parsed); });
+    // typing is idempotent, every run does the same work on the same tree
+    BenchResult in_place_typing =
+        run_bench(iterations, [&] { builder.apply_types(parsed); });
+    std::cout << "    AST " << parsed.arena->bytesAllocated() / 1024
+              << " KiB in " << parsed.arena->blocks() << " blocks"
+              << std::endl;
+    std::cout << "    typing pass " << std::setprecision(3)
+              << copy_typing.median_ms << " ms and " << copy_bytes / 1024
+              << " KiB for the typed copy, " << in_place_typing.median_ms
+              << " ms and no allocation in place (median)" << std::endl;
+  }
+  std::filesystem::remove(file);
+
+  // ru_maxrss is in KiB on Linux
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  std::cout << "peak resident set " << usage.ru_maxrss / 1024 << " MiB"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,58 @@
+// Writes a synthetic .program source, e.g. to profile the parser on an input
+// of a given shape or to feed frontend_bench.
+//
+// usage: program_gen [--functions N] [--statements N] [--depth N]
+//                    [--operands N] [--scopes N] [--structs N]
+//                    [--comments F] [--seed N] [-o file]
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "ProgramGenerator.h"
+
+int main(int argc, char** argv) {
+  GeneratorOptions options;
+  std::string output;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "missing value for " << arg << "\n";
+      return 1;
+    }
+    const char* value = argv[++i];
+    if (arg == "--functions") {
+      options.functions = std::atoi(value);
+    } else if (arg == "--statements") {
+      options.statements = std::atoi(value);
+    } else if (arg == "--depth") {
+      options.expression_depth = std::atoi(value);
+    } else if (arg == "--operands") {
+      options.expression_operands = std::atoi(value);
+    } else if (arg == "--scopes") {
+      options.scope_depth = std::atoi(value);
+    } else if (arg == "--structs") {
+      options.structs = std::atoi(value);
+    } else if (arg == "--comments") {
+      options.comment_density = std::atof(value);
+    } else if (arg == "--seed") {
+      options.seed = std::strtoull(value, nullptr, 10);
+    } else if (arg == "-o") {
+      output = value;
+    } else {
+      std::cerr << "unknown option " << arg << "\n";
+      return 1;
+    }
+  }
+
+  GeneratedProgram program = generate_program(options);
+  if (output.empty()) {
+    std::cout << program.source;
+  } else {
+    std::ofstream(output, std::ios::binary) << program.source;
+  }
+  std::cerr << program.source.size() << " bytes, " << program.statements
+            << " statements" << std::endl;
+  return 0;
+}
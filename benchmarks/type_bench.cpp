@@ -0,0 +1,132 @@
+// Times interning VarTypes in a TypeTable holding thousands of struct and
+// array types: creating them, then the lookups typing does over and over
+// (findTypeByName and the value category and reference conversions). Every
+// lookup goes through the table, so its cost should not grow with the number
+// of types.
+//
+// usage: type_bench [-n iterations] [--structs N] [--arrays N]
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "frontend/symbol/Symbol.h"
+#include "frontend/types/VarType.h"
+
+namespace {
+using frontend::ConstVarTypePtr;
+using frontend::Symbol;
+using frontend::TypeTable;
+using frontend::VarType;
+
+struct Types {
+  std::vector<Symbol> struct_names;
+  std::vector<ConstVarTypePtr> all;
+};
+
+// arrays of int64 of every length up to arrays, and structs that each hold
+// an int64, an array and the struct before them
+Types make_types(TypeTable& table, int structs, int arrays) {
+  Types types;
+  ConstVarTypePtr int64 = VarType::findTypeByName(table, Symbol("int64"));
+  std::vector<ConstVarTypePtr> array_types;
+  for (int i = 1; i <= arrays; i++) {
+    ConstVarTypePtr elem = int64;
+    array_types.push_back(VarType::getArrayType(
+        table, Symbol("int64[" + std::to_string(i) + "]"), 1, i, elem));
+  }
+  for (int i = 0; i < structs; i++) {
+    VarType::MemberTypes members = {int64,
+                                    array_types[i % array_types.size()]};
+    VarType::MemberNameToIndex names = {{Symbol("a"), 0}, {Symbol("b"), 1}};
+    if (i > 0) {
+      members.push_back(types.all.back());
+      names.emplace(Symbol("prev"), 2);
+    }
+    types.struct_names.emplace_back("S" + std::to_string(i));
+    types.all.push_back(VarType::getStructType(table, types.struct_names.back(),
+                                               members, names));
+  }
+  types.all.insert(types.all.end(), array_types.begin(), array_types.end());
+  return types;
+}
+
+void print_lookups(const std::string& name, const BenchResult& result,
+                   uint64_t lookups) {
+  std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+            << std::setprecision(3) << " best " << std::setw(10)
+            << result.best_ms << " ms  median " << std::setw(10)
+            << result.median_ms << " ms  " << std::setw(10)
+            << result.best_ms * 1e6 / static_cast<double>(lookups)
+            << " ns/lookup" << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  int iterations = 10;
+  int structs = 2000;
+  int arrays = 2000;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = std::atoi(argv[++i]);
+    } else if (arg == "--structs" && i + 1 < argc) {
+      structs = std::atoi(argv[++i]);
+    } else if (arg == "--arrays" && i + 1 < argc) {
+      arrays = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [-n iterations] [--structs N] [--arrays N]\n";
+      return 1;
+    }
+  }
+  if (iterations <= 0 || structs <= 0 || arrays <= 0) {
+    std::cerr << "iterations, structs and arrays must be positive\n";
+    return 1;
+  }
+
+  // arrays, structs and int64
+  uint64_t created = static_cast<uint64_t>(structs) + arrays + 1;
+  print_lookups("  create", run_bench(iterations, [&] {
+                  TypeTable table;
+                  make_types(table, structs, arrays);
+                }),
+                created);
+
+  TypeTable table;
+  Types types = make_types(table, structs, arrays);
+  // keeps the looked up types from being thrown away
+  const VarType* volatile sink = nullptr;
+  // the derived types exist from here on, so the lookups below only find
+  for (const auto& type : types.all) {
+    sink = type->getLValueFrom()->getRefTypeFrom().get();
+    sink = type->getPrValueFrom().get();
+  }
+  std::cout << table.size() << " types in the table" << std::endl;
+
+  print_lookups("  findTypeByName", run_bench(iterations, [&] {
+                  for (Symbol name : types.struct_names) {
+                    sink = VarType::findTypeByName(table, name).get();
+                  }
+                }),
+                types.struct_names.size());
+  print_lookups("  value categories", run_bench(iterations, [&] {
+                  for (const auto& type : types.all) {
+                    sink = type->getLValueFrom().get();
+                    sink = type->getPrValueFrom().get();
+                  }
+                }),
+                2 * types.all.size());
+  // a reference is looked up along with the type it refers to
+  print_lookups("  getRefTypeFrom", run_bench(iterations, [&] {
+                  for (const auto& type : types.all) {
+                    sink = type->getLValueFrom()->getRefTypeFrom().get();
+                  }
+                }),
+                3 * types.all.size());
+  return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace frontend::ast {
+
+// Bump allocator owning every node of one Program.
+//
+// Nodes are placed one after another in large blocks and point to each other
+// with plain pointers. Nothing is freed on its own: destroying the arena runs
+// the nodes' destructors (last allocated first) and releases the blocks.
+class Arena {
+ public:
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena();
+
+  template <typename T, typename... Args>
+  T* make(Args&&... args) {
+    void* memory = allocate(sizeof(T), alignof(T));
+    T* node = new (memory) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      destructors_.push_back(
+          {node, [](void* p) { static_cast<T*>(p)->~T(); }});
+    }
+    return node;
+  }
+
+  /* @brief Takes over everything other allocated, other is left empty.
+   *
+   * Nodes of both arenas then live until this one is destroyed, so they may
+   * point to each other.
+   */
+  void adopt(Arena&& other);
+
+  size_t bytesAllocated() const { return bytes_allocated_; }
+  size_t blocks() const { return blocks_.size(); }
+
+ private:
+  static constexpr size_t kBlockSize = 64 * 1024;
+
+  struct Destructor {
+    void* node;
+    void (*destroy)(void*);
+  };
+
+  void* allocate(size_t size, size_t align);
+
+  std::vector<std::unique_ptr<std::byte[]>> blocks_;
+  std::byte* next_ = nullptr;
+  std::byte* end_ = nullptr;
+  size_t bytes_allocated_ = 0;
+  std::vector<Destructor> destructors_;
+};
+
+}  // namespace frontend::ast
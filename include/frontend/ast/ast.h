@@ -1,12 +1,17 @@
 #pragma once
 
 #include <cstdint>
-#include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "frontend/ast/Arena.h"
+#include "frontend/diagnostic/debug.h"
+#include "frontend/symbol/Symbol.h"
 #include "frontend/types/VarType.h"
 #include "frontend/visitor/AbstractVisitorInst.h"
 #include "frontend/visitor/AbstractVisitorValue.h"
@@ -19,30 +24,55 @@ struct Instruction;
 struct Function;
 struct StructDecl;
 
-using ConstValuePtr = std::shared_ptr<const Value>;
-using ValuePtr = std::shared_ptr<Value>;
-using ConstInstrPtr = std::unique_ptr<const ast::Instruction>;
-using InstrPtr = std::unique_ptr<ast::Instruction>;
-using ConstFunctionPtr = std::unique_ptr<const Function>;
-using FunctionPtr = std::unique_ptr<Function>;
-using StructDeclPtr = std::unique_ptr<StructDecl>;
-using ConstStructDeclPtr = std::unique_ptr<const StructDecl>;
+// nodes are owned by the arena of their Program, these never own
+using ConstValuePtr = const Value*;
+using ValuePtr = Value*;
+using ConstInstrPtr = const ast::Instruction*;
+using InstrPtr = ast::Instruction*;
+using ConstFunctionPtr = const Function*;
+using FunctionPtr = Function*;
+using StructDeclPtr = StructDecl*;
+using ConstStructDeclPtr = const StructDecl*;
 }  // namespace ast
+class ModuleInterface;
 
 struct Program {
  public:
+  // every node of functions and structs, freed with the Program. Held by
+  // pointer so nodes stay put when the Program is moved.
+  std::unique_ptr<ast::Arena> arena = std::make_unique<ast::Arena>();
   std::vector<ast::FunctionPtr> functions;
   std::vector<ast::ConstStructDeclPtr> structs;
+
+  // the modules named by import declarations, owned by the compilation
+  std::vector<ModuleInterface*> imports;
+  // declarations of the imported functions this program calls, in the order
+  // they were first called, owned by their module
+  std::vector<ast::ConstFunctionPtr> imported_functions;
 };
 
 namespace ast {
 
 enum BinOpId { NONE, ADD, MUL, AND, SUB, SHL, SHR, LT, GT, LEQ, GEQ, EQ };
 std::string binopToString(BinOpId op);
+// higher binds tighter, follows C (e.g. * before +, == before &)
+int binopPrecedence(BinOpId op);
 struct Instruction;
 struct Value;
 struct Function;
-BinOpId stringToBinop(const std::string& op);
+BinOpId stringToBinop(std::string_view op);
+
+// the concrete type of a Value or Instruction, so passes can switch over it
+// instead of going through virtual calls and dynamic_cast (see visit, isa and
+// dyn_cast below)
+enum class ValueKind : uint8_t {
+#define AST_VALUE_NODE(name) name,
+#include "frontend/ast/ASTNodes.def"
+};
+enum class InstructionKind : uint8_t {
+#define AST_INSTRUCTION_NODE(name) name,
+#include "frontend/ast/ASTNodes.def"
+};
 
 // All AST nodes (Function, Program, and Value) inherit from this
 struct TypedNode {
@@ -50,155 +80,193 @@ struct TypedNode {
   TypedNode() = default;
   explicit TypedNode(ConstVarTypePtr ptr) : type(std::move(ptr)){};
   ConstVarTypePtr type;
+  // source line the node starts on, 0 if unknown
+  uint32_t line = 0;
 };
 
 struct Value : TypedNode {
  public:
-  virtual void accept(AbstractVisitorValue* v) const = 0;
+  // calls the visit overload for kind
+  void accept(AbstractVisitorValue* v) const;
 
-  Value() = default;
-  explicit Value(ConstVarTypePtr type_ptr) : TypedNode(std::move(type_ptr)){};
+  explicit Value(ValueKind kind) : kind(kind){};
+  Value(ValueKind kind, ConstVarTypePtr type_ptr)
+      : TypedNode(std::move(type_ptr)), kind(kind){};
   ~Value() override = 0;
+
+  const ValueKind kind;
 };
 struct Variable : public Value {
  public:
-  void accept(AbstractVisitorValue* v) const override;
-  static std::shared_ptr<Variable> get(const std::string& name,
-                                       const Function* f);
-  static std::map<const Function*,
-                  std::map<std::string, std::shared_ptr<Variable>>>
-      variables_;
+  static constexpr ValueKind kKind = ValueKind::Variable;
 
-  std::string name;
+  Symbol name;
+  // dense within the function the variable belongs to, in the order of
+  // first use (see Function::getVariable)
+  uint32_t index = 0;
   ~Variable() override = default;
 
  protected:
-  Variable() = default;
+  Variable() : Value(kKind) {}
 };
 struct Integer : public Value {
  public:
-  explicit Integer(int64_t value);
+  static constexpr ValueKind kKind = ValueKind::Integer;
+  // type is the int64 literal type of the program's CompilationContext
+  Integer(int64_t value, ConstVarTypePtr type);
   Integer() = delete;
   ~Integer() override = default;
 
-  void accept(AbstractVisitorValue* v) const override;
-
   int64_t value;
 };
+struct Float : public Value {
+ public:
+  static constexpr ValueKind kKind = ValueKind::Float;
+  // type is the float64 literal type of the program's CompilationContext
+  Float(double value, ConstVarTypePtr type);
+  Float() = delete;
+  ~Float() override = default;
+
+  double value;
+};
 struct BinaryOperation : public Value {
  public:
-  BinaryOperation(BinOpId op, ConstValuePtr&& lhs, ConstValuePtr&& rhs);
+  static constexpr ValueKind kKind = ValueKind::BinaryOperation;
+  BinaryOperation(BinOpId op, ConstValuePtr lhs, ConstValuePtr rhs);
   BinaryOperation() = delete;
   ~BinaryOperation() override = default;
 
-  void accept(AbstractVisitorValue* v) const override;
   BinOpId op = BinOpId::NONE;
   ConstValuePtr lhs;
   ConstValuePtr rhs;
+  // the type both operands are converted to before the operation, type is
+  // bool for comparisons (see ApplyTypesBuilder)
+  ConstVarTypePtr operand_type;
 };
 struct FunctionName : public Value {
  public:
-  FunctionName(std::string&& name, ConstVarTypePtr ret);
+  static constexpr ValueKind kKind = ValueKind::FunctionName;
+  FunctionName(Symbol name, ConstVarTypePtr ret);
   FunctionName() = delete;
   ~FunctionName() override = default;
   ConstVarTypePtr return_type;
-  void accept(AbstractVisitorValue* v) const override;
-  std::string name;
+  Symbol name;
 };
 struct FunctionCall : public Value {
  public:
-  FunctionCall(ConstValuePtr&& function, std::vector<ConstValuePtr>&& args);
+  static constexpr ValueKind kKind = ValueKind::FunctionCall;
+  FunctionCall(ConstValuePtr function, std::vector<ConstValuePtr>&& args);
   FunctionCall() = delete;
   ~FunctionCall() override = default;
 
-  void accept(AbstractVisitorValue* v) const override;
   ConstValuePtr function;
   std::vector<ConstValuePtr> args;
   std::vector<ConstVarTypePtr> arg_types;
 };
 struct ArrayAccess : public Value {
  public:
-  ArrayAccess(ConstValuePtr&& var, std::vector<ConstValuePtr>&& indices,
+  static constexpr ValueKind kKind = ValueKind::ArrayAccess;
+  ArrayAccess(ConstValuePtr var, std::vector<ConstValuePtr>&& indices,
               uint64_t line_number);
   ArrayAccess() = delete;
   ~ArrayAccess() override = default;
 
-  void accept(AbstractVisitorValue* v) const override;
   ConstValuePtr var;
   std::vector<ConstValuePtr> indices;
 };
 struct ArrayAllocate : public Value {
  public:
-  ArrayAllocate(ConstValuePtr&& length, ConstValuePtr&& elem_value);
+  static constexpr ValueKind kKind = ValueKind::ArrayAllocate;
+  ArrayAllocate(ConstValuePtr length, ConstValuePtr elem_value);
   ArrayAllocate() = delete;
   ~ArrayAllocate() override = default;
-  void accept(AbstractVisitorValue* v) const override;
   const ConstValuePtr length;
-  const ConstValuePtr elem_value;
+  ConstValuePtr elem_value;  // replaced when evaluateConstCalls folds it
+};
+// length(array), the number of elements of an array or a slice, an array is
+// not evaluated since its size is part of its type
+struct ArrayLength : public Value {
+ public:
+  static constexpr ValueKind kKind = ValueKind::ArrayLength;
+  explicit ArrayLength(ConstValuePtr array);
+  ArrayLength() = delete;
+  ~ArrayLength() override = default;
+  const ConstValuePtr array;
 }; /*
  * Instruction interface.
  */
 struct Instruction : TypedNode {
  public:
-  virtual void accept(AbstractVisitorInst* v) const = 0;
+  // calls the visit overload for kind
+  void accept(AbstractVisitorInst* v) const;
+
+  explicit Instruction(InstructionKind kind) : kind(kind){};
   ~Instruction() override = default;
 
+  const InstructionKind kind;
+
 }; /*
  * Instructions.
  */
 struct InstructionReturn : public Instruction {
  public:
-  explicit InstructionReturn(ConstValuePtr&& val);
+  static constexpr InstructionKind kKind = InstructionKind::InstructionReturn;
+  explicit InstructionReturn(ConstValuePtr val);
   InstructionReturn();  // return void
-  void accept(AbstractVisitorInst* v) const override;
 
   ConstValuePtr val;
 };
 struct InstructionAssignment : public Instruction {
  public:
-  InstructionAssignment(ConstValuePtr&& dst, ConstValuePtr&& src);
+  static constexpr InstructionKind kKind =
+      InstructionKind::InstructionAssignment;
+  InstructionAssignment(ConstValuePtr dst, ConstValuePtr src);
   InstructionAssignment() = delete;
-  void accept(AbstractVisitorInst* v) const override;
 
   ConstValuePtr src;
   ConstValuePtr dst;
 };
 struct InstructionFunctionCall : public Instruction {
  public:
-  explicit InstructionFunctionCall(ConstValuePtr&& function_call);
-  void accept(AbstractVisitorInst* v) const override;
+  static constexpr InstructionKind kKind =
+      InstructionKind::InstructionFunctionCall;
+  explicit InstructionFunctionCall(ConstValuePtr function_call);
 
   ConstValuePtr function_call;
 };
 struct InstructionWhileLoop : public Instruction {
  public:
-  InstructionWhileLoop(ConstValuePtr&& cond, ConstInstrPtr&& body);
-  void accept(AbstractVisitorInst* v) const override;
+  static constexpr InstructionKind kKind =
+      InstructionKind::InstructionWhileLoop;
+  InstructionWhileLoop(ConstValuePtr cond, ConstInstrPtr body);
 
   ConstValuePtr cond;
   ConstInstrPtr body;
 };
 struct InstructionIfStatement : public Instruction {
  public:
-  InstructionIfStatement() = default;
-  InstructionIfStatement(ConstValuePtr&& cond, ConstInstrPtr&& true_scope);
-  void accept(AbstractVisitorInst* v) const override;
+  static constexpr InstructionKind kKind =
+      InstructionKind::InstructionIfStatement;
+  InstructionIfStatement() : Instruction(kKind) {}
+  InstructionIfStatement(ConstValuePtr cond, ConstInstrPtr true_scope);
 
-  ConstValuePtr cond;
-  ConstInstrPtr true_scope;
+  ConstValuePtr cond = nullptr;
+  ConstInstrPtr true_scope = nullptr;
 };
 struct InstructionBreak : public Instruction {
  public:
-  void accept(AbstractVisitorInst* v) const override;
+  static constexpr InstructionKind kKind = InstructionKind::InstructionBreak;
+  InstructionBreak() : Instruction(kKind) {}
 };
 struct InstructionContinue : public Instruction {
  public:
-  void accept(AbstractVisitorInst* v) const override;
+  static constexpr InstructionKind kKind = InstructionKind::InstructionContinue;
+  InstructionContinue() : Instruction(kKind) {}
 };
 struct InstructionDecl : public Instruction {
  public:
+  static constexpr InstructionKind kKind = InstructionKind::InstructionDecl;
   explicit InstructionDecl(std::vector<ValuePtr>&& vars);
-  void accept(AbstractVisitorInst* v) const override;
 
   std::vector<ConstValuePtr> variables;
 }; /*
@@ -206,14 +274,16 @@ struct InstructionDecl : public Instruction {
  */
 struct Scope : public Instruction {
  public:
-  void accept(AbstractVisitorInst* v) const override;
+  static constexpr InstructionKind kKind = InstructionKind::Scope;
+  Scope() : Instruction(kKind) {}
   std::vector<ConstInstrPtr> instructions;
 };
 
 struct StructDecl : TypedNode {
-  std::string name;
+  Symbol name;
   VarType::MemberNameToIndex member_name_to_index;
   std::vector<ConstVarTypePtr> member_types;
+  VarType::StructAttributes attributes;
 };
 
 /*
@@ -221,11 +291,66 @@ struct StructDecl : TypedNode {
  */
 struct Function : TypedNode {
  public:
-  std::string name;
+  // the variable called name in this function, made in arena on first use
+  // and numbered after the ones made before it
+  Variable* getVariable(Symbol name, Arena& arena);
+
+  Symbol name;
   std::vector<ConstValuePtr> args;
-  ConstInstrPtr scope;
+  ConstInstrPtr scope = nullptr;
   int64_t return_dim = 0;
+  std::unordered_map<Symbol, Variable*> variables;
 };
+
+/* @brief Calls fn with value as a reference to its concrete node type.
+ *
+ * A switch over value.kind, so fn may be a generic lambda or an overload set
+ * and is called without any virtual dispatch.
+ */
+template <typename Fn>
+decltype(auto) visit(const Value& value, Fn&& fn) {
+  switch (value.kind) {
+#define AST_VALUE_NODE(name) \
+  case ValueKind::name:      \
+    return fn(static_cast<const name&>(value));
+#include "frontend/ast/ASTNodes.def"
+  }
+  FRONTEND_ERROR("unknown value kind");
+}
+
+/* @brief Calls fn with inst as a reference to its concrete node type. */
+template <typename Fn>
+decltype(auto) visit(const Instruction& inst, Fn&& fn) {
+  switch (inst.kind) {
+#define AST_INSTRUCTION_NODE(name) \
+  case InstructionKind::name:      \
+    return fn(static_cast<const name&>(inst));
+#include "frontend/ast/ASTNodes.def"
+  }
+  FRONTEND_ERROR("unknown instruction kind");
+}
+
+// isa<T>(node), dyn_cast<T>(node) and cast<T>(node) check a Value or
+// Instruction pointer against T::kKind, dyn_cast returns nullptr on a
+// mismatch (or a null node)
+template <typename T, typename Node>
+bool isa(const Node* node) {
+  return node->kind == T::kKind;
+}
+
+template <typename T, typename Node>
+auto dyn_cast(Node* node) {
+  using Result = std::conditional_t<std::is_const_v<Node>, const T*, T*>;
+  return node != nullptr && isa<T>(node) ? static_cast<Result>(node)
+                                         : nullptr;
+}
+
+template <typename T, typename Node>
+auto cast(Node* node) {
+  ASSERT(node != nullptr && isa<T>(node), "cast to the wrong node kind");
+  using Result = std::conditional_t<std::is_const_v<Node>, const T*, T*>;
+  return static_cast<Result>(node);
+}
 }  // namespace ast
 
 }  // namespace frontend
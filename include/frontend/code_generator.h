@@ -1,41 +1,103 @@
 #pragma once
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Support/CodeGen.h>
 
-#include <map>
+#include <memory>
 #include <string>
 
 #include "frontend/ast/ast.h"
+#include "frontend/debug_info.h"
+#include "frontend/mir/mir.h"
 #include "visitor/IRInstructionGen.h"
 
 // forward declare llvm types to avoid including llvm headers
 namespace llvm {
+class TargetMachine;
 class Value;
 }  // namespace llvm
 
 namespace frontend {
+class CompilationContext;
+
+// the -O levels of clang: O0 generates code without optimizing it, O1 to O3
+// optimize more and more for speed, Os and Oz for size
+enum class OptLevel { O0, O1, O2, O3, Os, Oz };
+
+// the backend's optimization level for level, as clang picks it
+llvm::CodeGenOpt::Level codegenOptLevel(OptLevel level);
+
 class CodeGenerator {
  public:
-  CodeGenerator();
+  explicit CodeGenerator(CompilationContext& compilation);
+  ~CodeGenerator();
+
+  /* @brief Describes the functions generated from now on in DWARF debug
+   * info (-g), as defined in source_file. The description says whether the
+   * code is optimized, so the level must be set before.
+   */
+  void emitDebugInfo(const std::string& source_file);
+  /* @brief Lets the optimizer treat floating-point arithmetic like real
+   * arithmetic (-ffast-math): reassociate it, e.g. to vectorize reductions,
+   * and assume there are no NaNs, infinities or signed zeros. Applies to the
+   * functions declared and generated from now on.
+   */
+  void enableFastMath();
+  /* @brief Optimizes at level instead of O2. At O0 the IR goes to the backend
+   * as generated, which selects instructions with FastISel. Os and Oz are
+   * also function attributes, so they apply to the functions declared from
+   * now on.
+   */
+  void setOptLevel(OptLevel level);
+  /* @brief Runs pipeline, in the syntax of opt -passes (e.g.
+   * "function(mem2reg,instcombine)"), instead of the IR pipeline of the
+   * level. The level still picks the backend's optimizations.
+   */
+  void setPassPipeline(const std::string& pipeline);
   void generateCode(const Program& p, const std::string& filename);
+  // the same through the mid-level IR (see mir::lowerProgram)
+  void generateCode(const mir::Module& m, const std::string& filename);
+
+  // the steps of generateCode, for building a program one function at a time
+  // (see IncrementalBuild)
+  void declareFunction(const ast::Function& f);
+  void generateFunction(ast::ConstFunctionPtr f);
+  void generateFunction(const mir::Function& f);
+  void optimize();
+  llvm::SmallVector<char, 0> writeBitcode() const;
+  void linkBitcode(llvm::StringRef bitcode);
+  void emitObjectFile(const std::string& filename);
 
  private:
+  CompilationContext& compilation_;
   llvm::LLVMContext context_;
   llvm::Module module_;
   llvm::IRBuilder<> builder_;
+  // created up front, so the optimizer already sees the target's DataLayout
+  std::unique_ptr<llvm::TargetMachine> target_machine_;
+  // declared after module_, describes its functions
+  std::unique_ptr<DebugInfo> debug_info_;
+  bool fast_math_ = false;
+  OptLevel opt_level_ = OptLevel::O2;
+  std::string pass_pipeline_;  // empty for the default one of opt_level_
 
-  static void generateLLVMIR(const ast::FunctionPtr& f,
-                             IRInstructionGen& irgen);
-  std::map<const ast::Variable*, llvm::Value*> functionSetup(
-      const ast::FunctionPtr& f);
+  static void generateLLVMIR(ast::ConstFunctionPtr f, IRInstructionGen& irgen);
+  VariableSlots functionSetup(ast::ConstFunctionPtr f);
+  llvm::DISubprogram* describeFunction(const ast::Function& f);
+  void declareVariables(const ast::Function& f, const VariableSlots& slots,
+                        llvm::DISubprogram* subprogram);
+  void declareSlots(const mir::Function& f,
+                    const std::vector<llvm::Value*>& slots,
+                    llvm::DISubprogram* subprogram);
+  void setupTarget();
   void llvmVerifyGeneratedIr() const;
   void llvmOptimPass();
   void llvmCodegenPass(const std::string& filename,
                        llvm::CodeGenFileType file_type);
-  void setupFunctionArgs(
-      std::map<const ast::Variable*, llvm::Value*>& allocated_variables,
-      llvm::Argument* llvm_arg, const ast::ConstValuePtr& var);
+  void setupFunctionArgs(VariableSlots& allocated_variables,
+                         llvm::Argument* llvm_arg, ast::ConstValuePtr var);
 };
 
 }  // namespace frontend
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "frontend/module/ModuleInterface.h"
+#include "frontend/types/VarType.h"
+
+namespace frontend {
+
+// State shared by the passes of one compilation: parseFile, ApplyTypesBuilder
+// and CodeGenerator all take the context of the program they work on.
+//
+// Nothing is kept between compilations or shared with another context, so
+// independent compilations can run on separate threads and everything one of
+// them allocated is released with its context. Programs point into the
+// context's types, the context must outlive them.
+class CompilationContext {
+ public:
+  CompilationContext() = default;
+  CompilationContext(const CompilationContext&) = delete;
+  CompilationContext& operator=(const CompilationContext&) = delete;
+
+  TypeTable& types() { return types_; }
+
+  /* @brief Returns the interface at path, opened the first time a program of
+   * this compilation imports it.
+   */
+  ModuleInterface& importModule(const std::string& path) {
+    std::lock_guard<std::mutex> lock(modules_mutex_);
+    auto& module = modules_[path];
+    if (!module) {
+      module = ModuleInterface::open(path, types_);
+    }
+    return *module;
+  }
+
+  // print the AST and codegen progress (-d)
+  bool debug = false;
+
+ private:
+  TypeTable types_;
+  // declared after types_, imported declarations point into it
+  std::mutex modules_mutex_;
+  std::unordered_map<std::string, std::unique_ptr<ModuleInterface>> modules_;
+};
+
+}  // namespace frontend
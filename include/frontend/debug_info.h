@@ -0,0 +1,67 @@
+#pragma once
+#include <llvm/IR/DIBuilder.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "frontend/ast/ast.h"
+#include "frontend/symbol/Symbol.h"
+#include "frontend/types/VarType.h"
+
+// forward declare llvm types to avoid including llvm headers
+namespace llvm {
+class BasicBlock;
+class Function;
+class Module;
+class Value;
+}  // namespace llvm
+
+namespace frontend {
+
+// DWARF debug info for the functions of one llvm::Module (-g): a compile unit
+// for the source file, a subprogram per function, and the variables with
+// their types described from VarType. Instructions get their locations from
+// the line of the AST node they were generated from, so profilers and
+// debuggers map machine code back to lines of the .program file.
+class DebugInfo {
+ public:
+  // optimized tells debuggers that variables and lines may not map one to one
+  // to the machine code
+  DebugInfo(llvm::Module& module, const std::string& source_file,
+            bool optimized);
+  DebugInfo(const DebugInfo&) = delete;
+  DebugInfo& operator=(const DebugInfo&) = delete;
+
+  /* @brief Describes f and attaches the description to its definition.
+   *
+   * @return the scope of the locations and variables in f
+   */
+  llvm::DISubprogram* describeFunction(llvm::Function& llvm_function,
+                                       const ast::Function& f);
+
+  /* @brief Declares a variable living at storage, at the end of block.
+   *
+   * @param arg_no the 1-based position of a parameter, 0 for a local
+   */
+  void declareVariable(llvm::DISubprogram* scope, Symbol name,
+                       const VarType& type, uint32_t line, unsigned arg_no,
+                       llvm::Value* storage, llvm::BasicBlock& block);
+
+  // resolves the descriptions, before the module is verified
+  void finalize();
+
+ private:
+  llvm::DIType* describeType(const VarType& type);
+  llvm::DISubroutineType* describeSignature(const ast::Function& f);
+
+  llvm::DIBuilder builder_;
+  llvm::DIFile* file_;
+  llvm::DICompileUnit* unit_;
+  bool optimized_;
+  // every value category of a type is a VarType of its own
+  std::unordered_map<const VarType*, llvm::DIType*> types_;
+  bool finalized_ = false;
+};
+
+}  // namespace frontend
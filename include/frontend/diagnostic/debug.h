@@ -2,13 +2,54 @@
 #pragma once
 #include <cstdlib>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
-extern bool enableDebug;
+namespace frontend {
+// what FRONTEND_ERROR raises, with where in the compiler it was raised
+struct FrontendError : std::runtime_error {
+  FrontendError(const std::string& msg, const char* file, int line)
+      : std::runtime_error(msg), file(file), line(line) {}
+  const char* file;
+  int line;
+};
 
-#define FRONTEND_ERROR(msg)                                            \
-  std::cerr << "FRONTEND_ERROR: " << (msg) << " [in file " << __FILE__ \
-            << " on line " << __LINE__ << "]" << std::endl;            \
-  exit(1)
+// While one is alive on a thread, FRONTEND_ERROR on that thread throws a
+// FrontendError instead of exiting, so callers that must survive bad input
+// (watch mode, the parser's worker threads) can report the error themselves.
+class RecoverableErrors {
+ public:
+  RecoverableErrors() { depth()++; }
+  ~RecoverableErrors() { depth()--; }
+  RecoverableErrors(const RecoverableErrors&) = delete;
+  RecoverableErrors& operator=(const RecoverableErrors&) = delete;
+
+  static bool active() { return depth() > 0; }
+
+ private:
+  static int& depth() {
+    static thread_local int depth = 0;
+    return depth;
+  }
+};
+
+inline void printError(const FrontendError& error) {
+  std::cerr << "FRONTEND_ERROR: " << error.what() << " [in file "
+            << error.file << " on line " << error.line << "]" << std::endl;
+}
+
+// throws error in a RecoverableErrors scope, prints it and exits otherwise
+[[noreturn]] inline void raiseError(const FrontendError& error) {
+  if (RecoverableErrors::active()) {
+    throw error;
+  }
+  printError(error);
+  exit(1);
+}
+}  // namespace frontend
+
+#define FRONTEND_ERROR(msg) \
+  ::frontend::raiseError(::frontend::FrontendError((msg), __FILE__, __LINE__))
 
 #define NOT_IMPLEMENTED()            \
   FRONTEND_ERROR("not implemented"); \
@@ -16,13 +57,14 @@ extern bool enableDebug;
 
 #ifdef DEBUGIR
 
-#define DEBUG_PRINT(msg)                                                \
+// enabled is usually CompilationContext::debug
+#define DEBUG_PRINT(enabled, msg)                                       \
   do {                                                                  \
-    if (enableDebug) {                                                  \
-      std::cout << "DEBUG PRINT: " << (msg) << " [in file " << __FILE__ \
-                << " on line " << __LINE__ << "]" << std::endl          \
+    if (enabled) {                                                      \
+      std::cout << "DEBUG PRINT: " << msg << " [in file " << __FILE__   \
+                << " on line " << __LINE__ << "]" << std::endl;         \
     }                                                                   \
-    while (0)
+  } while (0)
 
 #define DEBUG_PRINT_VECTOR(vec) \
   std::cout << #vec << ": ";    \
@@ -32,6 +74,6 @@ extern bool enableDebug;
   std::cout << std::endl
 #else
 #define ASSERT(condition, msg)
-#define DEBUG_PRINT(msg)
+#define DEBUG_PRINT(enabled, msg)
 #define DEBUG_PRINT_VECTOR(vec)
 #endif  // DEBUGIR
@@ -0,0 +1,81 @@
+#pragma once
+#include <llvm/ADT/SmallVector.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "frontend/ast/ast.h"
+#include "frontend/code_generator.h"
+#include "frontend/parse/parser.h"
+#include "frontend/symbol/Symbol.h"
+
+namespace frontend {
+class CompilationContext;
+
+// Rebuilds an object file from a .program file, redoing only the top-level
+// functions whose source changed since the previous build.
+//
+// Every function is generated and optimized in a module of its own and kept
+// as bitcode, so an unchanged function skips parsing, typing, IR generation
+// and optimization. Only linking the cached modules and the backend run over
+// the whole program each time. Functions are never inlined into each other in
+// this mode, and calls are not evaluated at compile time (see
+// evaluateConstCalls), since each one is optimized without seeing the
+// others' bodies.
+// With debug info a function is also rebuilt when it moves to another line.
+class IncrementalBuild {
+ public:
+  struct Stats {
+    size_t functions = 0;  // functions in the program
+    size_t rebuilt = 0;    // functions parsed and optimized again
+  };
+
+  // pass_pipeline replaces the IR pipeline of opt_level when not empty, see
+  // CodeGenerator::setPassPipeline
+  explicit IncrementalBuild(ParseOptions options = {},
+                            bool debug_info = false, bool fast_math = false,
+                            OptLevel opt_level = OptLevel::O2,
+                            std::string pass_pipeline = {});
+  ~IncrementalBuild();
+
+  /* @brief Builds output from input, reusing what the previous call built.
+   *
+   * A change to any struct or function signature rebuilds every function,
+   * since calls and struct accesses are compiled against them. A struct or
+   * import change also starts over with a new CompilationContext, so the old
+   * struct types are released and the module interfaces are read again.
+   *
+   * An error in the input is printed instead of ending the process, and the
+   * next rebuild reuses whatever is still cached.
+   *
+   * @return false if nothing was written
+   */
+  bool rebuild(const std::string& input, const std::string& output,
+               Stats* stats = nullptr);
+
+ private:
+  struct CachedFunction {
+    uint64_t hash = 0;
+    // owns typed, shared by the functions built in the same rebuild
+    std::shared_ptr<const Program> program;
+    ast::ConstFunctionPtr typed;  // signature for calls from rebuilt functions
+    llvm::SmallVector<char, 0> bitcode;
+  };
+
+  ParseOptions options_;
+  bool debug_info_;
+  bool fast_math_;
+  OptLevel opt_level_;
+  std::string pass_pipeline_;
+  // owns the types of every cached function
+  std::unique_ptr<CompilationContext> compilation_;
+  bool built_ = false;
+  uint64_t struct_hash_ = 0;
+  uint64_t signature_hash_ = 0;
+  std::unordered_map<Symbol, CachedFunction> functions_;
+};
+
+}  // namespace frontend
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include "frontend/mir/mir.h"
+
+// forward declare llvm types to avoid including llvm headers
+namespace llvm {
+class LLVMContext;
+class Module;
+class Value;
+class DISubprogram;
+class ConstantFolder;
+class IRBuilderDefaultInserter;
+
+template <typename FolderTy, typename InserterTy>
+class IRBuilder;
+
+}  // namespace llvm
+
+namespace frontend {
+
+// Generates LLVM IR from the mid-level IR, the counterpart of
+// IRInstructionGen for functions lowered with mir::lowerFunction.
+class IRMirGen final {
+ public:
+  IRMirGen(llvm::IRBuilder<llvm::ConstantFolder,
+                           llvm::IRBuilderDefaultInserter>& builder,
+           llvm::LLVMContext& context, llvm::Module& module);
+
+  /* @brief Generates the body of f, which must already be declared in the
+   * module along with every function it calls.
+   *
+   * @param subprogram scope of the source locations, null without debug info
+   */
+  void generate(const mir::Function& f,
+                llvm::DISubprogram* subprogram = nullptr);
+
+  // the stack slots of the function generated last, by mir::SlotId
+  const std::vector<llvm::Value*>& slots() const { return slots_; }
+
+ private:
+  llvm::IRBuilder<llvm::ConstantFolder, llvm::IRBuilderDefaultInserter>&
+      builder_;
+  llvm::LLVMContext& context_;
+  llvm::Module& module_;
+  std::vector<llvm::Value*> slots_;
+};
+}  // namespace frontend
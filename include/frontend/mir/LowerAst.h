@@ -0,0 +1,20 @@
+#pragma once
+
+#include "frontend/ast/ast.h"
+#include "frontend/mir/mir.h"
+
+namespace frontend::mir {
+
+/* @brief Flattens a typed function (the output of ApplyTypesBuilder).
+ *
+ * The instructions read and write memory exactly like IRInstructionGen does
+ * for the same AST, so both paths produce the same LLVM IR.
+ */
+Function lowerFunction(const ast::Function& function);
+
+/* @brief Lowers every function of a typed program, which must outlive the
+ * result.
+ */
+Module lowerProgram(const Program& program);
+
+}  // namespace frontend::mir
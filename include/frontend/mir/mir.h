@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "frontend/symbol/Symbol.h"
+#include "frontend/types/VarType.h"
+
+namespace frontend {
+namespace ast {
+struct Function;
+}  // namespace ast
+
+// Mid-level IR: the typed AST of a function flattened into basic blocks of
+// three-address instructions over virtual registers.
+//
+// A function is a struct of arrays indexed by instruction, the operands of
+// all instructions share one array, and the instructions of a block are
+// contiguous, so a pass over a function reads a few dense arrays from front
+// to back instead of following pointers through the tree. Memory is explicit:
+// every variable and temporary object lives in a stack slot and is read and
+// written through Load, Store and Copy.
+namespace mir {
+
+using Reg = uint32_t;
+using InstId = uint32_t;
+using BlockId = uint32_t;
+using SlotId = uint32_t;
+inline constexpr Reg kNoReg = UINT32_MAX;
+
+enum class RegType : uint8_t {
+  I1,   // bool, or the result of a comparison
+  I8,   // integers by width
+  I16,
+  I32,
+  I64,
+  F32,  // floats by width
+  F64,
+  Ptr,  // address of a slot, array element, argument or returned object
+  Slice,  // { ptr, i64 }, the first element and the length of a slice
+};
+
+// Operands are registers unless noted, imm is Instruction::imm and type is
+// Instruction::type.
+enum class Opcode : uint8_t {
+  Const,     // imm (a null pointer if the result is a Ptr, an empty slice if
+             // it is a Slice, the bits of a double if type is a float)
+  SlotAddr,  // address of slot imm
+  Arg,       // argument imm of the function, the last one is where an object
+             // is returned
+  Load,      // [address] -> value of type
+  Store,     // [value, address]
+  Copy,      // [destination, source], copies an object of type
+  Add,       // [lhs, rhs], floating-point if type is a float
+  Sub,
+  Mul,
+  And,
+  Shl,
+  Shr,
+  CmpLt,
+  CmpGt,
+  CmpLe,
+  CmpGe,
+  CmpEq,
+  CmpNe,     // comparisons compare as type, signed, unsigned or ordered
+  Trunc,     // [value] -> value as wide as the result register
+  SExt,
+  ZExt,
+  FPTrunc,
+  FPExt,
+  SIToFP,
+  UIToFP,
+  FPToSI,
+  FPToUI,
+  ElemAddr,  // [base, index...] -> element address in an object of type, or
+             // [data, index] if type is a slice
+  MakeSlice,    // [address] -> slice of type over the imm elements there
+  SliceData,    // [slice] -> address of its first element
+  SliceLength,  // [slice] -> its length as an I64
+  Call,      // [arg...] -> result of type, calls callees[imm]
+  Jump,      // [block]
+  Branch,    // [condition, true block, false block]
+  Ret,       // [value] or [] for void
+};
+
+const char* opcodeName(Opcode op);
+
+struct Slot {
+  const VarType* type;
+  Symbol name;  // empty for temporaries
+};
+
+struct Function {
+  // instruction i is opcode[i], defines result[i] (or kNoReg) and reads
+  // operands[operand_begin[i] .. operand_begin[i + 1])
+  std::vector<Opcode> opcode;
+  std::vector<Reg> result;
+  std::vector<const VarType*> type;
+  std::vector<int64_t> imm;
+  std::vector<uint32_t> operand_begin = {0};
+  std::vector<uint32_t> operands;
+  // source line of the statement instruction i was lowered from, 0 before
+  // the first one
+  std::vector<uint32_t> line;
+
+  // block b is instructions block_begin[b] .. block_begin[b + 1] (the last
+  // entry is size()), blocks are in layout order and block 0 is the entry
+  std::vector<InstId> block_begin;
+  std::vector<const char*> block_name;
+
+  std::vector<RegType> reg_type;
+  std::vector<Slot> slots;
+  std::vector<Symbol> callees;
+
+  // the signature, the typed Program must outlive the Function
+  const ast::Function* source = nullptr;
+
+  size_t size() const { return opcode.size(); }
+  size_t blocks() const { return block_name.size(); }
+  std::span<const uint32_t> operandsOf(InstId i) const {
+    return {operands.data() + operand_begin[i],
+            operands.data() + operand_begin[i + 1]};
+  }
+};
+
+struct Module {
+  std::vector<Function> functions;
+  // functions that are called but defined in an imported module
+  std::vector<const ast::Function*> declarations;
+};
+
+void print(const Function& f, std::ostream& stream);
+void print(const Module& module, std::ostream& stream);
+
+}  // namespace mir
+}  // namespace frontend
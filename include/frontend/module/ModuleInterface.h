@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "frontend/ast/Arena.h"
+#include "frontend/symbol/Symbol.h"
+#include "frontend/types/VarType.h"
+
+// forward declare llvm types to avoid including llvm headers
+namespace llvm {
+class MemoryBuffer;
+}  // namespace llvm
+
+namespace frontend {
+struct Program;
+namespace ast {
+struct Function;
+}  // namespace ast
+
+// extension of the file an interface is written to, next to the object file
+inline constexpr std::string_view kModuleInterfaceExtension = ".programi";
+
+// The binary interface of a compiled module: the signatures of its functions
+// and the layouts of its structs, so other programs can import it without
+// parsing or typing its source.
+//
+// The file is a header with the module's counts, followed by flat tables of
+// fixed-size entries: strings, VarType entries (members before the types that
+// contain them), struct types, and function signatures sorted by name. It is
+// memory mapped as is. Opening an interface registers its struct types, and a
+// function is only decoded into a declaration when a program calls it.
+class ModuleInterface {
+ public:
+  ModuleInterface(const ModuleInterface&) = delete;
+  ModuleInterface& operator=(const ModuleInterface&) = delete;
+  ~ModuleInterface();
+
+  /* @brief Maps the interface at path, its types are created in table.
+   */
+  static std::unique_ptr<ModuleInterface> open(const std::string& path,
+                                               TypeTable& table);
+
+  /* @brief Writes the signatures and structs program defines to path.
+   *
+   * Only the declarations are needed, so program does not have to be typed.
+   */
+  static void write(const Program& program, const std::string& path);
+
+  Symbol name() const { return name_; }
+  size_t functions() const { return num_functions_; }
+
+  /* @brief Returns the declaration of the function called name, decoded on
+   * first use, or nullptr if the module does not define one.
+   *
+   * A declaration has no scope and lives as long as the interface.
+   */
+  const ast::Function* findFunction(Symbol name);
+
+  // the struct types the module defines, in source order
+  const std::vector<ConstVarTypePtr>& structs() const { return structs_; }
+
+ private:
+  struct Writer;
+
+  ModuleInterface(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                  TypeTable& table);
+
+  static uint32_t encodeType(Writer& writer, const VarType& type);
+
+  template <typename T>
+  T entry(uint64_t section, uint32_t index) const;
+  std::string_view string(uint32_t index) const;
+  ConstVarTypePtr decodeType(uint32_t index);
+  const ast::Function* decodeFunction(uint32_t index);
+
+  std::unique_ptr<llvm::MemoryBuffer> buffer_;
+  TypeTable& table_;
+  Symbol name_;
+  uint32_t num_strings_ = 0;
+  uint32_t num_types_ = 0;
+  uint32_t num_members_ = 0;
+  uint32_t num_functions_ = 0;
+  uint32_t num_params_ = 0;
+  // byte offsets of the tables in the file
+  uint64_t string_offsets_ = 0;
+  uint64_t types_offset_ = 0;
+  uint64_t members_offset_ = 0;
+  uint64_t functions_offset_ = 0;
+  uint64_t params_offset_ = 0;
+  uint64_t string_data_ = 0;
+
+  // programs are parsed on several threads and decode declarations lazily
+  std::mutex mutex_;
+  std::vector<ConstVarTypePtr> types_;
+  std::vector<ConstVarTypePtr> structs_;
+  std::unordered_map<uint32_t, const ast::Function*> declarations_;
+  ast::Arena arena_;
+};
+
+/* @brief Finds the interface of the module called name: name.programi next to
+ * the importing file first, then in each of search_paths.
+ *
+ * @return the path of the interface, empty if there is none
+ */
+std::string findModuleInterface(std::string_view name,
+                                std::string_view importing_file,
+                                std::span<const std::string> search_paths);
+
+}  // namespace frontend
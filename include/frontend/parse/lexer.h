@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace frontend::lexer {
+
+enum class TokenKind : uint8_t {
+  Identifier,  // names and keywords
+  Number,      // unsigned digits with an optional fraction, signs are
+               // separate punctuators
+  Punctuator,  // operators, brackets, separators
+};
+
+// A token refers to its text by byte offset into the source, so the token
+// array stays compact and never owns any strings.
+struct Token {
+  TokenKind kind;
+  uint32_t offset;
+  uint32_t length;
+  uint32_t line;
+};
+
+/* @brief Splits a source buffer into tokens, dropping whitespace and
+ * "//" comments.
+ *
+ * @param source the whole source file
+ *
+ * @return the tokens in source order
+ */
+std::vector<Token> tokenize(std::string_view source);
+
+/* @brief Renders tokens back into a normalized source buffer.
+ *
+ * Every run of whitespace and comments between two tokens is replaced by a
+ * single space, or by one newline per source line crossed, so the grammar
+ * sees the same token boundaries and line numbers as in the original source
+ * but never has to re-scan comments or long whitespace runs.
+ *
+ * @param source the buffer the tokens were produced from
+ * @param tokens the result of tokenize(source), or a contiguous part of it
+ * @param line the line number at offset
+ * @param offset where rendering starts in source, at or before the first token
+ */
+std::string renderTokens(std::string_view source,
+                         std::span<const Token> tokens, uint32_t line = 1,
+                         size_t offset = 0);
+
+// A top-level struct or function definition, from the end of the previous
+// definition up to and including its closing brace. The first one also holds
+// the import declarations before it.
+struct Definition {
+  size_t begin;
+  size_t end;
+  uint32_t line;  // line number at begin
+  bool is_struct;
+  std::span<const Token> tokens;
+};
+
+/* @brief Splits a source buffer at the closing braces that end top-level
+ * definitions. Comments produce no tokens, so braces inside them are
+ * ignored. Anything after the last definition stays with it.
+ *
+ * @param source the whole source file
+ * @param tokens the result of tokenize(source)
+ *
+ * @return the definitions in source order, empty if there is no top-level
+ * closing brace
+ */
+std::vector<Definition> splitDefinitions(std::string_view source,
+                                         std::span<const Token> tokens);
+
+/* @brief Returns the modules named by the import declarations that open a
+ * source buffer, in source order.
+ *
+ * @param source the whole source file
+ * @param tokens the result of tokenize(source)
+ */
+std::vector<std::string_view> importedModules(std::string_view source,
+                                              std::span<const Token> tokens);
+
+inline std::string_view tokenText(std::string_view source, const Token& tok) {
+  return source.substr(tok.offset, tok.length);
+}
+
+}  // namespace frontend::lexer
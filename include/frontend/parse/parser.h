@@ -1,6 +1,58 @@
 #pragma once
 
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "frontend/ast/ast.h"
+#include "frontend/compilation_context.h"
+#include "frontend/parse/lexer.h"
 namespace frontend {
-Program parseFile(const char* file_name);
-}
+
+struct ParseOptions {
+  // tokenize the source first (see lexer.h) and run the grammar over the
+  // normalized token stream instead of the raw characters
+  bool use_lexer = false;
+  // memoize statement, expression and type rules by (rule, position) so the
+  // grammar's lookaheads never re-match the same input
+  bool memoize = false;
+  // > 1 splits the file at top-level definitions and parses the functions
+  // on this many threads, calls may then refer to functions defined later
+  unsigned num_threads = 1;
+  // where imported module interfaces are looked for when they are not next
+  // to the importing file
+  std::vector<std::string> module_paths;
+};
+
+struct ParseStats {
+  uint64_t rule_invocations = 0;  // every grammar rule match attempted
+  uint64_t memo_hits = 0;         // attempts answered from the memo table
+};
+
+/* @brief Parses a source file, types are created in compilation.
+ */
+Program parseFile(CompilationContext& compilation, const char* file_name,
+                  const ParseOptions& options = {},
+                  ParseStats* stats = nullptr);
+
+/* @brief Parses some of the top-level definitions of a source buffer.
+ *
+ * Structs are parsed before functions. Calls to functions that are not among
+ * the parsed definitions get their types from known_functions or from the
+ * imported modules.
+ *
+ * @param source the whole source file, used for positions and line numbers
+ * @param definitions parts of lexer::splitDefinitions(source, ...)
+ * @param imports lexer::importedModules(source, ...), whether or not the
+ * first definition is among the parsed ones
+ * @param known_functions already parsed functions that may be called
+ */
+Program parseDefinitions(CompilationContext& compilation,
+                         std::string_view source, const char* file_name,
+                         std::span<const lexer::Definition> definitions,
+                         std::span<const std::string_view> imports,
+                         std::span<const ast::Function* const> known_functions,
+                         const ParseOptions& options = {});
+}  // namespace frontend
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string_view>
+
+namespace frontend {
+
+// An interned identifier or type name: a 32-bit index into a process-wide
+// string table. Two symbols are equal exactly when their text is, so
+// comparing and hashing them never touches the characters. Symbols order by
+// when they were first interned, not alphabetically.
+class Symbol {
+ public:
+  // the empty string
+  Symbol() = default;
+  /* @brief Interns text, copying it into the table the first time it is seen.
+   * Safe to call from several threads, only a text seen for the first time
+   * takes a lock.
+   */
+  explicit Symbol(std::string_view text);
+
+  /// the interned text, valid for the lifetime of the process, read without a
+  /// lock
+  [[nodiscard]] std::string_view str() const;
+  [[nodiscard]] uint32_t id() const { return id_; }
+  [[nodiscard]] bool empty() const { return id_ == 0; }
+
+  auto operator<=>(const Symbol&) const = default;
+
+  /// number of distinct strings interned so far, the empty one included
+  static size_t tableSize();
+
+ private:
+  uint32_t id_ = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, Symbol symbol);
+
+}  // namespace frontend
+
+template <>
+struct std::hash<frontend::Symbol> {
+  size_t operator()(frontend::Symbol symbol) const noexcept {
+    return symbol.id();
+  }
+};
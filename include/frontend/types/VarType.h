@@ -1,10 +1,14 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "frontend/symbol/Symbol.h"
+
 // forward declare llvm types to avoid including llvm headers
 namespace llvm {
 class Type;
@@ -13,34 +17,62 @@ class LLVMContext;
 
 namespace frontend {
 class VarType;
+class TypeTable;
+class ModuleInterface;
+class DebugInfo;
 using ConstVarTypePtr = std::shared_ptr<const VarType>;
+
+// how a struct declaration asks for its members to be laid out
+struct StructAttributes {
+  // align(N): the struct's objects start at multiples of N, 0 to use the
+  // largest alignment of the members
+  int64_t align = 0;
+  // reorder: the members may be laid out in another order than declared, so
+  // less padding is needed
+  bool reorder = false;
+
+  auto operator<=>(const StructAttributes&) const = default;
+};
+
 class VarType {
  private:
   struct TypeIdentifier;
 
  public:
   using MemberTypes = std::vector<ConstVarTypePtr>;
-  using MemberNameToIndex = std::unordered_map<std::string, int64_t>;
+  using MemberNameToIndex = std::unordered_map<Symbol, int64_t>;
   static constexpr int64_t kNonArrayDim = -1;
   static constexpr int64_t kNonArraySize = -1;
+  using StructAttributes = frontend::StructAttributes;
 
   //
-  // static methods for creating/getting types
+  // static methods for creating/getting types, in the table of one
+  // compilation (see CompilationContext)
   //
-  static ConstVarTypePtr getArrayType(const std::string& type_name,
+  static ConstVarTypePtr getArrayType(TypeTable& table, Symbol type_name,
                                       int64_t n_dims, int64_t n_size,
                                       ConstVarTypePtr& elem_type);
-  static ConstVarTypePtr getAtomicType(const std::string& type_name);
+  /* @brief returns the slice type of elem_type, named type_name (e.g.
+   * "int64[]")
+   *
+   * A slice is a pointer to elements stored elsewhere and their number. It
+   * is held in registers like a number, an { ptr, i64 } pair that is passed
+   * and returned in two registers, so the elements are never copied.
+   */
+  static ConstVarTypePtr getSliceType(TypeTable& table, Symbol type_name,
+                                      const ConstVarTypePtr& elem_type);
+  static ConstVarTypePtr getAtomicType(TypeTable& table, Symbol type_name);
   static ConstVarTypePtr getStructType(
-      const std::string& type_name, const MemberTypes& member_types,
-      const MemberNameToIndex& member_name_to_index);
+      TypeTable& table, Symbol type_name, const MemberTypes& member_types,
+      const MemberNameToIndex& member_name_to_index,
+      const StructAttributes& attributes = {});
 
-  static ConstVarTypePtr getLiteralType(const std::string& type_name);
+  static ConstVarTypePtr getLiteralType(TypeTable& table, Symbol type_name);
 
-  static ConstVarTypePtr findTypeByName(const std::string& type_name);
+  static ConstVarTypePtr findTypeByName(TypeTable& table, Symbol type_name);
 
   //
-  // get types from other types
+  // get types from other types, in the table this type belongs to
   //
   [[nodiscard]] ConstVarTypePtr getRefTypeFrom() const;
   [[nodiscard]] ConstVarTypePtr getPrValueFrom() const;
@@ -53,17 +85,39 @@ class VarType {
 
   /// returns the llvm type corresponding to the variable loaded into register
   ///
-  ///
+  /// Lowered types are cached in the table per context, see
+  /// TypeTable::releaseLlvmTypes.
   llvm::Type* getLlvmInRegType(llvm::LLVMContext& context) const;
 
-  /// returns the llvm type corresponding to the variable in memory (stack)
+  /// returns the llvm type corresponding to the variable in memory (stack),
+  /// a struct is the one identified struct type named after it
   llvm::Type* getLlvmStackAllocTy(llvm::LLVMContext& context) const;
 
+  /// the size of an object in bytes, padding included
+  ///
+  /// Sizes, alignments and member offsets are computed when the type is
+  /// created: every member starts at a multiple of its alignment (an int64
+  /// or reference is aligned to its size, an array to its element, a struct
+  /// to its largest member or align(N)) and a struct's size is a multiple of
+  /// its alignment. Structs are lowered with explicit padding, so the
+  /// target's DataLayout puts every member at the same offset.
   [[nodiscard]] int64_t getObjectSize() const;
 
-  /// returns the element type of an array type
+  /// the alignment of an object in bytes
+  [[nodiscard]] int64_t getAlignment() const { return alignment_; }
+
+  /* @brief returns the offset in bytes of a member of a struct type
+   *
+   * @param member_name the name of the member
+   */
+  [[nodiscard]] int64_t getMemberOffset(Symbol member_name) const;
+
+  /// returns the element type of an array or slice type
   [[nodiscard]] const ConstVarTypePtr& getElemType() const;
 
+  /// returns the number of elements of an array type
+  [[nodiscard]] int64_t getArraySize() const { return type_id_.size; }
+
   /// returns the type that reference points to
   [[nodiscard]] ConstVarTypePtr getReferencedType() const;
 
@@ -71,8 +125,7 @@ class VarType {
    *
    * @param member_name the name of the member
    */
-  [[nodiscard]] const VarType& getMemberType(
-      const std::string& member_name) const;
+  [[nodiscard]] const VarType& getMemberType(Symbol member_name) const;
 
   /* @brief returns the gets the name of the type
    *
@@ -82,13 +135,48 @@ class VarType {
   [[nodiscard]] bool isObject() const;
 
   [[nodiscard]] bool isArray() const;
+  [[nodiscard]] bool isSlice() const;
   [[nodiscard]] bool isStruct() const;
   [[nodiscard]] bool isRef() const;
   [[nodiscard]] bool isPrimitive() const;
   [[nodiscard]] bool isInt() const;
+  [[nodiscard]] bool isBool() const;
+  [[nodiscard]] bool isFloat() const;
+  // an integer, bool or floating-point type
+  [[nodiscard]] bool isNumeric() const;
   [[nodiscard]] bool isVoid() const;
   [[nodiscard]] bool isPrValue() const;
 
+  /// the width of an integer type: 8, 16, 32 or 64, and 1 for bool
+  [[nodiscard]] int getIntBits() const { return int_bits_; }
+  /// whether an integer type is one of int8..int64
+  [[nodiscard]] bool isSigned() const { return is_signed_; }
+  /// the width of a floating-point type: 32 or 64
+  [[nodiscard]] int getFloatBits() const { return float_bits_; }
+
+  // how a numeric value of one type becomes a value of another
+  enum class Conversion {
+    NONE,
+    TRUNC,
+    SEXT,
+    ZEXT,
+    TO_BOOL,  // compares the value with zero
+    FP_TRUNC,
+    FP_EXT,
+    SI_TO_FP,
+    UI_TO_FP,
+    FP_TO_SI,
+    FP_TO_UI,
+  };
+  /* @brief returns the conversion from a numeric type to another
+   *
+   * Narrower integers are extended by the signedness of the source, wider
+   * ones are truncated, and any number converts to bool by comparing it
+   * with zero. Integers and floating-point values convert into each other
+   * by the signedness of the integer type.
+   */
+  static Conversion getConversion(const VarType& from, const VarType& to);
+
   enum class ValCat {
     NONE,
     LValue,
@@ -102,25 +190,36 @@ class VarType {
     REFERENCE,
     ARRAY,
     STRUCTURE,
+    // after the others, module interfaces store the category
+    FLOAT,
+    SLICE,
   };
 
   // Get Category
   [[nodiscard]] ValCat getValueCategory() const;
   [[nodiscard]] TypeCat getTypeCategory() const;
 
+  /* @brief returns the index of the type in its table, in creation order
+   *
+   * Types are interned, so two types of one table are the same type exactly
+   * when their ids (or addresses) are equal.
+   */
+  [[nodiscard]] uint32_t getId() const { return id_; }
+
  private:
   // TODO(ian): TypeIdentifier is unnecessary, type_name should uniquely identify the type via a mangled string
   struct TypeIdentifier {
 
-    explicit TypeIdentifier(std::string type_name,
+    explicit TypeIdentifier(Symbol type_name,
                             int64_t n_dims = VarType::kNonArrayDim,
                             int64_t n_size = VarType::kNonArraySize,
                             TypeCat type_category = TypeCat::NONE,
                             ValCat value_category = ValCat::NONE);
     // general
-    std::string type_name;
+    Symbol type_name;
 
-    // array specific
+    // array specific, an array of n_dims dimensions has size elements of
+    // n_dims - 1 dimensions each, all in one block
     int64_t n_dims;
     int64_t size;
 
@@ -129,15 +228,39 @@ class VarType {
 
     auto operator<=>(const TypeIdentifier&) const = default;
   };
+  struct TypeIdentifierHash {
+    size_t operator()(const TypeIdentifier& id) const;
+  };
 
   // general
   TypeIdentifier type_id_;
+  TypeTable* table_ = nullptr;
+  uint32_t id_ = 0;
+  int64_t object_size_ = kUnknownSize;
+  int64_t alignment_ = 1;
+  // integers and floats only, from the type's name
+  int int_bits_ = 0;
+  bool is_signed_ = false;
+  int float_bits_ = 0;
+  // structs only: the declaration's attributes, the member indices in the
+  // order they are laid out, and each member's offset by index
+  StructAttributes attributes_;
+  std::vector<uint32_t> layout_order_;
+  std::vector<int64_t> member_offsets_;
 
   // specific to complex types
   MemberTypes members_;
   MemberNameToIndex member_name_to_index_;
 
   static constexpr unsigned int kDefaultAddressSpace = 0;
+  static constexpr int64_t kUnknownSize = -1;
+
+  // interns types by their identifier
+  friend class TypeTable;
+  // writes types out as they are and recreates them in another table
+  friend class ModuleInterface;
+  // describes struct and array layouts to the debugger
+  friend class DebugInfo;
 
  public:
   VarType(const VarType&) = delete;
@@ -145,11 +268,61 @@ class VarType {
 
  protected:
   explicit VarType(TypeIdentifier type_identifier, MemberTypes members,
-                   MemberNameToIndex member_name_to_index);
+                   MemberNameToIndex member_name_to_index,
+                   StructAttributes attributes);
 
+  // the members are only copied when the type is new
   static ConstVarTypePtr findVarTypeOrCreate(
-      const TypeIdentifier& type_identifier, MemberTypes members,
-      MemberNameToIndex member_name_to_index);
-  [[nodiscard]] int64_t getStructSize() const;
+      TypeTable& table, const TypeIdentifier& type_identifier,
+      const MemberTypes& members,
+      const MemberNameToIndex& member_name_to_index,
+      const StructAttributes& attributes = {});
+  void computeLayout();
+  void computeStructLayout();
+  llvm::Type* lowerInRegType(llvm::LLVMContext& context) const;
+  llvm::Type* lowerStackAllocTy(llvm::LLVMContext& context) const;
+};
+
+// Every VarType of one compilation. A type is unique within its table, and a
+// table must outlive the ASTs whose types it holds.
+//
+// Types are hash-consed: a lookup hashes the identifier's fields (the name is
+// an interned Symbol, so no string is compared) and finds the type in one
+// probe, however many types the compilation has.
+class TypeTable {
+ public:
+  TypeTable() = default;
+  TypeTable(const TypeTable&) = delete;
+  TypeTable& operator=(const TypeTable&) = delete;
+
+  size_t size() const;
+
+  /* @brief Drops the types lowered in context, which must happen before the
+   * context is destroyed (CodeGenerator does it for its own).
+   */
+  void releaseLlvmTypes(const llvm::LLVMContext& context);
+
+ private:
+  friend class VarType;
+
+  // the types lowered in one LLVMContext, by VarType id
+  struct LlvmTypes {
+    std::vector<llvm::Type*> in_reg;
+    std::vector<llvm::Type*> stack;
+  };
+
+  llvm::Type* findLlvmType(const llvm::LLVMContext& context, uint32_t id,
+                           bool stack) const;
+  void cacheLlvmType(const llvm::LLVMContext& context, uint32_t id, bool stack,
+                     llvm::Type* type);
+
+  // types are created while functions are parsed on several threads
+  mutable std::mutex mutex_;
+  // by VarType id
+  std::vector<ConstVarTypePtr> types_;
+  std::unordered_map<VarType::TypeIdentifier, uint32_t,
+                     VarType::TypeIdentifierHash>
+      index_;
+  std::unordered_map<const llvm::LLVMContext*, LlvmTypes> llvm_types_;
 };
 }  // namespace frontend
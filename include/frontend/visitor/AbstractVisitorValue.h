@@ -4,11 +4,13 @@ namespace frontend {
 namespace ast {
 struct Variable;
 struct Integer;
+struct Float;
 struct FunctionName;
 struct BinaryOperation;
 struct FunctionCall;
 struct ArrayAccess;
 struct ArrayAllocate;
+struct ArrayLength;
 }  // namespace ast
 
 class AbstractVisitorValue {
@@ -20,11 +22,13 @@ class AbstractVisitorValue {
   // ========== Items ==========
   virtual void visit(const ast::Variable* var) = 0;
   virtual void visit(const ast::Integer* num) = 0;
+  virtual void visit(const ast::Float* num) = 0;
   virtual void visit(const ast::FunctionName* func_name) = 0;
   virtual void visit(const ast::BinaryOperation* bin_op) = 0;
   virtual void visit(const ast::FunctionCall* call) = 0;
   virtual void visit(const ast::ArrayAccess* access) = 0;
   virtual void visit(const ast::ArrayAllocate* alloc) = 0;
+  virtual void visit(const ast::ArrayLength* length) = 0;
 };
 
 }  // namespace frontend
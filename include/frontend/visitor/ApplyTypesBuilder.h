@@ -3,6 +3,7 @@
 #include "frontend/ast/ast.h"
 
 namespace frontend {
+class CompilationContext;
 
 // This class assumes that variables have been already assigned a type
 // My attempt at using CRTPish style to make new visitors easier (might have to refactor later)
@@ -10,13 +11,26 @@ class ApplyTypesBuilder
     : public TraverseAst<ApplyTypesBuilder, ast::ConstInstrPtr,
                          ast::ConstValuePtr> {
  public:
+  explicit ApplyTypesBuilder(CompilationContext& compilation);
+
+  // returns a typed copy of program
   Program build_program(const Program& program);
 
+  /* @brief Types program in place.
+   *
+   * Writes the same types build_program would onto the program's own nodes,
+   * so no second tree is allocated and the untyped one is never alive next
+   * to the typed one.
+   */
+  void apply_types(Program& program);
+
  public:
   ast::ConstValuePtr visit_val(const ast::Variable& var,
                                TraverseAst::TraversalState& state);
   ast::ConstValuePtr visit_val(const ast::Integer& num,
                                TraverseAst::TraversalState& state);
+  ast::ConstValuePtr visit_val(const ast::Float& num,
+                               TraverseAst::TraversalState& state);
   ast::ConstValuePtr visit_val(const ast::FunctionName& func_name,
                                TraverseAst::TraversalState& state);
   ast::ConstValuePtr visit_val(const ast::BinaryOperation& bin_op,
@@ -27,6 +41,8 @@ class ApplyTypesBuilder
                                TraverseAst::TraversalState& state);
   ast::ConstValuePtr visit_val(const ast::ArrayAllocate& alloc,
                                TraverseAst::TraversalState& state);
+  ast::ConstValuePtr visit_val(const ast::ArrayLength& length,
+                               TraverseAst::TraversalState& state);
 
   ast::ConstInstrPtr visit_inst(const ast::InstructionReturn& ret,
                                 TraverseAst::TraversalState& state);
@@ -46,6 +62,40 @@ class ApplyTypesBuilder
                                 TraverseAst::TraversalState& state);
   ast::ConstInstrPtr visit_inst(const ast::Scope& scope,
                                 TraverseAst::TraversalState& state);
+
+ private:
+  // the int64 length of an array or slice
+  ConstVarTypePtr arrayLengthType(const ast::Value& array);
+  ConstVarTypePtr arrayAllocateType(const ConstVarTypePtr& elem_type,
+                                    const ast::Value& length);
+  // sets the operand and result types of bin_op from its typed operands
+  void typeBinaryOperation(ast::BinaryOperation& bin_op);
+
+  // in-place typing, children before their parent
+  void annotate(const ast::Value& value);
+  void annotate(const ast::Instruction& inst);
+  void annotate_node(ast::Variable& var);
+  void annotate_node(ast::Integer& num);
+  void annotate_node(ast::Float& num);
+  void annotate_node(ast::FunctionName& func_name);
+  void annotate_node(ast::BinaryOperation& bin_op);
+  void annotate_node(ast::FunctionCall& call);
+  void annotate_node(ast::ArrayAccess& access);
+  void annotate_node(ast::ArrayAllocate& alloc);
+  void annotate_node(ast::ArrayLength& length);
+  void annotate_node(ast::InstructionReturn& ret);
+  void annotate_node(ast::InstructionAssignment& assign);
+  void annotate_node(ast::InstructionFunctionCall& call);
+  void annotate_node(ast::InstructionWhileLoop& loop);
+  void annotate_node(ast::InstructionIfStatement& if_stmt);
+  void annotate_node(ast::InstructionBreak& brk);
+  void annotate_node(ast::InstructionContinue& cont);
+  void annotate_node(ast::InstructionDecl& decl);
+  void annotate_node(ast::Scope& scope);
+
+  CompilationContext& compilation_;
+  // the function being typed in place
+  const ast::Function* function_ = nullptr;
 };
 
 }  // namespace frontend
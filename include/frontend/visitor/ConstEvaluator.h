@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "frontend/ast/ast.h"
+
+namespace frontend {
+
+// bounds on the work done for one call, a call that needs more is left for
+// run time
+struct ConstEvalLimits {
+  uint64_t steps = 1000000;   // values and instructions evaluated
+  uint64_t memory = 1 << 20;  // bytes of locals alive at once
+  uint32_t depth = 256;       // calls nested inside the call
+};
+
+struct ConstEvalStats {
+  size_t folded = 0;   // calls replaced with their result
+  size_t gave_up = 0;  // calls with literal arguments left for run time
+};
+
+/* @brief Replaces calls with literal arguments by the value they return.
+ *
+ * Runs a small interpreter over the typed program: a call whose arguments
+ * are all ast::Integer and whose callee returns an integer becomes an
+ * ast::Integer of the call's type when the callee runs to completion within
+ * limits. The interpreter only has the callee's own locals, integers and
+ * arrays of them, so it gives up on references, floating-point and struct
+ * values and on functions without a body (imported ones). It also gives up
+ * where the generated code would be undefined, an index out of bounds or a
+ * shift by the width or more, so a folded call has no side effects and
+ * returns what it would at run time.
+ *
+ * Arguments are folded before the calls they are passed to, and a callee
+ * runs once per distinct argument list.
+ */
+ConstEvalStats evaluateConstCalls(Program& program,
+                                  const ConstEvalLimits& limits = {});
+
+}  // namespace frontend
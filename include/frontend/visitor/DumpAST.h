@@ -3,9 +3,11 @@
 #include "TraverseAst.h"
 
 namespace frontend {
-class DumpAST : public AbstractVisitorInst, public AbstractVisitorValue {
+class DumpAST final : public AbstractVisitorInst,
+                      public AbstractVisitorValue {
  public:
   explicit DumpAST();
+  explicit DumpAST(std::ostream& stream);
 
   void dump_program(const Program& program);
 
@@ -18,11 +20,13 @@ class DumpAST : public AbstractVisitorInst, public AbstractVisitorValue {
  private:
   void visit(const ast::Variable* var) override;
   void visit(const ast::Integer* num) override;
+  void visit(const ast::Float* num) override;
   void visit(const ast::FunctionName* func_name) override;
   void visit(const ast::BinaryOperation* bin_op) override;
   void visit(const ast::FunctionCall* call) override;
   void visit(const ast::ArrayAccess* access) override;
   void visit(const ast::ArrayAllocate* alloc) override;
+  void visit(const ast::ArrayLength* length) override;
 
   // ========== Instructions ==========
   void visit(const ast::InstructionReturn* ret) override;
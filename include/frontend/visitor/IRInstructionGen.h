@@ -1,6 +1,5 @@
 #pragma once
 
-#include <map>
 
 #include "frontend/ast/ast.h"
 #include "frontend/visitor/AbstractVisitorInst.h"
@@ -12,6 +11,7 @@ class Type;
 class LLVMContext;
 class Value;
 class Module;
+class DISubprogram;
 class ConstantFolder;
 class IRBuilderDefaultInserter;
 
@@ -22,18 +22,21 @@ class IRBuilder;
 
 namespace frontend {
 
-class IRInstructionGen : public AbstractVisitorInst {
+class IRInstructionGen final : public AbstractVisitorInst {
  public:
   IRInstructionGen(llvm::IRBuilder<llvm::ConstantFolder,
                                    llvm::IRBuilderDefaultInserter>& builder,
                    llvm::LLVMContext& context, llvm::Module& module,
-                   std::map<const ast::Variable*, llvm::Value*>& vars);
+                   VariableSlots& vars,
+                   llvm::DISubprogram* subprogram = nullptr);
   llvm::LLVMContext& context_;
   llvm::Module& module_;
   llvm::IRBuilder<llvm::ConstantFolder, llvm::IRBuilderDefaultInserter>&
       builder_;
-  std::map<const ast::Variable*, llvm::Value*>& allocated_variables_;
+  VariableSlots& allocated_variables_;
   IRValueGen value_gen_;
+  // scope of the instructions' source locations, null without debug info
+  llvm::DISubprogram* subprogram_;
 
   llvm::Value* get(const ast::Instruction& i);
   void visit(const ast::InstructionReturn* r) override;
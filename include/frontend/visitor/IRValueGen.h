@@ -1,7 +1,7 @@
 #pragma once
 
 #include <llvm/IR/Instructions.h>
-#include <map>
+#include <vector>
 
 #include "frontend/ast/ast.h"
 #include "frontend/visitor/AbstractVisitorValue.h"
@@ -18,21 +18,24 @@ class IRBuilder;
 
 }  // namespace llvm
 namespace frontend {
-//
-class IRValueGen : AbstractVisitorValue {
+// where each variable of a function is stored, indexed by ast::Variable::index
+// (nullptr until the variable is first used)
+using VariableSlots = std::vector<llvm::Value*>;
+
+class IRValueGen final : AbstractVisitorValue {
  public:
   /* @brief Construct a new IRValueGen object
    *
    * @param builder
    * @param context
    * @param module
-   * @param vars: a map from frontend::Variable to llvm::Value* (pointer to
-   * stack location)
+   * @param vars: the llvm::Value* (pointer to stack location) of every
+   * frontend::Variable of the function, by index
    */
   IRValueGen(llvm::IRBuilder<llvm::ConstantFolder,
                              llvm::IRBuilderDefaultInserter>& builder,
              llvm::LLVMContext& context, llvm::Module& module,
-             std::map<const ast::Variable*, llvm::Value*>& vars);
+             VariableSlots& vars);
 
   /* @brief Generates LLVM IR for reading a frontend::Value.
    *
@@ -42,6 +45,16 @@ class IRValueGen : AbstractVisitorValue {
    */
   llvm::Value* get_loaded_val(const ast::Value* val);
 
+  /* @brief Reads a frontend::Value as a value of type to.
+   *
+   * Numbers are converted (see VarType::getConversion), other values are
+   * only read.
+   */
+  llvm::Value* get_converted_val(const ast::Value* val, const VarType& to);
+
+  // reads a condition as an i1, numbers other than bool are compared with 0
+  llvm::Value* get_condition_val(const ast::Value* val);
+
   llvm::Value* get_val(const ast::Value* value);
 
  private:
@@ -49,15 +62,25 @@ class IRValueGen : AbstractVisitorValue {
       builder_;
   llvm::LLVMContext& context_;
   llvm::Module& module_;
-  std::map<const ast::Variable*, llvm::Value*>& vars_;
+  VariableSlots& vars_;
   llvm::Value* value_ = nullptr;
 
+  llvm::Value* convert(llvm::Value* value, const VarType& from,
+                       const VarType& to);
+  llvm::Value* compare_with_zero(llvm::Value* value);
+  llvm::Value* float_operation(ast::BinOpId op, llvm::Value* lhs,
+                               llvm::Value* rhs);
+  // reads an array index as an i64
+  llvm::Value* get_index_val(const ast::Value* index);
+
   void visit(const ast::Variable* v) override;
   void visit(const ast::Integer* n) override;
+  void visit(const ast::Float* n) override;
   void visit(const ast::FunctionName* b) override;
   void visit(const ast::BinaryOperation* b) override;
   void visit(const ast::FunctionCall* f) override;
   void visit(const ast::ArrayAccess* a) override;
   void visit(const ast::ArrayAllocate* a) override;
+  void visit(const ast::ArrayLength* l) override;
 };
 }  // namespace frontend
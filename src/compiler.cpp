@@ -1,13 +1,52 @@
 #include <llvm/Support/CommandLine.h>
 #include "frontend/ast/ast.h"
 #include "frontend/code_generator.h"
+#include "frontend/compilation_context.h"
+#include "frontend/incremental_build.h"
+#include "frontend/mir/LowerAst.h"
+#include "frontend/mir/mir.h"
+#include "frontend/module/ModuleInterface.h"
 #include "frontend/parse/parser.h"
 #include "frontend/visitor/ApplyTypesBuilder.h"
+#include "frontend/visitor/ConstEvaluator.h"
 #include "frontend/visitor/DumpAST.h"
 
+#include <chrono>
+#include <filesystem>
+#include <iostream>
 #include <string>
+#include <system_error>
+#include <thread>
 
-bool enableDebug;
+namespace {
+// rebuilds whenever the input's modification time changes, never returns
+void watch(const std::string& input, const std::string& output,
+           const frontend::ParseOptions& options, bool debug_info,
+           bool fast_math, frontend::OptLevel opt_level,
+           const std::string& pass_pipeline) {
+  using Clock = std::chrono::steady_clock;
+  frontend::IncrementalBuild build(options, debug_info, fast_math, opt_level,
+                                   pass_pipeline);
+  std::filesystem::file_time_type last_write{};
+  while (true) {
+    std::error_code ec;
+    auto write_time = std::filesystem::last_write_time(input, ec);
+    if (ec || write_time == last_write) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      continue;
+    }
+    last_write = write_time;
+
+    auto start = Clock::now();
+    frontend::IncrementalBuild::Stats stats;
+    if (build.rebuild(input, output, &stats)) {
+      std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+      std::cout << "rebuilt " << stats.rebuilt << " of " << stats.functions
+                << " functions in " << elapsed.count() << " ms" << std::endl;
+    }
+  }
+}
+}  // namespace
 
 int main(int argc, char** argv) {
 
@@ -17,20 +56,131 @@ int main(int argc, char** argv) {
   llvm::cl::opt<std::string> inputFilename(
       "i", llvm::cl::desc("Specify desc filename"),
       llvm::cl::value_desc("filename"));
-  llvm::cl::opt<bool, true> debug("d", llvm::cl::desc("Print debug output"),
-                                  llvm::cl::Hidden,
-                                  llvm::cl::location(enableDebug));
+  llvm::cl::opt<bool> debug("d", llvm::cl::desc("Print debug output"),
+                            llvm::cl::Hidden);
+  llvm::cl::opt<bool> debugInfo(
+      "g", llvm::cl::desc("Emit DWARF debug info mapping code to lines"));
+  llvm::cl::opt<bool> fastMath(
+      "ffast-math",
+      llvm::cl::desc("Let the optimizer reassociate floating-point arithmetic "
+                     "and assume there are no NaNs or infinities"));
+  llvm::cl::opt<frontend::OptLevel> optLevel(
+      llvm::cl::desc("Optimization level (default -O2)"),
+      llvm::cl::values(
+          clEnumValN(frontend::OptLevel::O0, "O0",
+                     "No optimization, fast instruction selection"),
+          clEnumValN(frontend::OptLevel::O1, "O1", "Optimize quickly"),
+          clEnumValN(frontend::OptLevel::O2, "O2", "Optimize for speed"),
+          clEnumValN(frontend::OptLevel::O3, "O3",
+                     "Optimize for speed, also where it grows the code"),
+          clEnumValN(frontend::OptLevel::Os, "Os", "Optimize for size"),
+          clEnumValN(frontend::OptLevel::Oz, "Oz",
+                     "Optimize for size, also at the cost of speed")),
+      llvm::cl::init(frontend::OptLevel::O2));
+  llvm::cl::opt<std::string> passPipeline(
+      "passes",
+      llvm::cl::desc("Run this pipeline of LLVM passes, in the syntax of opt "
+                     "-passes, instead of the one of the -O level"),
+      llvm::cl::value_desc("pipeline"));
+  llvm::cl::opt<bool> constEval(
+      "const-eval",
+      llvm::cl::desc("Evaluate calls whose arguments are all literals at "
+                     "compile time (default on)"),
+      llvm::cl::init(true));
+  llvm::cl::opt<uint64_t> constEvalSteps(
+      "const-eval-steps",
+      llvm::cl::desc("Leave a call for run time after evaluating this many "
+                     "values and instructions"),
+      llvm::cl::init(frontend::ConstEvalLimits{}.steps));
+  llvm::cl::opt<uint64_t> constEvalMemory(
+      "const-eval-memory",
+      llvm::cl::desc("Leave a call for run time when its locals need more "
+                     "bytes than this"),
+      llvm::cl::init(frontend::ConstEvalLimits{}.memory));
+  llvm::cl::opt<bool> useMir(
+      "mir", llvm::cl::desc("Generate LLVM IR through the mid-level IR"));
+  llvm::cl::opt<bool> useLexer(
+      "lex", llvm::cl::desc("Tokenize the source before running the grammar"));
+  llvm::cl::opt<bool> memoize(
+      "memoize", llvm::cl::desc("Memoize grammar rules by input position"));
+  llvm::cl::opt<bool> parseStats(
+      "parse-stats", llvm::cl::desc("Print grammar rule invocation counters"));
+  llvm::cl::opt<unsigned> parseThreads(
+      "parse-threads",
+      llvm::cl::desc("Parse top-level definitions on this many threads"),
+      llvm::cl::init(1));
+  llvm::cl::opt<std::string> emitInterface(
+      "emit-interface",
+      llvm::cl::desc("Also write the module interface other programs import"),
+      llvm::cl::value_desc("filename"));
+  llvm::cl::list<std::string> modulePaths(
+      "module-path",
+      llvm::cl::desc("Look for imported module interfaces in this directory"),
+      llvm::cl::value_desc("directory"));
+  llvm::cl::opt<bool> watchInput(
+      "watch", llvm::cl::desc("Keep running and rebuild only the functions "
+                              "that changed whenever the input is saved"));
   llvm::cl::ParseCommandLineOptions(argc, argv);
 
-  frontend::Program p = frontend::parseFile(inputFilename.c_str());
+  frontend::ParseOptions parseOptions;
+  parseOptions.use_lexer = useLexer;
+  parseOptions.memoize = memoize;
+  parseOptions.num_threads = parseThreads;
+  parseOptions.module_paths.assign(modulePaths.begin(), modulePaths.end());
+  if (watchInput) {
+    watch(inputFilename, outputFilename, parseOptions, debugInfo, fastMath,
+          optLevel, passPipeline);
+  }
+  frontend::CompilationContext compilation;
+  compilation.debug = debug;
+  frontend::ParseStats stats;
+  frontend::Program p = frontend::parseFile(
+      compilation, inputFilename.c_str(), parseOptions,
+      parseStats ? &stats : nullptr);
+  if (parseStats) {
+    std::cout << "rule invocations: " << stats.rule_invocations
+              << "\nmemo hits: " << stats.memo_hits << std::endl;
+  }
+  if (!emitInterface.empty()) {
+    frontend::ModuleInterface::write(p, emitInterface);
+  }
   frontend::DumpAST dumpAst;
-  frontend::ApplyTypesBuilder builder;
-  p = builder.build_program(p);
-  if (enableDebug) {
+  frontend::ApplyTypesBuilder builder(compilation);
+  builder.apply_types(p);
+  if (constEval) {
+    frontend::ConstEvalLimits limits;
+    limits.steps = constEvalSteps;
+    limits.memory = constEvalMemory;
+    frontend::ConstEvalStats evalStats =
+        frontend::evaluateConstCalls(p, limits);
+    if (compilation.debug) {
+      std::cout << "evaluated " << evalStats.folded << " calls, gave up on "
+                << evalStats.gave_up << std::endl;
+    }
+  }
+  if (compilation.debug) {
     dumpAst.dump_program(p);
   }
-  frontend::CodeGenerator cg;
-  cg.generateCode(p, outputFilename);
+  frontend::CodeGenerator cg(compilation);
+  cg.setOptLevel(optLevel);
+  if (debugInfo) {
+    cg.emitDebugInfo(inputFilename);
+  }
+  if (fastMath) {
+    cg.enableFastMath();
+  }
+  if (!passPipeline.empty()) {
+    cg.setPassPipeline(passPipeline);
+  }
+  if (useMir) {
+    frontend::mir::Module m = frontend::mir::lowerProgram(p);
+    if (compilation.debug) {
+      frontend::mir::print(m, std::cout);
+    }
+    cg.generateCode(m, outputFilename);
+  } else {
+    cg.generateCode(p, outputFilename);
+  }
 
   return 0;
 }
@@ -0,0 +1,50 @@
+#include "frontend/ast/Arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace frontend::ast {
+
+Arena::~Arena() {
+  for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+    it->destroy(it->node);
+  }
+}
+
+void* Arena::allocate(size_t size, size_t align) {
+  auto address = reinterpret_cast<uintptr_t>(next_);
+  size_t padding = (align - address % align) % align;
+  if (next_ == nullptr ||
+      padding + size > static_cast<size_t>(end_ - next_)) {
+    // nodes larger than a block get a block of their own
+    size_t block_size = std::max(kBlockSize, size + align);
+    blocks_.push_back(std::make_unique<std::byte[]>(block_size));
+    next_ = blocks_.back().get();
+    end_ = next_ + block_size;
+    address = reinterpret_cast<uintptr_t>(next_);
+    padding = (align - address % align) % align;
+  }
+  std::byte* memory = next_ + padding;
+  next_ = memory + size;
+  bytes_allocated_ += size;
+  return memory;
+}
+
+void Arena::adopt(Arena&& other) {
+  blocks_.insert(blocks_.end(), std::make_move_iterator(other.blocks_.begin()),
+                 std::make_move_iterator(other.blocks_.end()));
+  destructors_.insert(destructors_.end(), other.destructors_.begin(),
+                      other.destructors_.end());
+  bytes_allocated_ += other.bytes_allocated_;
+  other.blocks_.clear();
+  other.destructors_.clear();
+  other.next_ = nullptr;
+  other.end_ = nullptr;
+  other.bytes_allocated_ = 0;
+}
+
+}  // namespace frontend::ast
@@ -1,9 +1,10 @@
 #include "frontend/ast/ast.h"
 
 #include <cstdint>
-#include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -12,7 +13,7 @@
 #include "frontend/visitor/AbstractVisitorValue.h"
 
 namespace frontend::ast {
-BinOpId stringToBinop(const std::string& op) {
+BinOpId stringToBinop(std::string_view op) {
   if (op == "+")
     return ADD;
   if (op == "*")
@@ -36,7 +37,7 @@ BinOpId stringToBinop(const std::string& op) {
   if (op == "==")
     return EQ;
 
-  FRONTEND_ERROR("Unknown binop: " + op);
+  FRONTEND_ERROR("Unknown binop: " + std::string(op));
 }
 std::string binopToString(BinOpId op) {
   switch (op) {
@@ -66,16 +67,54 @@ std::string binopToString(BinOpId op) {
       return "none";
   }
 }
-void Scope::accept(AbstractVisitorInst* v) const {
-  v->visit(this);
+int binopPrecedence(BinOpId op) {
+  switch (op) {
+    case MUL:
+      return 6;
+    case ADD:
+    case SUB:
+      return 5;
+    case SHL:
+    case SHR:
+      return 4;
+    case LT:
+    case GT:
+    case LEQ:
+    case GEQ:
+      return 3;
+    case EQ:
+      return 2;
+    case AND:
+      return 1;
+    default:
+      FRONTEND_ERROR("no precedence for binop: " + binopToString(op));
+  }
 }
 
 Value::~Value() = default;
 
+void Value::accept(AbstractVisitorValue* v) const {
+  switch (kind) {
+#define AST_VALUE_NODE(name) \
+  case ValueKind::name:      \
+    return v->visit(static_cast<const name*>(this));
+#include "frontend/ast/ASTNodes.def"
+  }
+}
+
+void Instruction::accept(AbstractVisitorInst* v) const {
+  switch (kind) {
+#define AST_INSTRUCTION_NODE(name) \
+  case InstructionKind::name:      \
+    return v->visit(static_cast<const name*>(this));
+#include "frontend/ast/ASTNodes.def"
+  }
+}
+
 // anonymous namespace
 namespace {
-// https://stackoverflow.com/questions/8147027/how-do-i-call-stdmake-shared-on-a-class-with-only-protected-or-private-const/8147213#8147213
-// 20.7.2.2.6 shared_ptr creation [util.smartptr.shared.get], paragraph 1
+// variables are only made through Function::getVariable, the arena needs a
+// public constructor
 class DerivedVariable : public Variable {
  public:
   DerivedVariable() = default;
@@ -83,134 +122,73 @@ class DerivedVariable : public Variable {
 };
 }  // namespace
 
-std::map<const Function*, std::map<std::string, std::shared_ptr<Variable>>>
-    Variable::variables_;
-std::shared_ptr<Variable> Variable::get(const std::string& name,
-                                        const Function* f) {
-  if (variables_.find(f) == variables_.end()) {
-    variables_[f] = std::map<std::string, std::shared_ptr<Variable>>();
-  }
-
-  if (variables_[f].find(name) == variables_[f].end()) {
-    auto newVar = std::make_shared<DerivedVariable>();
-    newVar->name = name;
-    variables_[f][name] = std::move(newVar);
+Variable* Function::getVariable(Symbol name, Arena& arena) {
+  Variable*& var = variables[name];
+  if (var == nullptr) {
+    var = arena.make<DerivedVariable>();
+    var->name = name;
+    var->index = static_cast<uint32_t>(variables.size() - 1);
   }
-  return variables_[f][name];
+  return var;
 }
 
-Integer::Integer(int64_t value)
-    : value(value), Value(VarType::getLiteralType("int64")) {}
-
-// ========================
-// define all the accept functions from ast.h here
-// ========================
-
 // ========== Items ==========
-void Variable::accept(AbstractVisitorValue* v) const {
-  v->visit(this);
-}
+Integer::Integer(int64_t value, ConstVarTypePtr type)
+    : value(value), Value(kKind, std::move(type)) {}
 
-void Integer::accept(AbstractVisitorValue* v) const {
-  v->visit(this);
-}
-
-FunctionName::FunctionName(std::string&& name, ConstVarTypePtr ret)
-    : name(std::move(name)), return_type(std::move(ret)) {}
+Float::Float(double value, ConstVarTypePtr type)
+    : Value(kKind, std::move(type)), value(value) {}
 
-void FunctionName::accept(AbstractVisitorValue* v) const {
-  v->visit(this);
-}
+FunctionName::FunctionName(Symbol name, ConstVarTypePtr ret)
+    : Value(kKind), name(name), return_type(std::move(ret)) {}
 
-FunctionCall::FunctionCall(ConstValuePtr&& function,
+FunctionCall::FunctionCall(ConstValuePtr function,
                            std::vector<ConstValuePtr>&& args)
-    : function(std::move(function)), args(std::move(args)) {}
+    : Value(kKind), function(function), args(std::move(args)) {}
 
-void FunctionCall::accept(AbstractVisitorValue* v) const {
-  v->visit(this);
-}
+BinaryOperation::BinaryOperation(BinOpId op, ConstValuePtr lhs,
+                                 ConstValuePtr rhs)
+    : Value(kKind), op(op), lhs(lhs), rhs(rhs) {}
 
-BinaryOperation::BinaryOperation(BinOpId op, ConstValuePtr&& lhs,
-                                 ConstValuePtr&& rhs)
-    : op(op), lhs(std::move(lhs)), rhs(std::move(rhs)) {}
-
-void BinaryOperation::accept(AbstractVisitorValue* v) const {
-  v->visit(this);
+ArrayAccess::ArrayAccess(ConstValuePtr var,
+                         std::vector<ConstValuePtr>&& indices,
+                         uint64_t line_number)
+    : Value(kKind), var(var), indices(std::move(indices)) {
+  line = static_cast<uint32_t>(line_number);
 }
 
-ArrayAccess::ArrayAccess(ConstValuePtr&& var,
-                         std::vector<ConstValuePtr>&& indices, uint64_t)
-    : var(std::move(var)), indices(std::move(indices)) {}
-
-void ArrayAccess::accept(AbstractVisitorValue* v) const {
-  v->visit(this);
-}
+ArrayAllocate::ArrayAllocate(ConstValuePtr length, ConstValuePtr elem_value)
+    : Value(kKind), length(length), elem_value(elem_value) {}
 
-ArrayAllocate::ArrayAllocate(ConstValuePtr&& length, ConstValuePtr&& elem_value)
-    : length(std::move(length)), elem_value(std::move(elem_value)) {}
-
-void ArrayAllocate::accept(AbstractVisitorValue* v) const {
-  v->visit(this);
-}
-
-InstructionReturn::InstructionReturn(ConstValuePtr&& val)
-    : val(std::move(val)) {}
-
-InstructionReturn::InstructionReturn() : val(nullptr) {}
+ArrayLength::ArrayLength(ConstValuePtr array) : Value(kKind), array(array) {}
 
 // ========== Instructions ==========
-void InstructionReturn::accept(AbstractVisitorInst* v) const {
-  v->visit(this);
-}
+InstructionReturn::InstructionReturn(ConstValuePtr val)
+    : Instruction(kKind), val(val) {}
 
-InstructionAssignment::InstructionAssignment(ConstValuePtr&& dst,
-                                             ConstValuePtr&& src)
-    : dst(std::move(dst)), src(std::move(src)) {}
+InstructionReturn::InstructionReturn() : Instruction(kKind), val(nullptr) {}
 
-void InstructionAssignment::accept(AbstractVisitorInst* v) const {
-  v->visit(this);
-}
+InstructionAssignment::InstructionAssignment(ConstValuePtr dst,
+                                             ConstValuePtr src)
+    : Instruction(kKind), dst(dst), src(src) {}
 
-InstructionFunctionCall::InstructionFunctionCall(ConstValuePtr&& function_call)
-    : function_call(function_call) {}
+InstructionFunctionCall::InstructionFunctionCall(ConstValuePtr function_call)
+    : Instruction(kKind), function_call(function_call) {}
 
-void InstructionFunctionCall::accept(AbstractVisitorInst* v) const {
-  v->visit(this);
-}
-
-InstructionWhileLoop::InstructionWhileLoop(ConstValuePtr&& cond,
-                                           ConstInstrPtr&& body)
-    : cond(std::move(cond)), body(std::move(body)) {}
-
-void InstructionWhileLoop::accept(AbstractVisitorInst* v) const {
-  v->visit(this);
-}
-
-InstructionIfStatement::InstructionIfStatement(ConstValuePtr&& cond,
-                                               ConstInstrPtr&& true_scope)
-    : cond(std::move(cond)), true_scope(std::move(true_scope)) {}
-
-void InstructionIfStatement::accept(AbstractVisitorInst* v) const {
-  v->visit(this);
-}
-
-void InstructionBreak::accept(AbstractVisitorInst* v) const {
-  v->visit(this);
-}
+InstructionWhileLoop::InstructionWhileLoop(ConstValuePtr cond,
+                                           ConstInstrPtr body)
+    : Instruction(kKind), cond(cond), body(body) {}
 
-void InstructionContinue::accept(AbstractVisitorInst* v) const {
-  v->visit(this);
-}
+InstructionIfStatement::InstructionIfStatement(ConstValuePtr cond,
+                                               ConstInstrPtr true_scope)
+    : Instruction(kKind), cond(cond), true_scope(true_scope) {}
 
-InstructionDecl::InstructionDecl(std::vector<ValuePtr>&& vars) {
+InstructionDecl::InstructionDecl(std::vector<ValuePtr>&& vars)
+    : Instruction(kKind) {
   for (auto& var : vars) {
     this->variables.push_back(std::move(var));
   }
   vars.clear();
 }
 
-void InstructionDecl::accept(AbstractVisitorInst* v) const {
-  v->visit(this);
-}
-
 }  // namespace frontend::ast
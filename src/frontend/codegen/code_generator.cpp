@@ -2,7 +2,12 @@
 
 #include <llvm/Analysis/CGSCCPassManager.h>
 #include <llvm/Analysis/LoopAnalysisManager.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/Attributes.h>
 #include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/DebugLoc.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/GlobalValue.h>
@@ -11,74 +16,304 @@
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Linker/Linker.h>
 #include <llvm/MC/TargetRegistry.h>
 #include <llvm/Passes/OptimizationLevel.h>
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Support/CodeGen.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Error.h>
 #include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
 
 #include <cstdlib>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <system_error>
 #include <vector>
 
 #include "frontend/ast/ast.h"
+#include "frontend/compilation_context.h"
+#include "frontend/debug_info.h"
 #include "frontend/diagnostic/debug.h"
+#include "frontend/mir/IRMirGen.h"
 #include "frontend/visitor/IRInstructionGen.h"
 
 namespace frontend {
-CodeGenerator::CodeGenerator()
-    : module_("my compiler!!!", context_), builder_(context_) {}
+namespace {
+// the target registry is process-wide, compilations on several threads share it
+void initializeTargets() {
+  static std::once_flag initialized;
+  std::call_once(initialized, [] {
+    llvm::InitializeAllTargetInfos();
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllTargetMCs();
+    llvm::InitializeAllAsmParsers();
+    llvm::InitializeAllAsmPrinters();
+  });
+}
+
+// 1-based position of the parameter called name, 0 for a local
+unsigned argNumber(const ast::Function& f, Symbol name) {
+  for (size_t i = 0; i < f.args.size(); i++) {
+    if (ast::cast<ast::Variable>(f.args[i])->name == name) {
+      return static_cast<unsigned>(i + 1);
+    }
+  }
+  return 0;
+}
+
+// how an integer argument or result of type is extended in its register
+std::optional<llvm::Attribute::AttrKind> extensionAttribute(
+    const VarType& type) {
+  if (!type.isInt() || type.getIntBits() >= 32) {
+    return std::nullopt;
+  }
+  return type.isSigned() ? llvm::Attribute::SExt : llvm::Attribute::ZExt;
+}
+
+// the function attributes clang sets for -ffast-math, the backend reads them
+// per function
+constexpr const char* kFastMathAttributes[] = {
+    "unsafe-fp-math", "no-infs-fp-math", "no-nans-fp-math",
+    "no-signed-zeros-fp-math", "approx-func-fp-math"};
+
+llvm::OptimizationLevel passBuilderLevel(OptLevel level) {
+  switch (level) {
+    case OptLevel::O0:
+      return llvm::OptimizationLevel::O0;
+    case OptLevel::O1:
+      return llvm::OptimizationLevel::O1;
+    case OptLevel::O2:
+      return llvm::OptimizationLevel::O2;
+    case OptLevel::O3:
+      return llvm::OptimizationLevel::O3;
+    case OptLevel::Os:
+      return llvm::OptimizationLevel::Os;
+    case OptLevel::Oz:
+      return llvm::OptimizationLevel::Oz;
+  }
+  FRONTEND_ERROR("unknown optimization level");
+}
+
+// variables the parser did not place are put at the function's line
+uint32_t declarationLine(const ast::Function& f, const ast::Variable& var) {
+  return var.line != 0 ? var.line : f.line;
+}
+}  // namespace
+
+llvm::CodeGenOpt::Level codegenOptLevel(OptLevel level) {
+  switch (level) {
+    case OptLevel::O0:
+      return llvm::CodeGenOpt::None;
+    case OptLevel::O1:
+      return llvm::CodeGenOpt::Less;
+    case OptLevel::O3:
+      return llvm::CodeGenOpt::Aggressive;
+    default:
+      return llvm::CodeGenOpt::Default;
+  }
+}
+
+CodeGenerator::CodeGenerator(CompilationContext& compilation)
+    : compilation_(compilation),
+      module_("my compiler!!!", context_),
+      builder_(context_) {
+  setupTarget();
+}
+
+CodeGenerator::~CodeGenerator() {
+  // the types lowered in context_ go with it
+  compilation_.types().releaseLlvmTypes(context_);
+}
+
+void CodeGenerator::emitDebugInfo(const std::string& source_file) {
+  debug_info_ = std::make_unique<DebugInfo>(module_, source_file,
+                                            opt_level_ != OptLevel::O0);
+}
+
+void CodeGenerator::enableFastMath() {
+  fast_math_ = true;
+  // every floating-point instruction the builder creates gets the flags
+  builder_.setFastMathFlags(llvm::FastMathFlags::getFast());
+}
+
+void CodeGenerator::setOptLevel(OptLevel level) {
+  opt_level_ = level;
+  target_machine_->setOptLevel(codegenOptLevel(level));
+  // the backend would pick FastISel at CodeGenOpt::None itself, this keeps
+  // it from depending on the target's default
+  target_machine_->setFastISel(level == OptLevel::O0);
+}
+
+void CodeGenerator::setPassPipeline(const std::string& pipeline) {
+  pass_pipeline_ = pipeline;
+}
+
 void CodeGenerator::generateCode(const Program& program,
                                  const std::string& output_filename) {
   /*
    * Generate target code
    */
+  // declare everything first so calls do not depend on definition order
+  for (const auto& f : program.imported_functions) {
+    declareFunction(*f);
+  }
   for (const auto& f : program.functions) {
-    // generate function declaration
-
-    auto allocatedVariables = functionSetup(f);
-    IRInstructionGen irgen(builder_, context_, module_, allocatedVariables);
-    generateLLVMIR(f, irgen);
+    declareFunction(*f);
+  }
+  for (const auto& f : program.functions) {
+    generateFunction(f);
   }
 
   // module_.print(llvm::errs(), nullptr);
 
-  llvmVerifyGeneratedIr();
+  optimize();
+
+  emitObjectFile(output_filename);
+  // module_.print(llvm::errs(), nullptr);
+}
 
+void CodeGenerator::generateCode(const mir::Module& m,
+                                 const std::string& output_filename) {
+  for (const auto* f : m.declarations) {
+    declareFunction(*f);
+  }
+  for (const auto& f : m.functions) {
+    declareFunction(*f.source);
+  }
+  for (const auto& f : m.functions) {
+    generateFunction(f);
+  }
+  optimize();
+  emitObjectFile(output_filename);
+}
+
+void CodeGenerator::declareFunction(const ast::Function& f) {
+  if (module_.getFunction(f.name.str())) {
+    return;
+  }
+  std::vector<llvm::Type*> argLlvmTypes(f.args.size());
+  for (int i = 0; i < f.args.size(); i++) {
+    argLlvmTypes[i] = f.args[i]->type->getLlvmInRegType(context_);
+  }
+  if (f.type->isArray() || f.type->isStruct()) {
+    // last parameter is the address of the returned object
+    argLlvmTypes.push_back(f.type->getLlvmInRegType(context_));
+  }
+
+  llvm::Type* llvmRetType = f.type->getLlvmInRegType(context_);
+  llvm::FunctionType* functionType =
+      llvm::FunctionType::get(llvmRetType, argLlvmTypes, false);
+  llvm::Function* function = llvm::Function::Create(
+      functionType, llvm::Function::ExternalLinkage, f.name.str(), module_);
+  // integers narrower than 32 bits are extended in registers like C does
+  for (int i = 0; i < f.args.size(); i++) {
+    if (auto kind = extensionAttribute(*f.args[i]->type)) {
+      function->addParamAttr(i, *kind);
+    }
+  }
+  if (auto kind = extensionAttribute(*f.type)) {
+    function->addRetAttr(*kind);
+  }
+  if (fast_math_) {
+    for (const char* attribute : kFastMathAttributes) {
+      function->addFnAttr(attribute, "true");
+    }
+  }
+  // the size levels are read per function by the optimizer and the backend,
+  // like clang's -Os and -Oz
+  if (opt_level_ == OptLevel::Os || opt_level_ == OptLevel::Oz) {
+    function->addFnAttr(llvm::Attribute::OptimizeForSize);
+  }
+  if (opt_level_ == OptLevel::Oz) {
+    function->addFnAttr(llvm::Attribute::MinSize);
+  }
+}
+
+void CodeGenerator::generateFunction(ast::ConstFunctionPtr f) {
+  llvm::DISubprogram* subprogram = describeFunction(*f);
+  auto allocatedVariables = functionSetup(f);
+  IRInstructionGen irgen(builder_, context_, module_, allocatedVariables,
+                         subprogram);
+  generateLLVMIR(f, irgen);
+  if (subprogram != nullptr) {
+    declareVariables(*f, allocatedVariables, subprogram);
+  }
+}
+
+void CodeGenerator::generateFunction(const mir::Function& f) {
+  declareFunction(*f.source);
+  llvm::DISubprogram* subprogram = describeFunction(*f.source);
+  IRMirGen irgen(builder_, context_, module_);
+  irgen.generate(f, subprogram);
+  if (subprogram != nullptr) {
+    declareSlots(f, irgen.slots(), subprogram);
+  }
+}
+
+void CodeGenerator::optimize() {
+  if (debug_info_) {
+    debug_info_->finalize();
+  }
+  llvmVerifyGeneratedIr();
   llvmOptimPass();
+}
+
+llvm::SmallVector<char, 0> CodeGenerator::writeBitcode() const {
+  llvm::SmallVector<char, 0> buffer;
+  llvm::raw_svector_ostream out(buffer);
+  llvm::WriteBitcodeToFile(module_, out);
+  return buffer;
+}
+
+void CodeGenerator::linkBitcode(llvm::StringRef bitcode) {
+  auto module = llvm::parseBitcodeFile(
+      llvm::MemoryBufferRef(bitcode, "cached function"), context_);
+  if (!module) {
+    FRONTEND_ERROR(llvm::toString(module.takeError()));
+  }
+  if (llvm::Linker::linkModules(module_, std::move(*module))) {
+    FRONTEND_ERROR("could not link cached function");
+  }
+}
 
-  llvmCodegenPass(output_filename + ".asm",
-                  llvm::CodeGenFileType::CGFT_AssemblyFile);
+void CodeGenerator::emitObjectFile(const std::string& filename) {
+  llvmCodegenPass(filename + ".asm", llvm::CodeGenFileType::CGFT_AssemblyFile);
 
-  llvmCodegenPass(output_filename, llvm::CodeGenFileType::CGFT_ObjectFile);
-  // module_.print(llvm::errs(), nullptr);
+  llvmCodegenPass(filename, llvm::CodeGenFileType::CGFT_ObjectFile);
 }
 
 void CodeGenerator::llvmVerifyGeneratedIr() const {
-  DEBUG_PRINT("==========================================\n");
-  DEBUG_PRINT("Verifying correctness of generated LLVM IR\n");
+  DEBUG_PRINT(compilation_.debug, "========================================\n");
+  DEBUG_PRINT(compilation_.debug, "Verifying correctness of generated IR\n");
   bool isError = llvm::verifyModule(module_, &llvm::errs());
   (void)isError;
   assert(!isError);
 }
 
 void CodeGenerator::llvmOptimPass() {
-  DEBUG_PRINT("==========================================\n");
-  DEBUG_PRINT("running opt passes ............\n");
+  DEBUG_PRINT(compilation_.debug, "========================================\n");
+  DEBUG_PRINT(compilation_.debug, "running opt passes ............\n");
+  if (opt_level_ == OptLevel::O0 && pass_pipeline_.empty()) {
+    // not even the O0 pipeline, the IR is already what the backend needs
+    return;
+  }
   // llvm::FunctionPassManager fpm;
   llvm::LoopAnalysisManager loopAnalysisManager;
   llvm::FunctionAnalysisManager functionAnalysisManager;
   llvm::CGSCCAnalysisManager cgsccAnalysisManager;
   llvm::ModuleAnalysisManager moduleAnalysisManager;
 
-  llvm::PassBuilder pb;
+  // the target's cost model decides what the vectorizers do, without it
+  // they see no vector registers
+  llvm::PassBuilder pb(target_machine_.get());
 
   // Register all the basic analyses with the managers.
   pb.registerModuleAnalyses(moduleAnalysisManager);
@@ -89,22 +324,24 @@ void CodeGenerator::llvmOptimPass() {
                           cgsccAnalysisManager, moduleAnalysisManager);
 
   // Create the pass manager.
-  // This one corresponds to a typical -O2 optimization pipeline.
-  llvm::ModulePassManager optimizePassManager =
-      pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2);
+  llvm::ModulePassManager optimizePassManager;
+  if (!pass_pipeline_.empty()) {
+    if (llvm::Error err =
+            pb.parsePassPipeline(optimizePassManager, pass_pipeline_)) {
+      FRONTEND_ERROR("invalid pass pipeline: " +
+                     llvm::toString(std::move(err)));
+    }
+  } else {
+    optimizePassManager =
+        pb.buildPerModuleDefaultPipeline(passBuilderLevel(opt_level_));
+  }
   optimizePassManager.run(module_, moduleAnalysisManager);
 }
 
-void CodeGenerator::llvmCodegenPass(const std::string& filename,
-                                    llvm::CodeGenFileType file_type) {
-  //  Initialize the target registry etc.
-  llvm::InitializeAllTargetInfos();
-  llvm::InitializeAllTargets();
-  llvm::InitializeAllTargetMCs();
-  llvm::InitializeAllAsmParsers();
-  llvm::InitializeAllAsmPrinters();
+void CodeGenerator::setupTarget() {
+  initializeTargets();
   auto targetTriple = llvm::sys::getDefaultTargetTriple();
-  DEBUG_PRINT("target triple: " << target_triple << "\n");
+  DEBUG_PRINT(compilation_.debug, "target triple: " << targetTriple << "\n");
   // target_triple = "x86_64-pc-linux-gnu";
 
   const auto* cpu = "generic";
@@ -118,12 +355,15 @@ void CodeGenerator::llvmCodegenPass(const std::string& filename,
   }
 
   llvm::TargetOptions opt;
-  llvm::TargetMachine* targetMachine = target->createTargetMachine(
-      targetTriple, cpu, features, opt, llvm::Reloc::PIC_);
+  target_machine_.reset(target->createTargetMachine(
+      targetTriple, cpu, features, opt, llvm::Reloc::PIC_));
 
-  module_.setDataLayout(targetMachine->createDataLayout());
+  module_.setDataLayout(target_machine_->createDataLayout());
   module_.setTargetTriple(targetTriple);
+}
 
+void CodeGenerator::llvmCodegenPass(const std::string& filename,
+                                    llvm::CodeGenFileType file_type) {
   std::error_code errorCode;
   llvm::raw_fd_ostream dest(filename, errorCode, llvm::sys::fs::OF_None);
 
@@ -133,7 +373,7 @@ void CodeGenerator::llvmCodegenPass(const std::string& filename,
 
   llvm::legacy::PassManager pass;
 
-  if (targetMachine->addPassesToEmitFile(pass, dest, nullptr, file_type)) {
+  if (target_machine_->addPassesToEmitFile(pass, dest, nullptr, file_type)) {
     FRONTEND_ERROR("target_machine can't emit a file of this type\n");
     exit(1);
   }
@@ -142,27 +382,14 @@ void CodeGenerator::llvmCodegenPass(const std::string& filename,
   dest.flush();
 }
 
-void CodeGenerator::generateLLVMIR(const ast::FunctionPtr& f,
+void CodeGenerator::generateLLVMIR(ast::ConstFunctionPtr f,
                                    IRInstructionGen& irgen) {
-  irgen.get(*f->scope.get());
+  irgen.get(*f->scope);
 }
 
-std::map<const ast::Variable*, llvm::Value*> CodeGenerator::functionSetup(
-    const ast::FunctionPtr& f) {
-  std::vector<llvm::Type*> argLlvmTypes(f->args.size());
-  for (int i = 0; i < f->args.size(); i++) {
-    argLlvmTypes[i] = f->args[i]->type->getLlvmInRegType(context_);
-  }
-  if (f->type->isArray() || f->type->isStruct()) {
-    // last parameter is the address of the returned object
-    argLlvmTypes.push_back(f->type->getLlvmInRegType(context_));
-  }
-
-  llvm::Type* llvmRetType = f->type->getLlvmInRegType(context_);
-  llvm::FunctionType* functionType =
-      llvm::FunctionType::get(llvmRetType, argLlvmTypes, false);
-  llvm::Function* llvmFunc = llvm::Function::Create(
-      functionType, llvm::Function::ExternalLinkage, f->name, module_);
+VariableSlots CodeGenerator::functionSetup(ast::ConstFunctionPtr f) {
+  declareFunction(*f);
+  llvm::Function* llvmFunc = module_.getFunction(f->name.str());
 
   // entry block
   llvm::BasicBlock* entryBlock =
@@ -170,7 +397,7 @@ std::map<const ast::Variable*, llvm::Value*> CodeGenerator::functionSetup(
   builder_.SetInsertPoint(entryBlock);
 
   unsigned int i = 0;
-  std::map<const ast::Variable*, llvm::Value*> allocatedVariables;
+  VariableSlots allocatedVariables(f->variables.size(), nullptr);
   for (const auto& var : f->args) {
     // Note: intentionally skips last llvm func arg if it is a return value arg
     auto* llvmArg = llvmFunc->getArg(i);
@@ -179,10 +406,10 @@ std::map<const ast::Variable*, llvm::Value*> CodeGenerator::functionSetup(
   }
   return allocatedVariables;
 }
-void CodeGenerator::setupFunctionArgs(
-    std::map<const ast::Variable*, llvm::Value*>& allocated_variables,
-    llvm::Argument* llvm_arg, const ast::ConstValuePtr& var) {
-  const auto* arg = dynamic_cast<const ast::Variable*>(var.get());
+void CodeGenerator::setupFunctionArgs(VariableSlots& allocated_variables,
+                                      llvm::Argument* llvm_arg,
+                                      ast::ConstValuePtr var) {
+  const auto* arg = ast::dyn_cast<ast::Variable>(var);
   if (!arg) {
     FRONTEND_ERROR("error: arg in function definition is not a variable\n");
   }
@@ -190,20 +417,82 @@ void CodeGenerator::setupFunctionArgs(
 
   if (currArg->type->isObject()) {
     // allocate stack space for pass-by-value param
+    llvm::Align align(currArg->type->getAlignment());
     auto* stackPtr = this->builder_.CreateAlloca(
         arg->type->getLlvmStackAllocTy(this->context_), nullptr,
         "pass-by-copy");
-    this->builder_.CreateMemCpy(stackPtr, llvm::MaybeAlign(), llvm_arg,
-                                llvm::MaybeAlign(),
+    stackPtr->setAlignment(align);
+    this->builder_.CreateMemCpy(stackPtr, align, llvm_arg, align,
                                 currArg->type->getObjectSize());
-    allocated_variables[arg] = stackPtr;
+    allocated_variables[arg->index] = stackPtr;
   } else if (currArg->type->isRef()) {
-    allocated_variables[arg] = llvm_arg;
+    allocated_variables[arg->index] = llvm_arg;
   } else {
-    allocated_variables[arg] =
+    allocated_variables[arg->index] =
         this->builder_.CreateAlloca(arg->type->getLlvmInRegType(this->context_),
                                     nullptr, "pass-by-copy-atomic");
-    this->builder_.CreateStore(llvm_arg, allocated_variables[arg]);
+    this->builder_.CreateStore(llvm_arg, allocated_variables[arg->index]);
+  }
+}
+
+llvm::DISubprogram* CodeGenerator::describeFunction(const ast::Function& f) {
+  // no location carries over from the previous function
+  if (!debug_info_) {
+    builder_.SetCurrentDebugLocation(llvm::DebugLoc());
+    return nullptr;
+  }
+  declareFunction(f);
+  llvm::DISubprogram* subprogram =
+      debug_info_->describeFunction(*module_.getFunction(f.name.str()), f);
+  // the arguments are set up at the function's line
+  builder_.SetCurrentDebugLocation(
+      llvm::DILocation::get(context_, f.line, 0, subprogram));
+  return subprogram;
+}
+
+void CodeGenerator::declareVariables(const ast::Function& f,
+                                     const VariableSlots& slots,
+                                     llvm::DISubprogram* subprogram) {
+  // by index, so the declarations come out in the same order every time
+  std::vector<const ast::Variable*> variables(slots.size(), nullptr);
+  for (const auto& [name, var] : f.variables) {
+    variables[var->index] = var;
+  }
+  llvm::BasicBlock& entry =
+      module_.getFunction(f.name.str())->getEntryBlock();
+  for (const ast::Variable* var : variables) {
+    // variables codegen never reached have no slot
+    if (var == nullptr || slots[var->index] == nullptr) {
+      continue;
+    }
+    llvm::Value* slot = slots[var->index];
+    const VarType* type = var->type.get();
+    if (llvm::isa<llvm::Argument>(slot)) {
+      // a reference argument is the address of what it refers to
+      type = type->getReferencedType().get();
+    }
+    debug_info_->declareVariable(subprogram, var->name, *type,
+                                 declarationLine(f, *var),
+                                 argNumber(f, var->name), slot, entry);
+  }
+}
+
+void CodeGenerator::declareSlots(const mir::Function& f,
+                                 const std::vector<llvm::Value*>& slots,
+                                 llvm::DISubprogram* subprogram) {
+  const ast::Function& source = *f.source;
+  llvm::BasicBlock& entry =
+      module_.getFunction(source.name.str())->getEntryBlock();
+  for (mir::SlotId s = 0; s < f.slots.size(); s++) {
+    // temporaries have no name
+    auto it = source.variables.find(f.slots[s].name);
+    if (f.slots[s].name.empty() || it == source.variables.end()) {
+      continue;
+    }
+    debug_info_->declareVariable(subprogram, f.slots[s].name, *f.slots[s].type,
+                                 declarationLine(source, *it->second),
+                                 argNumber(source, f.slots[s].name), slots[s],
+                                 entry);
   }
 }
 }  // namespace frontend
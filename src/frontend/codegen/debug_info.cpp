@@ -0,0 +1,178 @@
+#include "frontend/debug_info.h"
+
+#include <llvm/BinaryFormat/Dwarf.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Value.h>
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "frontend/diagnostic/debug.h"
+
+namespace frontend {
+namespace {
+constexpr uint32_t kPointerBits = 64;
+
+uint32_t alignBits(const VarType& type) {
+  return static_cast<uint32_t>(type.getAlignment() * 8);
+}
+}  // namespace
+
+DebugInfo::DebugInfo(llvm::Module& module, const std::string& source_file,
+                     bool optimized)
+    : builder_(module), optimized_(optimized) {
+  std::error_code ec;
+  std::filesystem::path path = std::filesystem::absolute(source_file, ec);
+  if (ec) {
+    path = source_file;
+  }
+  file_ = builder_.createFile(path.filename().string(),
+                              path.parent_path().string());
+  unit_ = builder_.createCompileUnit(llvm::dwarf::DW_LANG_C, file_, "compiler",
+                                     optimized_, "", 0);
+  if (!module.getModuleFlag("Debug Info Version")) {
+    module.addModuleFlag(llvm::Module::Warning, "Debug Info Version",
+                         llvm::DEBUG_METADATA_VERSION);
+    module.addModuleFlag(llvm::Module::Warning, "Dwarf Version", 4);
+  }
+}
+
+llvm::DISubprogram* DebugInfo::describeFunction(llvm::Function& llvm_function,
+                                                const ast::Function& f) {
+  llvm::DISubprogram::DISPFlags flags = llvm::DISubprogram::SPFlagDefinition;
+  if (optimized_) {
+    flags |= llvm::DISubprogram::SPFlagOptimized;
+  }
+  llvm::DISubprogram* subprogram = builder_.createFunction(
+      file_, f.name.str(), f.name.str(), file_, f.line, describeSignature(f),
+      f.line, llvm::DINode::FlagPrototyped, flags);
+  llvm_function.setSubprogram(subprogram);
+  return subprogram;
+}
+
+void DebugInfo::declareVariable(llvm::DISubprogram* scope, Symbol name,
+                                const VarType& type, uint32_t line,
+                                unsigned arg_no, llvm::Value* storage,
+                                llvm::BasicBlock& block) {
+  llvm::DIType* di_type = describeType(type);
+  llvm::DILocalVariable* variable =
+      arg_no != 0
+          ? builder_.createParameterVariable(scope, name.str(), arg_no, file_,
+                                             line, di_type, true)
+          : builder_.createAutoVariable(scope, name.str(), file_, line,
+                                        di_type, true);
+  // goes before the terminator if the block has one
+  builder_.insertDeclare(
+      storage, variable, builder_.createExpression(),
+      llvm::DILocation::get(block.getContext(), line, 0, scope), &block);
+}
+
+void DebugInfo::finalize() {
+  if (!finalized_) {
+    builder_.finalize();
+    finalized_ = true;
+  }
+}
+
+llvm::DIType* DebugInfo::describeType(const VarType& type) {
+  auto it = types_.find(&type);
+  if (it != types_.end()) {
+    return it->second;
+  }
+  llvm::DIType* di_type = nullptr;
+  switch (type.type_id_.type_category) {
+    case VarType::TypeCat::VOID:
+      break;
+    case VarType::TypeCat::INTEGER: {
+      unsigned encoding = type.isBool()     ? llvm::dwarf::DW_ATE_boolean
+                          : type.isSigned() ? llvm::dwarf::DW_ATE_signed
+                                            : llvm::dwarf::DW_ATE_unsigned;
+      di_type = builder_.createBasicType(type.type_id_.type_name.str(),
+                                         type.getObjectSize() * 8, encoding);
+      break;
+    }
+    case VarType::TypeCat::FLOAT:
+      di_type = builder_.createBasicType(type.type_id_.type_name.str(),
+                                         type.getFloatBits(),
+                                         llvm::dwarf::DW_ATE_float);
+      break;
+    case VarType::TypeCat::REFERENCE:
+      di_type = builder_.createReferenceType(
+          llvm::dwarf::DW_TAG_reference_type,
+          describeType(*type.getReferencedType()), kPointerBits);
+      break;
+    case VarType::TypeCat::ARRAY: {
+      llvm::Metadata* subrange =
+          builder_.getOrCreateSubrange(0, type.type_id_.size);
+      di_type = builder_.createArrayType(
+          type.getObjectSize() * 8, alignBits(type),
+          describeType(*type.getElemType()),
+          builder_.getOrCreateArray(subrange));
+      break;
+    }
+    case VarType::TypeCat::STRUCTURE: {
+      auto* struct_type = builder_.createStructType(
+          file_, type.type_id_.type_name.str(), file_, 0,
+          type.getObjectSize() * 8, alignBits(type), llvm::DINode::FlagZero,
+          nullptr, llvm::DINodeArray());
+      // members refer to the struct as their scope, so it is cached first
+      types_.emplace(&type, struct_type);
+      std::vector<Symbol> names(type.members_.size());
+      for (const auto& [member_name, index] : type.member_name_to_index_) {
+        names[index] = member_name;
+      }
+      // in declaration order, at the offsets of the layout
+      std::vector<llvm::Metadata*> members;
+      for (size_t i = 0; i < type.members_.size(); i++) {
+        const VarType& member = *type.members_[i];
+        members.push_back(builder_.createMemberType(
+            struct_type, names[i].str(), file_, 0, member.getObjectSize() * 8,
+            alignBits(member), type.getMemberOffset(names[i]) * 8,
+            llvm::DINode::FlagZero, describeType(member)));
+      }
+      builder_.replaceArrays(struct_type, builder_.getOrCreateArray(members));
+      return struct_type;
+    }
+    case VarType::TypeCat::SLICE: {
+      // the { ptr, i64 } pair the slice is held in
+      auto* struct_type = builder_.createStructType(
+          file_, type.type_id_.type_name.str(), file_, 0,
+          type.getObjectSize() * 8, alignBits(type), llvm::DINode::FlagZero,
+          nullptr, llvm::DINodeArray());
+      llvm::Metadata* members[] = {
+          builder_.createMemberType(
+              struct_type, "data", file_, 0, kPointerBits, kPointerBits, 0,
+              llvm::DINode::FlagZero,
+              builder_.createPointerType(describeType(*type.getElemType()),
+                                         kPointerBits)),
+          builder_.createMemberType(
+              struct_type, "length", file_, 0, 64, 64, kPointerBits,
+              llvm::DINode::FlagZero,
+              builder_.createBasicType("int64", 64,
+                                       llvm::dwarf::DW_ATE_signed))};
+      builder_.replaceArrays(struct_type, builder_.getOrCreateArray(members));
+      di_type = struct_type;
+      break;
+    }
+    default:
+      FRONTEND_ERROR("unknown type");
+  }
+  types_.emplace(&type, di_type);
+  return di_type;
+}
+
+llvm::DISubroutineType* DebugInfo::describeSignature(const ast::Function& f) {
+  // the return type first, null for void
+  std::vector<llvm::Metadata*> types = {describeType(*f.type)};
+  for (const auto& arg : f.args) {
+    types.push_back(describeType(*arg->type));
+  }
+  return builder_.createSubroutineType(builder_.getOrCreateTypeArray(types));
+}
+
+}  // namespace frontend
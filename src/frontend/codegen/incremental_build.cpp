@@ -0,0 +1,228 @@
+#include "frontend/incremental_build.h"
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/ErrorOr.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "frontend/ast/ast.h"
+#include "frontend/code_generator.h"
+#include "frontend/compilation_context.h"
+#include "frontend/diagnostic/debug.h"
+#include "frontend/parse/lexer.h"
+#include "frontend/parse/parser.h"
+#include "frontend/symbol/Symbol.h"
+#include "frontend/visitor/ApplyTypesBuilder.h"
+
+namespace frontend {
+namespace {
+uint64_t combineHash(uint64_t seed, std::string_view text) {
+  uint64_t h = std::hash<std::string_view>()(text);
+  return seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// what a function definition is known by in the cache
+struct FunctionSummary {
+  Symbol name;
+  uint64_t hash;
+  const lexer::Definition* definition;
+};
+
+// the signature ends at the body's opening brace, the name is right before
+// the opening parenthesis
+void summarizeFunction(std::string_view source, const lexer::Definition& def,
+                       FunctionSummary& summary, std::string_view& signature) {
+  size_t first = def.tokens.front().offset;
+  summary.definition = &def;
+  summary.hash = combineHash(0, source.substr(first, def.end - first));
+  signature = source.substr(first, def.end - first);
+  for (size_t i = 0; i < def.tokens.size(); i++) {
+    std::string_view text = lexer::tokenText(source, def.tokens[i]);
+    if (text == "(" && i > 0 && summary.name.empty()) {
+      summary.name = Symbol(lexer::tokenText(source, def.tokens[i - 1]));
+    } else if (text == "{") {
+      signature = source.substr(first, def.tokens[i].offset - first);
+      break;
+    }
+  }
+}
+}  // namespace
+
+IncrementalBuild::IncrementalBuild(ParseOptions options, bool debug_info,
+                                   bool fast_math, OptLevel opt_level,
+                                   std::string pass_pipeline)
+    : options_(options),
+      debug_info_(debug_info),
+      fast_math_(fast_math),
+      opt_level_(opt_level),
+      pass_pipeline_(std::move(pass_pipeline)),
+      compilation_(std::make_unique<CompilationContext>()) {}
+
+IncrementalBuild::~IncrementalBuild() = default;
+
+bool IncrementalBuild::rebuild(const std::string& input,
+                               const std::string& output, Stats* stats) {
+  // an error in the input is reported and the next rebuild starts from what
+  // the last good one cached
+  RecoverableErrors recoverable;
+  auto buffer = llvm::MemoryBuffer::getFile(input);
+  if (!buffer) {
+    std::cerr << "could not read " << input << ": "
+              << buffer.getError().message() << std::endl;
+    return false;
+  }
+  std::string_view source((*buffer)->getBufferStart(),
+                          (*buffer)->getBufferSize());
+  std::vector<lexer::Token> tokens = lexer::tokenize(source);
+  std::vector<lexer::Definition> definitions =
+      lexer::splitDefinitions(source, tokens);
+  std::vector<std::string_view> imports =
+      lexer::importedModules(source, tokens);
+
+  // every function is compiled against all structs and function signatures,
+  // so those are hashed separately from the bodies. Imports bring in structs
+  // and signatures as well.
+  uint64_t struct_hash = 0;
+  uint64_t signature_hash = 0;
+  for (std::string_view name : imports) {
+    struct_hash = combineHash(struct_hash, name);
+  }
+  std::vector<const lexer::Definition*> struct_definitions;
+  std::vector<FunctionSummary> summaries;
+  for (const lexer::Definition& def : definitions) {
+    if (def.is_struct) {
+      size_t first = def.tokens.front().offset;
+      struct_hash =
+          combineHash(struct_hash, source.substr(first, def.end - first));
+      struct_definitions.push_back(&def);
+      continue;
+    }
+    FunctionSummary summary{};
+    std::string_view signature;
+    summarizeFunction(source, def, summary, signature);
+    if (debug_info_) {
+      // the line table of the cached function would be off
+      summary.hash = combineHash(summary.hash, std::to_string(def.line));
+    }
+    signature_hash = combineHash(signature_hash, signature);
+    summaries.push_back(summary);
+  }
+
+  if (built_ && struct_hash != struct_hash_) {
+    // the cached ASTs point into the old context's types, so they go first
+    functions_.clear();
+    compilation_ = std::make_unique<CompilationContext>();
+    built_ = false;
+  }
+  if (signature_hash != signature_hash_) {
+    functions_.clear();
+  }
+
+  std::vector<lexer::Definition> to_parse;
+  if (!built_) {
+    for (const lexer::Definition* def : struct_definitions) {
+      to_parse.push_back(*def);
+    }
+  }
+  std::vector<const ast::Function*> known_functions;
+  std::unordered_map<Symbol, uint64_t> new_hashes;
+  for (const FunctionSummary& summary : summaries) {
+    auto it = functions_.find(summary.name);
+    if (it != functions_.end() && it->second.hash == summary.hash) {
+      known_functions.push_back(it->second.typed);
+      continue;
+    }
+    to_parse.push_back(*summary.definition);
+    new_hashes[summary.name] = summary.hash;
+  }
+
+  auto typed = std::make_shared<Program>();
+  try {
+    *typed = parseDefinitions(*compilation_, source, input.c_str(), to_parse,
+                              imports, known_functions, options_);
+    ApplyTypesBuilder builder(*compilation_);
+    builder.apply_types(*typed);
+  } catch (const FrontendError& e) {
+    if (!built_) {
+      // the structs parsed so far are dropped with the context
+      compilation_ = std::make_unique<CompilationContext>();
+    }
+    printError(e);
+    return false;
+  }
+  built_ = true;
+  struct_hash_ = struct_hash;
+  signature_hash_ = signature_hash;
+
+  // the new ASTs replace the cached ones first, so every module declares the
+  // current signatures
+  std::vector<CachedFunction*> rebuilt;
+  for (ast::Function* f : typed->functions) {
+    CachedFunction& cached = functions_[f->name];
+    cached.hash = new_hashes[f->name];
+    cached.program = typed;
+    cached.typed = f;
+    rebuilt.push_back(&cached);
+  }
+  try {
+    for (CachedFunction* cached : rebuilt) {
+      CodeGenerator cg(*compilation_);
+      cg.setOptLevel(opt_level_);
+      if (debug_info_) {
+        cg.emitDebugInfo(input);
+      }
+      if (fast_math_) {
+        cg.enableFastMath();
+      }
+      if (!pass_pipeline_.empty()) {
+        cg.setPassPipeline(pass_pipeline_);
+      }
+      for (const auto& [name, other] : functions_) {
+        cg.declareFunction(*other.typed);
+      }
+      for (const auto* imported : typed->imported_functions) {
+        cg.declareFunction(*imported);
+      }
+      cg.generateFunction(cached->typed);
+      cg.optimize();
+      cached->bitcode = cg.writeBitcode();
+    }
+
+    CodeGenerator linked(*compilation_);
+    // the backend runs here, at the same level
+    linked.setOptLevel(opt_level_);
+    for (const FunctionSummary& summary : summaries) {
+      auto it = functions_.find(summary.name);
+      if (it == functions_.end()) {
+        FRONTEND_ERROR("no function " + std::string(summary.name.str()) +
+                       " was built for the definition on line " +
+                       std::to_string(summary.definition->line));
+      }
+      const auto& bitcode = it->second.bitcode;
+      linked.linkBitcode(llvm::StringRef(bitcode.data(), bitcode.size()));
+    }
+    linked.emitObjectFile(output);
+  } catch (const FrontendError& e) {
+    // some cached functions may have no bitcode, the next rebuild redoes all
+    functions_.clear();
+    printError(e);
+    return false;
+  }
+
+  if (stats != nullptr) {
+    stats->functions = summaries.size();
+    stats->rebuilt = rebuilt.size();
+  }
+  return true;
+}
+}  // namespace frontend
@@ -0,0 +1,276 @@
+#include "frontend/mir/IRMirGen.h"
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#include <bit>
+#include <string>
+#include <vector>
+
+#include "frontend/ast/ast.h"
+#include "frontend/diagnostic/debug.h"
+#include "frontend/types/VarType.h"
+
+namespace frontend {
+namespace {
+// the type of a number register, for the results of conversions
+llvm::Type* numberRegType(llvm::LLVMContext& context, mir::RegType type) {
+  switch (type) {
+    case mir::RegType::I1:
+      return llvm::Type::getInt1Ty(context);
+    case mir::RegType::I8:
+      return llvm::Type::getInt8Ty(context);
+    case mir::RegType::I16:
+      return llvm::Type::getInt16Ty(context);
+    case mir::RegType::I32:
+      return llvm::Type::getInt32Ty(context);
+    case mir::RegType::I64:
+      return llvm::Type::getInt64Ty(context);
+    case mir::RegType::F32:
+      return llvm::Type::getFloatTy(context);
+    case mir::RegType::F64:
+      return llvm::Type::getDoubleTy(context);
+    default:
+      FRONTEND_ERROR("not a number register");
+  }
+}
+
+// the predicate of a comparison as type: signed or unsigned for integers,
+// and for floats ordered except != (like IRValueGen)
+llvm::CmpInst::Predicate comparePredicate(mir::Opcode op,
+                                          const VarType& type) {
+  using P = llvm::CmpInst::Predicate;
+  bool is_float = type.isFloat();
+  bool is_signed = type.isSigned();
+  switch (op) {
+    case mir::Opcode::CmpLt:
+      return is_float ? P::FCMP_OLT : is_signed ? P::ICMP_SLT : P::ICMP_ULT;
+    case mir::Opcode::CmpGt:
+      return is_float ? P::FCMP_OGT : is_signed ? P::ICMP_SGT : P::ICMP_UGT;
+    case mir::Opcode::CmpLe:
+      return is_float ? P::FCMP_OLE : is_signed ? P::ICMP_SLE : P::ICMP_ULE;
+    case mir::Opcode::CmpGe:
+      return is_float ? P::FCMP_OGE : is_signed ? P::ICMP_SGE : P::ICMP_UGE;
+    case mir::Opcode::CmpEq:
+      return is_float ? P::FCMP_OEQ : P::ICMP_EQ;
+    case mir::Opcode::CmpNe:
+      return is_float ? P::FCMP_UNE : P::ICMP_NE;
+    default:
+      FRONTEND_ERROR("not a comparison");
+  }
+}
+}  // namespace
+
+IRMirGen::IRMirGen(llvm::IRBuilder<>& builder, llvm::LLVMContext& context,
+                   llvm::Module& module)
+    : builder_(builder), context_(context), module_(module) {}
+
+void IRMirGen::generate(const mir::Function& f,
+                        llvm::DISubprogram* subprogram) {
+  llvm::Function* llvm_function = module_.getFunction(f.source->name.str());
+  if (!llvm_function) {
+    FRONTEND_ERROR("function is not declared");
+  }
+  std::vector<llvm::BasicBlock*> blocks(f.blocks());
+  for (mir::BlockId b = 0; b < f.blocks(); b++) {
+    blocks[b] =
+        llvm::BasicBlock::Create(context_, f.block_name[b], llvm_function);
+  }
+
+  // every slot is allocated on entry
+  builder_.SetInsertPoint(blocks[0]);
+  slots_.assign(f.slots.size(), nullptr);
+  for (mir::SlotId s = 0; s < f.slots.size(); s++) {
+    llvm::AllocaInst* slot = builder_.CreateAlloca(
+        f.slots[s].type->getLlvmStackAllocTy(context_), nullptr,
+        std::string(f.slots[s].name.str()));
+    slot->setAlignment(llvm::Align(f.slots[s].type->getAlignment()));
+    slots_[s] = slot;
+  }
+  std::vector<llvm::Function*> callees(f.callees.size());
+  for (size_t c = 0; c < f.callees.size(); c++) {
+    callees[c] = module_.getFunction(f.callees[c].str());
+    if (!callees[c]) {
+      FRONTEND_ERROR("callee function not found");
+    }
+  }
+
+  std::vector<llvm::Value*> regs(f.reg_type.size(), nullptr);
+  std::vector<llvm::Value*> args;
+  for (mir::BlockId b = 0; b < f.blocks(); b++) {
+    builder_.SetInsertPoint(blocks[b]);
+    for (mir::InstId i = f.block_begin[b]; i < f.block_begin[b + 1]; i++) {
+      if (subprogram != nullptr && f.line[i] != 0) {
+        builder_.SetCurrentDebugLocation(
+            llvm::DILocation::get(context_, f.line[i], 0, subprogram));
+      }
+      auto operands = f.operandsOf(i);
+      auto reg = [&](size_t k) { return regs[operands[k]]; };
+      const VarType* type = f.type[i];
+      llvm::Value* value = nullptr;
+      switch (f.opcode[i]) {
+        case mir::Opcode::Const:
+          if (f.reg_type[f.result[i]] == mir::RegType::Ptr) {
+            value = llvm::ConstantPointerNull::get(
+                type->getLlvmStackAllocTy(context_)->getPointerTo(0));
+          } else if (f.reg_type[f.result[i]] == mir::RegType::Slice) {
+            value =
+                llvm::Constant::getNullValue(type->getLlvmInRegType(context_));
+          } else if (type->isFloat()) {
+            value = llvm::ConstantFP::get(type->getLlvmInRegType(context_),
+                                          std::bit_cast<double>(f.imm[i]));
+          } else {
+            value = llvm::ConstantInt::getSigned(
+                type->getLlvmInRegType(context_), f.imm[i]);
+          }
+          break;
+        case mir::Opcode::SlotAddr:
+          value = slots_[f.imm[i]];
+          break;
+        case mir::Opcode::Arg:
+          value = llvm_function->getArg(static_cast<unsigned>(f.imm[i]));
+          break;
+        case mir::Opcode::Load:
+          value = builder_.CreateLoad(type->getLlvmInRegType(context_), reg(0));
+          break;
+        case mir::Opcode::Store:
+          builder_.CreateStore(reg(0), reg(1));
+          break;
+        case mir::Opcode::Copy: {
+          llvm::Align align(type->getAlignment());
+          builder_.CreateMemCpy(reg(0), align, reg(1), align,
+                                type->getObjectSize());
+          break;
+        }
+        case mir::Opcode::Add:
+          value = type->isFloat() ? builder_.CreateFAdd(reg(0), reg(1))
+                                  : builder_.CreateAdd(reg(0), reg(1));
+          break;
+        case mir::Opcode::Sub:
+          value = type->isFloat() ? builder_.CreateFSub(reg(0), reg(1))
+                                  : builder_.CreateSub(reg(0), reg(1));
+          break;
+        case mir::Opcode::Mul:
+          value = type->isFloat() ? builder_.CreateFMul(reg(0), reg(1))
+                                  : builder_.CreateMul(reg(0), reg(1));
+          break;
+        case mir::Opcode::And:
+          value = builder_.CreateAnd(reg(0), reg(1));
+          break;
+        case mir::Opcode::Shl:
+          value = builder_.CreateShl(reg(0), reg(1));
+          break;
+        case mir::Opcode::Shr:
+          value = builder_.CreateLShr(reg(0), reg(1));
+          break;
+        case mir::Opcode::CmpLt:
+        case mir::Opcode::CmpGt:
+        case mir::Opcode::CmpLe:
+        case mir::Opcode::CmpGe:
+        case mir::Opcode::CmpEq:
+        case mir::Opcode::CmpNe:
+          value = builder_.CreateCmp(comparePredicate(f.opcode[i], *type),
+                                     reg(0), reg(1));
+          break;
+        case mir::Opcode::Trunc:
+          value = builder_.CreateTrunc(
+              reg(0), numberRegType(context_, f.reg_type[f.result[i]]));
+          break;
+        case mir::Opcode::SExt:
+          value = builder_.CreateSExt(
+              reg(0), numberRegType(context_, f.reg_type[f.result[i]]));
+          break;
+        case mir::Opcode::ZExt:
+          value = builder_.CreateZExt(
+              reg(0), numberRegType(context_, f.reg_type[f.result[i]]));
+          break;
+        case mir::Opcode::FPTrunc:
+          value = builder_.CreateFPTrunc(
+              reg(0), numberRegType(context_, f.reg_type[f.result[i]]));
+          break;
+        case mir::Opcode::FPExt:
+          value = builder_.CreateFPExt(
+              reg(0), numberRegType(context_, f.reg_type[f.result[i]]));
+          break;
+        case mir::Opcode::SIToFP:
+          value = builder_.CreateSIToFP(
+              reg(0), numberRegType(context_, f.reg_type[f.result[i]]));
+          break;
+        case mir::Opcode::UIToFP:
+          value = builder_.CreateUIToFP(
+              reg(0), numberRegType(context_, f.reg_type[f.result[i]]));
+          break;
+        case mir::Opcode::FPToSI:
+          value = builder_.CreateFPToSI(
+              reg(0), numberRegType(context_, f.reg_type[f.result[i]]));
+          break;
+        case mir::Opcode::FPToUI:
+          value = builder_.CreateFPToUI(
+              reg(0), numberRegType(context_, f.reg_type[f.result[i]]));
+          break;
+        case mir::Opcode::ElemAddr: {
+          if (type->isSlice()) {
+            value = builder_.CreateGEP(
+                type->getElemType()->getLlvmStackAllocTy(context_), reg(0),
+                reg(1));
+            break;
+          }
+          std::vector<llvm::Value*> indices = {builder_.getInt64(0)};
+          for (size_t k = 1; k < operands.size(); k++) {
+            indices.push_back(reg(k));
+          }
+          value = builder_.CreateGEP(type->getLlvmStackAllocTy(context_),
+                                     reg(0), indices);
+          break;
+        }
+        case mir::Opcode::MakeSlice: {
+          llvm::Value* slice =
+              llvm::PoisonValue::get(type->getLlvmInRegType(context_));
+          slice = builder_.CreateInsertValue(slice, reg(0), 0);
+          value = builder_.CreateInsertValue(slice, builder_.getInt64(f.imm[i]),
+                                             1);
+          break;
+        }
+        case mir::Opcode::SliceData:
+          value = builder_.CreateExtractValue(reg(0), 0);
+          break;
+        case mir::Opcode::SliceLength:
+          value = builder_.CreateExtractValue(reg(0), 1);
+          break;
+        case mir::Opcode::Call:
+          args.clear();
+          for (size_t k = 0; k < operands.size(); k++) {
+            args.push_back(reg(k));
+          }
+          value = builder_.CreateCall(callees[f.imm[i]], args);
+          break;
+        case mir::Opcode::Jump:
+          builder_.CreateBr(blocks[operands[0]]);
+          break;
+        case mir::Opcode::Branch:
+          builder_.CreateCondBr(reg(0), blocks[operands[1]],
+                                blocks[operands[2]]);
+          break;
+        case mir::Opcode::Ret:
+          if (operands.empty()) {
+            builder_.CreateRetVoid();
+          } else {
+            builder_.CreateRet(reg(0));
+          }
+          break;
+      }
+      if (f.result[i] != mir::kNoReg) {
+        regs[f.result[i]] = value;
+      }
+    }
+  }
+}
+}  // namespace frontend
@@ -0,0 +1,632 @@
+#include "frontend/mir/LowerAst.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
+#include <numeric>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "frontend/ast/ast.h"
+#include "frontend/diagnostic/debug.h"
+#include "frontend/symbol/Symbol.h"
+#include "frontend/types/VarType.h"
+
+namespace frontend::mir {
+namespace {
+constexpr SlotId kNoSlot = UINT32_MAX;
+constexpr InstId kNotStarted = UINT32_MAX;
+
+// the register a value of type is loaded into, follows
+// VarType::getLlvmInRegType
+RegType regTypeOf(const VarType& type) {
+  if (type.isRef()) {
+    return regTypeOf(*type.getReferencedType());
+  }
+  if (type.isArray() || type.isStruct()) {
+    return RegType::Ptr;
+  }
+  if (type.isSlice()) {
+    return RegType::Slice;
+  }
+  if (type.isFloat()) {
+    return type.getFloatBits() == 32 ? RegType::F32 : RegType::F64;
+  }
+  switch (type.getIntBits()) {
+    case 1:
+      return RegType::I1;
+    case 8:
+      return RegType::I8;
+    case 16:
+      return RegType::I16;
+    case 32:
+      return RegType::I32;
+    default:
+      return RegType::I64;
+  }
+}
+
+// a binary operation dereferences its operands
+const VarType& valueType(const VarType& type) {
+  return type.isRef() ? *type.getReferencedType() : type;
+}
+
+Opcode binopToOpcode(ast::BinOpId op) {
+  switch (op) {
+    case ast::BinOpId::ADD:
+      return Opcode::Add;
+    case ast::BinOpId::SUB:
+      return Opcode::Sub;
+    case ast::BinOpId::MUL:
+      return Opcode::Mul;
+    case ast::BinOpId::AND:
+      return Opcode::And;
+    case ast::BinOpId::SHL:
+      return Opcode::Shl;
+    case ast::BinOpId::SHR:
+      return Opcode::Shr;
+    case ast::BinOpId::LT:
+      return Opcode::CmpLt;
+    case ast::BinOpId::GT:
+      return Opcode::CmpGt;
+    case ast::BinOpId::LEQ:
+      return Opcode::CmpLe;
+    case ast::BinOpId::GEQ:
+      return Opcode::CmpGe;
+    case ast::BinOpId::EQ:
+      return Opcode::CmpEq;
+    default:
+      FRONTEND_ERROR("unknown binary operator");
+  }
+}
+
+bool isComparison(Opcode op) {
+  return op >= Opcode::CmpLt && op <= Opcode::CmpNe;
+}
+
+// Lowers one function. Follows IRValueGen (values) and IRInstructionGen
+// (instructions) step by step, so the instructions touch memory in the same
+// order as the LLVM IR generated straight from the AST.
+class FunctionLowering {
+ public:
+  FunctionLowering(const ast::Function& source, Function& f)
+      : source_(source), f_(f), homes_(source.variables.size()) {}
+
+  void lower();
+
+ private:
+  // where a variable lives: a slot, or the register holding the address a
+  // reference argument was passed
+  struct VariableHome {
+    SlotId slot = kNoSlot;
+    Reg reg = kNoReg;
+  };
+
+  Reg newReg(RegType type);
+  SlotId newSlot(const VarType& type, Symbol name);
+  BlockId newBlock(const char* name);
+  void startBlock(BlockId block);
+  // appends an instruction to the current block
+  void emit(Opcode op, Reg result, std::span<const uint32_t> operands,
+            const VarType* type = nullptr, int64_t imm = 0);
+  void emit(Opcode op, Reg result, std::initializer_list<uint32_t> operands,
+            const VarType* type = nullptr, int64_t imm = 0) {
+    emit(op, result, std::span(operands.begin(), operands.size()), type, imm);
+  }
+  Reg slotAddress(SlotId slot);
+  uint32_t calleeIndex(Symbol name);
+  // renumbers blocks in the order they were started and fills in
+  // Function::block_begin
+  void finish();
+
+  void setupArgs();
+  Reg variableAddress(const ast::Variable& var);
+
+  // IRValueGen::get_val, get_loaded_val, get_converted_val,
+  // get_condition_val and get_index_val
+  Reg value(const ast::Value& value);
+  Reg loadedValue(const ast::Value& value);
+  Reg convertedValue(const ast::Value& value, const VarType& to);
+  Reg conditionValue(const ast::Value& value);
+  Reg indexValue(const ast::Value& index);
+  Reg convert(Reg value, const VarType& from, const VarType& to);
+  Reg compareWithZero(Reg value, const VarType& type);
+
+  Reg lowerValue(const ast::Variable& var);
+  Reg lowerValue(const ast::Integer& num);
+  Reg lowerValue(const ast::Float& num);
+  Reg lowerValue(const ast::FunctionName& func_name);
+  Reg lowerValue(const ast::BinaryOperation& bin_op);
+  Reg lowerValue(const ast::FunctionCall& call);
+  Reg lowerValue(const ast::ArrayAccess& access);
+  Reg lowerValue(const ast::ArrayAllocate& alloc);
+  Reg lowerValue(const ast::ArrayLength& length);
+
+  void lower(const ast::Instruction& inst);
+  void lowerInst(const ast::InstructionReturn& ret);
+  void lowerInst(const ast::InstructionAssignment& assign);
+  void lowerInst(const ast::InstructionFunctionCall& call);
+  void lowerInst(const ast::InstructionWhileLoop& loop);
+  void lowerInst(const ast::InstructionIfStatement& if_stmt);
+  void lowerInst(const ast::InstructionBreak& brk);
+  void lowerInst(const ast::InstructionContinue& cont);
+  void lowerInst(const ast::InstructionDecl& decl);
+  void lowerInst(const ast::Scope& scope);
+
+  const ast::Function& source_;
+  Function& f_;
+  std::vector<VariableHome> homes_;
+  // first instruction of each block by the id it was made with
+  std::vector<InstId> block_start_;
+  std::unordered_map<Symbol, uint32_t> callee_index_;
+  // line of the statement being lowered, kept through scopes like
+  // IRInstructionGen keeps the builder's location
+  uint32_t line_ = 0;
+};
+
+void FunctionLowering::lower() {
+  f_.source = &source_;
+  startBlock(newBlock("entry"));
+  setupArgs();
+  lower(*source_.scope);
+  finish();
+}
+
+Reg FunctionLowering::newReg(RegType type) {
+  f_.reg_type.push_back(type);
+  return static_cast<Reg>(f_.reg_type.size() - 1);
+}
+
+SlotId FunctionLowering::newSlot(const VarType& type, Symbol name) {
+  f_.slots.push_back({&type, name});
+  return static_cast<SlotId>(f_.slots.size() - 1);
+}
+
+BlockId FunctionLowering::newBlock(const char* name) {
+  f_.block_name.push_back(name);
+  block_start_.push_back(kNotStarted);
+  return static_cast<BlockId>(f_.block_name.size() - 1);
+}
+
+void FunctionLowering::startBlock(BlockId block) {
+  block_start_[block] = static_cast<InstId>(f_.size());
+}
+
+void FunctionLowering::emit(Opcode op, Reg result,
+                            std::span<const uint32_t> operands,
+                            const VarType* type, int64_t imm) {
+  f_.opcode.push_back(op);
+  f_.result.push_back(result);
+  f_.type.push_back(type);
+  f_.imm.push_back(imm);
+  f_.line.push_back(line_);
+  f_.operands.insert(f_.operands.end(), operands.begin(), operands.end());
+  f_.operand_begin.push_back(static_cast<uint32_t>(f_.operands.size()));
+}
+
+Reg FunctionLowering::slotAddress(SlotId slot) {
+  Reg address = newReg(RegType::Ptr);
+  emit(Opcode::SlotAddr, address, {}, f_.slots[slot].type, slot);
+  return address;
+}
+
+uint32_t FunctionLowering::calleeIndex(Symbol name) {
+  auto [it, inserted] =
+      callee_index_.try_emplace(name, static_cast<uint32_t>(f_.callees.size()));
+  if (inserted) {
+    f_.callees.push_back(name);
+  }
+  return it->second;
+}
+
+void FunctionLowering::finish() {
+  // every block is terminated before the next one is started, so ordering
+  // blocks by their first instruction lays them out contiguously
+  std::vector<BlockId> order(f_.blocks());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](BlockId a, BlockId b) {
+    return block_start_[a] < block_start_[b];
+  });
+  std::vector<BlockId> renumbered(order.size());
+  std::vector<const char*> names(order.size());
+  f_.block_begin.clear();
+  for (BlockId b = 0; b < order.size(); b++) {
+    ASSERT(block_start_[order[b]] != kNotStarted, "block was never started");
+    renumbered[order[b]] = b;
+    names[b] = f_.block_name[order[b]];
+    f_.block_begin.push_back(block_start_[order[b]]);
+  }
+  f_.block_begin.push_back(static_cast<InstId>(f_.size()));
+  f_.block_name = std::move(names);
+
+  for (InstId i = 0; i < f_.size(); i++) {
+    uint32_t* operands = f_.operands.data() + f_.operand_begin[i];
+    if (f_.opcode[i] == Opcode::Jump) {
+      operands[0] = renumbered[operands[0]];
+    } else if (f_.opcode[i] == Opcode::Branch) {
+      operands[1] = renumbered[operands[1]];
+      operands[2] = renumbered[operands[2]];
+    }
+  }
+}
+
+void FunctionLowering::setupArgs() {
+  for (size_t i = 0; i < source_.args.size(); i++) {
+    const auto* arg = ast::dyn_cast<ast::Variable>(source_.args[i]);
+    if (!arg) {
+      FRONTEND_ERROR("error: arg in function definition is not a variable\n");
+    }
+    Reg value = newReg(regTypeOf(*arg->type));
+    emit(Opcode::Arg, value, {}, arg->type.get(), static_cast<int64_t>(i));
+
+    VariableHome& home = homes_[arg->index];
+    if (arg->type->isObject()) {
+      // pass-by-value param, copied into the callee's frame
+      home.slot = newSlot(*arg->type, arg->name);
+      emit(Opcode::Copy, kNoReg, {slotAddress(home.slot), value},
+           arg->type.get());
+    } else if (arg->type->isRef()) {
+      home.reg = value;
+    } else {
+      home.slot = newSlot(*arg->type, arg->name);
+      emit(Opcode::Store, kNoReg, {value, slotAddress(home.slot)});
+    }
+  }
+}
+
+Reg FunctionLowering::variableAddress(const ast::Variable& var) {
+  VariableHome& home = homes_[var.index];
+  if (home.reg != kNoReg) {
+    return home.reg;
+  }
+  if (home.slot != kNoSlot) {
+    return slotAddress(home.slot);
+  }
+  // made and zeroed where the variable is first used
+  home.slot = newSlot(*var.type, var.name);
+  Reg address = slotAddress(home.slot);
+  if (var.type->isRef() || var.type->isNumeric() || var.type->isSlice()) {
+    Reg zero = newReg(var.type->isRef() ? RegType::Ptr : regTypeOf(*var.type));
+    emit(Opcode::Const, zero, {}, var.type.get(), 0);
+    emit(Opcode::Store, kNoReg, {zero, address});
+  }
+  return address;
+}
+
+Reg FunctionLowering::value(const ast::Value& value) {
+  return ast::visit(value,
+                    [this](const auto& node) { return lowerValue(node); });
+}
+
+Reg FunctionLowering::loadedValue(const ast::Value& value) {
+  Reg reg = this->value(value);
+  const VarType& type = *value.type;
+  if (type.isPrValue()) {
+    return reg;  // already in a register
+  } else if (type.isNumeric() || type.isSlice() || type.isRef()) {
+    Reg loaded = newReg(regTypeOf(type));
+    emit(Opcode::Load, loaded, {reg}, &type);
+    return loaded;
+  } else if (type.isArray() || type.isStruct()) {
+    return reg;
+  } else if (type.isVoid()) {
+    return kNoReg;
+  }
+  FRONTEND_ERROR("no matching type found for load");
+}
+
+Reg FunctionLowering::convertedValue(const ast::Value& value,
+                                    const VarType& to) {
+  return convert(loadedValue(value), *value.type, to);
+}
+
+Reg FunctionLowering::conditionValue(const ast::Value& value) {
+  Reg cond = loadedValue(value);
+  if (f_.reg_type[cond] == RegType::I1) {
+    return cond;
+  }
+  return compareWithZero(cond, valueType(*value.type));
+}
+
+Reg FunctionLowering::indexValue(const ast::Value& index) {
+  Reg reg = loadedValue(index);
+  if (f_.reg_type[reg] == RegType::I64) {
+    return reg;
+  }
+  Reg extended = newReg(RegType::I64);
+  emit(valueType(*index.type).isSigned() ? Opcode::SExt : Opcode::ZExt,
+       extended, {reg});
+  return extended;
+}
+
+Reg FunctionLowering::convert(Reg value, const VarType& from,
+                              const VarType& to) {
+  const VarType& from_value = valueType(from);
+  const VarType& to_value = valueType(to);
+  if (to_value.isSlice() && from_value.isArray()) {
+    // an array becomes a slice of all its elements
+    Reg slice = newReg(RegType::Slice);
+    emit(Opcode::MakeSlice, slice, {value}, &to_value,
+         from_value.getArraySize());
+    return slice;
+  }
+  if (!from_value.isNumeric() || !to_value.isNumeric()) {
+    return value;
+  }
+  Opcode op;
+  switch (VarType::getConversion(from_value, to_value)) {
+    case VarType::Conversion::NONE:
+      return value;
+    case VarType::Conversion::TRUNC:
+      op = Opcode::Trunc;
+      break;
+    case VarType::Conversion::SEXT:
+      op = Opcode::SExt;
+      break;
+    case VarType::Conversion::ZEXT:
+      op = Opcode::ZExt;
+      break;
+    case VarType::Conversion::TO_BOOL:
+      return compareWithZero(value, from_value);
+    case VarType::Conversion::FP_TRUNC:
+      op = Opcode::FPTrunc;
+      break;
+    case VarType::Conversion::FP_EXT:
+      op = Opcode::FPExt;
+      break;
+    case VarType::Conversion::SI_TO_FP:
+      op = Opcode::SIToFP;
+      break;
+    case VarType::Conversion::UI_TO_FP:
+      op = Opcode::UIToFP;
+      break;
+    case VarType::Conversion::FP_TO_SI:
+      op = Opcode::FPToSI;
+      break;
+    case VarType::Conversion::FP_TO_UI:
+      op = Opcode::FPToUI;
+      break;
+    default:
+      FRONTEND_ERROR("unknown conversion");
+  }
+  Reg converted = newReg(regTypeOf(to_value));
+  emit(op, converted, {value});
+  return converted;
+}
+
+Reg FunctionLowering::compareWithZero(Reg value, const VarType& type) {
+  Reg zero = newReg(regTypeOf(type));
+  emit(Opcode::Const, zero, {}, &type, 0);
+  Reg cond = newReg(RegType::I1);
+  emit(Opcode::CmpNe, cond, {value, zero}, &type);
+  return cond;
+}
+
+Reg FunctionLowering::lowerValue(const ast::Variable& var) {
+  return variableAddress(var);
+}
+
+Reg FunctionLowering::lowerValue(const ast::Integer& num) {
+  Reg reg = newReg(regTypeOf(*num.type));
+  emit(Opcode::Const, reg, {}, num.type.get(), num.value);
+  return reg;
+}
+
+Reg FunctionLowering::lowerValue(const ast::Float& num) {
+  Reg reg = newReg(regTypeOf(*num.type));
+  emit(Opcode::Const, reg, {}, num.type.get(),
+       std::bit_cast<int64_t>(num.value));
+  return reg;
+}
+
+Reg FunctionLowering::lowerValue(const ast::FunctionName&) {
+  FRONTEND_ERROR("a function name is only supported as a callee");
+}
+
+Reg FunctionLowering::lowerValue(const ast::BinaryOperation& bin_op) {
+  Opcode op = binopToOpcode(bin_op.op);
+  const VarType& type = *bin_op.operand_type;
+  Reg lhs = convertedValue(*bin_op.lhs, type);
+  Reg rhs = convertedValue(*bin_op.rhs, type);
+  Reg reg = newReg(regTypeOf(*bin_op.type));
+  emit(op, reg, {lhs, rhs}, &type);
+  return reg;
+}
+
+Reg FunctionLowering::lowerValue(const ast::FunctionCall& call) {
+  const auto* callee = ast::cast<ast::FunctionName>(call.function);
+  std::vector<uint32_t> args;
+  args.reserve(call.args.size() + 1);
+  for (size_t i = 0; i < call.args.size(); i++) {
+    if (i < call.arg_types.size() && call.arg_types[i]->isRef()) {
+      // pass the reference by value, no need to load
+      args.push_back(value(*call.args[i]));
+    } else if (i < call.arg_types.size()) {
+      args.push_back(convertedValue(*call.args[i], *call.arg_types[i]));
+    } else {
+      args.push_back(loadedValue(*call.args[i]));
+    }
+  }
+  if (call.type->isArray() || call.type->isStruct()) {
+    // the callee writes the returned object to a slot in this frame
+    args.push_back(slotAddress(newSlot(*call.type, Symbol())));
+  }
+  Reg reg = call.type->isVoid() ? kNoReg : newReg(regTypeOf(*call.type));
+  emit(Opcode::Call, reg, args, call.type.get(), calleeIndex(callee->name));
+  return reg;
+}
+
+Reg FunctionLowering::lowerValue(const ast::ArrayAccess& access) {
+  const VarType& variable_type = *access.var->type;
+  const VarType& array_type = variable_type.isRef()
+                                  ? *variable_type.getReferencedType()
+                                  : variable_type;
+  std::vector<uint32_t> operands = {loadedValue(*access.var)};
+  if (array_type.isSlice()) {
+    Reg data = newReg(RegType::Ptr);
+    emit(Opcode::SliceData, data, {operands[0]});
+    operands[0] = data;
+  }
+  for (const auto& index : access.indices) {
+    operands.push_back(indexValue(*index));
+  }
+  Reg reg = newReg(RegType::Ptr);
+  emit(Opcode::ElemAddr, reg, operands, &array_type);
+  return reg;
+}
+
+Reg FunctionLowering::lowerValue(const ast::ArrayAllocate& alloc) {
+  const auto* length = ast::cast<ast::Integer>(alloc.length);
+  Reg array = slotAddress(newSlot(*alloc.type, Symbol()));
+  for (int64_t i = 0; i < length->value; i++) {
+    Reg index = newReg(RegType::I64);
+    emit(Opcode::Const, index, {}, length->type.get(), i);
+    Reg elem = newReg(RegType::Ptr);
+    emit(Opcode::ElemAddr, elem, {array, index}, alloc.type.get());
+    emit(Opcode::Store, kNoReg, {loadedValue(*alloc.elem_value), elem});
+  }
+  return array;
+}
+
+Reg FunctionLowering::lowerValue(const ast::ArrayLength& length) {
+  const VarType& array_type = valueType(*length.array->type);
+  if (array_type.isArray()) {
+    // the size is part of the type, the array is not evaluated
+    Reg reg = newReg(RegType::I64);
+    emit(Opcode::Const, reg, {}, length.type.get(), array_type.getArraySize());
+    return reg;
+  }
+  Reg slice = loadedValue(*length.array);
+  Reg reg = newReg(RegType::I64);
+  emit(Opcode::SliceLength, reg, {slice});
+  return reg;
+}
+
+void FunctionLowering::lower(const ast::Instruction& inst) {
+  if (inst.line != 0) {
+    line_ = inst.line;
+  }
+  ast::visit(inst, [this](const auto& node) { lowerInst(node); });
+}
+
+void FunctionLowering::lowerInst(const ast::InstructionReturn& ret) {
+  if (ret.val == nullptr) {
+    emit(Opcode::Ret, kNoReg, {});
+    return;
+  }
+  const VarType& type = *ret.val->type;
+  if (type.isArray() || type.isStruct()) {
+    // copy the returned object to where the caller wants it
+    Reg ret_arg = newReg(RegType::Ptr);
+    emit(Opcode::Arg, ret_arg, {}, &type,
+         static_cast<int64_t>(source_.args.size()));
+    emit(Opcode::Copy, kNoReg, {ret_arg, loadedValue(*ret.val)}, &type);
+    emit(Opcode::Ret, kNoReg, {ret_arg});
+  } else {
+    // ret.type is the function's return type
+    emit(Opcode::Ret, kNoReg, {convertedValue(*ret.val, *ret.type)});
+  }
+}
+
+void FunctionLowering::lowerInst(const ast::InstructionAssignment& assign) {
+  const VarType& src_type = *assign.src->type;
+  const VarType& dst_type = *assign.dst->type;
+  Reg src = convertedValue(*assign.src, dst_type);
+  Reg dst = value(*assign.dst);
+
+  bool prim_to_prim = src_type.isPrimitive();
+  bool ref_to_prim = src_type.isRef() && dst_type.isPrimitive();
+  bool stack_to_stack = src_type.isStack() && dst_type.isStack();
+  bool stack_to_ref = src_type.isStack() && dst_type.isRef();
+  bool ref_to_stack = src_type.isRef() && dst_type.isStack();
+  bool ref_to_ref = src_type.isRef() && dst_type.isRef();
+  // src was converted to the (pointer, length) pair
+  bool to_slice = dst_type.isSlice();
+
+  if (prim_to_prim || ref_to_prim || to_slice) {
+    emit(Opcode::Store, kNoReg, {src, dst});
+  } else if (ref_to_stack || stack_to_stack) {
+    // the copied object is the destination's, src may refer to it
+    emit(Opcode::Copy, kNoReg, {dst, src}, &dst_type);
+  } else if (stack_to_ref || ref_to_ref) {
+    // store the address into the reference's slot
+    emit(Opcode::Store, kNoReg, {src, dst});
+  } else {
+    FRONTEND_ERROR("unknown assignment type");
+  }
+}
+
+void FunctionLowering::lowerInst(const ast::InstructionFunctionCall& call) {
+  loadedValue(*call.function_call);
+}
+
+void FunctionLowering::lowerInst(const ast::InstructionWhileLoop& loop) {
+  BlockId cond_block = newBlock("while-cond");
+  BlockId body_block = newBlock("while-body");
+  BlockId continue_block = newBlock("continue");
+
+  emit(Opcode::Jump, kNoReg, {cond_block});
+  startBlock(cond_block);
+  Reg cond = conditionValue(*loop.cond);
+  emit(Opcode::Branch, kNoReg, {cond, body_block, continue_block});
+
+  startBlock(body_block);
+  lower(*loop.body);
+  emit(Opcode::Jump, kNoReg, {cond_block});
+
+  startBlock(continue_block);
+}
+
+void FunctionLowering::lowerInst(const ast::InstructionIfStatement& if_stmt) {
+  Reg cond = conditionValue(*if_stmt.cond);
+  BlockId true_block = newBlock("true-block");
+  BlockId continue_block = newBlock("continue-block");
+  emit(Opcode::Branch, kNoReg, {cond, true_block, continue_block});
+
+  startBlock(true_block);
+  lower(*if_stmt.true_scope);
+  emit(Opcode::Jump, kNoReg, {continue_block});
+
+  startBlock(continue_block);
+}
+
+void FunctionLowering::lowerInst(const ast::InstructionBreak&) {
+  FRONTEND_ERROR("break is not supported");
+}
+
+void FunctionLowering::lowerInst(const ast::InstructionContinue&) {
+  FRONTEND_ERROR("continue is not supported");
+}
+
+void FunctionLowering::lowerInst(const ast::InstructionDecl& decl) {
+  for (const auto& var : decl.variables) {
+    value(*var);
+  }
+}
+
+void FunctionLowering::lowerInst(const ast::Scope& scope) {
+  for (const ast::ConstInstrPtr& inst : scope.instructions) {
+    lower(*inst);
+  }
+}
+}  // namespace
+
+Function lowerFunction(const ast::Function& function) {
+  Function f;
+  FunctionLowering(function, f).lower();
+  return f;
+}
+
+Module lowerProgram(const Program& program) {
+  Module module;
+  module.functions.reserve(program.functions.size());
+  for (const auto* f : program.functions) {
+    module.functions.push_back(lowerFunction(*f));
+  }
+  module.declarations = program.imported_functions;
+  return module;
+}
+
+}  // namespace frontend::mir
@@ -0,0 +1,180 @@
+#include "frontend/mir/mir.h"
+
+#include <bit>
+#include <ostream>
+
+#include "frontend/ast/ast.h"
+#include "frontend/diagnostic/debug.h"
+
+namespace frontend::mir {
+namespace {
+const char* regTypeName(RegType type) {
+  switch (type) {
+    case RegType::I1:
+      return "i1";
+    case RegType::I8:
+      return "i8";
+    case RegType::I16:
+      return "i16";
+    case RegType::I32:
+      return "i32";
+    case RegType::I64:
+      return "i64";
+    case RegType::F32:
+      return "f32";
+    case RegType::F64:
+      return "f64";
+    case RegType::Ptr:
+      return "ptr";
+    case RegType::Slice:
+      return "slice";
+  }
+  FRONTEND_ERROR("unknown register type");
+}
+
+void printInstruction(const Function& f, InstId i, std::ostream& stream) {
+  Opcode op = f.opcode[i];
+  stream << "  ";
+  if (f.result[i] != kNoReg) {
+    stream << "%" << f.result[i] << ":" << regTypeName(f.reg_type[f.result[i]])
+           << " = ";
+  }
+  stream << opcodeName(op);
+  switch (op) {
+    case Opcode::Const:
+      if (f.type[i]->isFloat()) {
+        stream << " " << std::bit_cast<double>(f.imm[i]);
+      } else {
+        stream << " " << f.imm[i];
+      }
+      break;
+    case Opcode::Arg:
+    case Opcode::MakeSlice:
+      stream << " " << f.imm[i];
+      break;
+    case Opcode::SlotAddr:
+      stream << " $" << f.imm[i];
+      break;
+    case Opcode::Call:
+      stream << " " << f.callees[f.imm[i]];
+      break;
+    default:
+      break;
+  }
+
+  auto operands = f.operandsOf(i);
+  for (size_t k = 0; k < operands.size(); k++) {
+    stream << (k == 0 ? " " : ", ");
+    bool is_block = (op == Opcode::Jump) || (op == Opcode::Branch && k > 0);
+    stream << (is_block ? "bb" : "%") << operands[k];
+  }
+  if (op == Opcode::Load || op == Opcode::Copy || op == Opcode::ElemAddr ||
+      (op >= Opcode::CmpLt && op <= Opcode::CmpNe)) {
+    stream << " : " << f.type[i]->getTypeName();
+  }
+  stream << "\n";
+}
+}  // namespace
+
+const char* opcodeName(Opcode op) {
+  switch (op) {
+    case Opcode::Const:
+      return "const";
+    case Opcode::SlotAddr:
+      return "slot";
+    case Opcode::Arg:
+      return "arg";
+    case Opcode::Load:
+      return "load";
+    case Opcode::Store:
+      return "store";
+    case Opcode::Copy:
+      return "copy";
+    case Opcode::Add:
+      return "add";
+    case Opcode::Sub:
+      return "sub";
+    case Opcode::Mul:
+      return "mul";
+    case Opcode::And:
+      return "and";
+    case Opcode::Shl:
+      return "shl";
+    case Opcode::Shr:
+      return "shr";
+    case Opcode::CmpLt:
+      return "cmp.lt";
+    case Opcode::CmpGt:
+      return "cmp.gt";
+    case Opcode::CmpLe:
+      return "cmp.le";
+    case Opcode::CmpGe:
+      return "cmp.ge";
+    case Opcode::CmpEq:
+      return "cmp.eq";
+    case Opcode::CmpNe:
+      return "cmp.ne";
+    case Opcode::Trunc:
+      return "trunc";
+    case Opcode::SExt:
+      return "sext";
+    case Opcode::ZExt:
+      return "zext";
+    case Opcode::FPTrunc:
+      return "fptrunc";
+    case Opcode::FPExt:
+      return "fpext";
+    case Opcode::SIToFP:
+      return "sitofp";
+    case Opcode::UIToFP:
+      return "uitofp";
+    case Opcode::FPToSI:
+      return "fptosi";
+    case Opcode::FPToUI:
+      return "fptoui";
+    case Opcode::ElemAddr:
+      return "elemaddr";
+    case Opcode::MakeSlice:
+      return "makeslice";
+    case Opcode::SliceData:
+      return "slice.data";
+    case Opcode::SliceLength:
+      return "slice.length";
+    case Opcode::Call:
+      return "call";
+    case Opcode::Jump:
+      return "jump";
+    case Opcode::Branch:
+      return "branch";
+    case Opcode::Ret:
+      return "ret";
+  }
+  FRONTEND_ERROR("unknown opcode");
+}
+
+void print(const Function& f, std::ostream& stream) {
+  stream << "function " << f.source->type->getTypeName() << " "
+         << f.source->name << "\n";
+  for (SlotId s = 0; s < f.slots.size(); s++) {
+    stream << "  $" << s << " " << f.slots[s].type->getTypeName();
+    if (!f.slots[s].name.empty()) {
+      stream << " " << f.slots[s].name;
+    }
+    stream << "\n";
+  }
+  for (BlockId b = 0; b < f.blocks(); b++) {
+    stream << "bb" << b << " " << f.block_name[b] << ":\n";
+    for (InstId i = f.block_begin[b]; i < f.block_begin[b + 1]; i++) {
+      printInstruction(f, i, stream);
+    }
+  }
+}
+
+void print(const Module& module, std::ostream& stream) {
+  for (const Function& f : module.functions) {
+    print(f, stream);
+    stream << "\n";
+  }
+}
+
+}  // namespace frontend::mir
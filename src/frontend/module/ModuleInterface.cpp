@@ -0,0 +1,444 @@
+#include "frontend/module/ModuleInterface.h"
+
+#include <llvm/Support/ErrorOr.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "frontend/ast/ast.h"
+#include "frontend/diagnostic/debug.h"
+#include "frontend/symbol/Symbol.h"
+#include "frontend/types/VarType.h"
+
+namespace frontend {
+namespace {
+constexpr char kMagic[8] = {'P', 'R', 'O', 'G', 'M', 'O', 'D', 'I'};
+// bumped whenever an entry changes
+constexpr uint32_t kVersion = 3;
+// the entries are in the byte order of the machine that wrote them, a
+// machine of the other byte order reads this marker reversed
+constexpr uint32_t kByteOrder = 0x01020304;
+constexpr uint32_t kOtherByteOrder = 0x04030201;
+constexpr uint32_t kNoName = UINT32_MAX;
+constexpr uint8_t kReorder = 1;
+
+// the serialized Program: what the module defines and how long each table is
+struct Header {
+  char magic[8];
+  uint32_t byte_order;  // kByteOrder, before anything it decides how to read
+  uint32_t version;
+  uint32_t name;  // of the module
+  uint32_t num_strings;
+  uint32_t num_types;
+  uint32_t num_members;
+  uint32_t num_structs;
+  uint32_t num_functions;
+  uint32_t num_params;
+  uint64_t string_bytes;
+};
+
+// a VarType, its members are earlier entries
+struct TypeEntry {
+  uint32_t name;
+  uint8_t type_category;
+  uint8_t value_category;
+  uint8_t align;  // of a struct: log2 of align(N) plus one, 0 for none
+  uint8_t flags;  // kReorder
+  int64_t n_dims;
+  int64_t size;
+  uint32_t member_begin;
+  uint32_t member_count;
+};
+
+// a member of a type or a parameter of a function
+struct MemberEntry {
+  uint32_t type;
+  uint32_t name;  // kNoName for array elements and referenced types
+};
+
+struct FunctionEntry {
+  uint32_t name;
+  uint32_t return_type;
+  uint32_t param_begin;
+  uint32_t param_count;
+};
+
+// byte offsets of the tables, each one starts 8-byte aligned
+struct Layout {
+  uint64_t string_offsets;  // num_strings + 1 uint32_t
+  uint64_t types;
+  uint64_t members;
+  uint64_t structs;  // num_structs uint32_t, indices of types
+  uint64_t functions;
+  uint64_t params;
+  uint64_t string_data;
+  uint64_t end;
+};
+
+uint64_t alignTo8(uint64_t offset) {
+  return (offset + 7) & ~uint64_t(7);
+}
+
+Layout layoutOf(const Header& header) {
+  Layout layout{};
+  layout.string_offsets = alignTo8(sizeof(Header));
+  layout.types = alignTo8(layout.string_offsets +
+                          (uint64_t(header.num_strings) + 1) * 4);
+  layout.members = alignTo8(layout.types +
+                            uint64_t(header.num_types) * sizeof(TypeEntry));
+  layout.structs = alignTo8(layout.members + uint64_t(header.num_members) *
+                                                 sizeof(MemberEntry));
+  layout.functions =
+      alignTo8(layout.structs + uint64_t(header.num_structs) * 4);
+  layout.params = alignTo8(layout.functions + uint64_t(header.num_functions) *
+                                                  sizeof(FunctionEntry));
+  layout.string_data = alignTo8(layout.params + uint64_t(header.num_params) *
+                                                    sizeof(MemberEntry));
+  layout.end = layout.string_data + header.string_bytes;
+  return layout;
+}
+
+template <typename T>
+void append(std::string& out, uint64_t offset, std::span<const T> entries) {
+  out.resize(offset, '\0');
+  out.append(reinterpret_cast<const char*>(entries.data()),
+             entries.size_bytes());
+}
+
+[[noreturn]] void corrupt(std::string_view what) {
+  FRONTEND_ERROR("corrupt module interface: " + std::string(what));
+}
+}  // namespace
+
+struct ModuleInterface::Writer {
+  std::vector<uint32_t> string_offsets = {0};
+  std::string string_data;
+  std::unordered_map<Symbol, uint32_t> strings;
+  std::vector<TypeEntry> types;
+  std::vector<MemberEntry> members;
+  std::unordered_map<const VarType*, uint32_t> type_indices;
+
+  uint32_t string(Symbol symbol) {
+    auto [it, inserted] = strings.emplace(symbol, strings.size());
+    if (inserted) {
+      string_data += symbol.str();
+      string_offsets.push_back(string_data.size());
+    }
+    return it->second;
+  }
+  std::string_view text(uint32_t index) const {
+    return std::string_view(string_data)
+        .substr(string_offsets[index],
+                string_offsets[index + 1] - string_offsets[index]);
+  }
+};
+
+// members are written first, so a reader can create every type from types it
+// already created
+uint32_t ModuleInterface::encodeType(Writer& writer, const VarType& type) {
+  auto it = writer.type_indices.find(&type);
+  if (it != writer.type_indices.end()) {
+    return it->second;
+  }
+  std::vector<uint32_t> member_names(type.members_.size(), kNoName);
+  for (const auto& [member_name, index] : type.member_name_to_index_) {
+    member_names[index] = writer.string(member_name);
+  }
+  std::vector<MemberEntry> members;
+  for (size_t i = 0; i < type.members_.size(); i++) {
+    members.push_back({encodeType(writer, *type.members_[i]), member_names[i]});
+  }
+
+  TypeEntry entry{};
+  entry.name = writer.string(type.type_id_.type_name);
+  entry.type_category = static_cast<uint8_t>(type.type_id_.type_category);
+  entry.value_category = static_cast<uint8_t>(type.type_id_.value_category);
+  if (type.attributes_.align != 0) {
+    entry.align =
+        std::countr_zero(static_cast<uint64_t>(type.attributes_.align)) + 1;
+  }
+  entry.flags = type.attributes_.reorder ? kReorder : 0;
+  entry.n_dims = type.type_id_.n_dims;
+  entry.size = type.type_id_.size;
+  entry.member_begin = writer.members.size();
+  entry.member_count = members.size();
+  writer.members.insert(writer.members.end(), members.begin(), members.end());
+
+  uint32_t index = writer.types.size();
+  writer.types.push_back(entry);
+  writer.type_indices.emplace(&type, index);
+  return index;
+}
+
+void ModuleInterface::write(const Program& program, const std::string& path) {
+  Writer writer;
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.byte_order = kByteOrder;
+  header.version = kVersion;
+  header.name =
+      writer.string(Symbol(std::filesystem::path(path).stem().string()));
+
+  std::vector<uint32_t> structs;
+  for (const auto* struct_decl : program.structs) {
+    structs.push_back(encodeType(writer, *struct_decl->type));
+  }
+  std::vector<FunctionEntry> functions;
+  std::vector<MemberEntry> params;
+  for (const auto* f : program.functions) {
+    FunctionEntry entry{};
+    entry.name = writer.string(f->name);
+    entry.return_type = encodeType(writer, *f->type);
+    entry.param_begin = params.size();
+    entry.param_count = f->args.size();
+    for (const auto& arg : f->args) {
+      const auto* var = ast::cast<ast::Variable>(arg);
+      params.push_back({encodeType(writer, *var->type),
+                        writer.string(var->name)});
+    }
+    functions.push_back(entry);
+  }
+  // sorted by name, so a reader finds a function without building an index
+  std::sort(functions.begin(), functions.end(),
+            [&](const FunctionEntry& a, const FunctionEntry& b) {
+              return writer.text(a.name) < writer.text(b.name);
+            });
+
+  header.num_strings = writer.strings.size();
+  header.num_types = writer.types.size();
+  header.num_members = writer.members.size();
+  header.num_structs = structs.size();
+  header.num_functions = functions.size();
+  header.num_params = params.size();
+  header.string_bytes = writer.string_data.size();
+  Layout layout = layoutOf(header);
+
+  std::string out(reinterpret_cast<const char*>(&header), sizeof(header));
+  append<uint32_t>(out, layout.string_offsets, writer.string_offsets);
+  append<TypeEntry>(out, layout.types, writer.types);
+  append<MemberEntry>(out, layout.members, writer.members);
+  append<uint32_t>(out, layout.structs, structs);
+  append<FunctionEntry>(out, layout.functions, functions);
+  append<MemberEntry>(out, layout.params, params);
+  out.resize(layout.string_data, '\0');
+  out += writer.string_data;
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(out.data(), static_cast<std::streamsize>(out.size()));
+  if (!file) {
+    FRONTEND_ERROR("could not write module interface " + path);
+  }
+}
+
+std::unique_ptr<ModuleInterface> ModuleInterface::open(const std::string& path,
+                                                       TypeTable& table) {
+  // large files are mapped instead of read, nothing is copied out of the
+  // buffer except the text of the names a program uses
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    FRONTEND_ERROR("could not read module interface " + path + ": " +
+                   buffer.getError().message());
+  }
+  return std::unique_ptr<ModuleInterface>(
+      new ModuleInterface(std::move(*buffer), table));
+}
+
+ModuleInterface::ModuleInterface(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                                 TypeTable& table)
+    : buffer_(std::move(buffer)), table_(table) {
+  Header header;
+  if (buffer_->getBufferSize() < sizeof(header)) {
+    corrupt("file too short");
+  }
+  std::memcpy(&header, buffer_->getBufferStart(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    corrupt("not a module interface");
+  }
+  if (header.byte_order == kOtherByteOrder) {
+    corrupt("written on a machine of the other byte order");
+  }
+  if (header.byte_order != kByteOrder || header.version != kVersion) {
+    corrupt("written by another version of the compiler");
+  }
+  Layout layout = layoutOf(header);
+  if (layout.end > buffer_->getBufferSize()) {
+    corrupt("file too short");
+  }
+  num_strings_ = header.num_strings;
+  num_types_ = header.num_types;
+  num_members_ = header.num_members;
+  num_functions_ = header.num_functions;
+  num_params_ = header.num_params;
+  string_offsets_ = layout.string_offsets;
+  types_offset_ = layout.types;
+  members_offset_ = layout.members;
+  functions_offset_ = layout.functions;
+  params_offset_ = layout.params;
+  string_data_ = layout.string_data;
+  types_.resize(num_types_);
+
+  name_ = Symbol(string(header.name));
+  // importing programs refer to the structs by name, so they are created now
+  for (uint32_t i = 0; i < header.num_structs; i++) {
+    structs_.push_back(decodeType(entry<uint32_t>(layout.structs, i)));
+  }
+}
+
+ModuleInterface::~ModuleInterface() = default;
+
+template <typename T>
+T ModuleInterface::entry(uint64_t section, uint32_t index) const {
+  // the buffer is only byte aligned when it is read instead of mapped
+  T value;
+  std::memcpy(&value, buffer_->getBufferStart() + section + index * sizeof(T),
+              sizeof(T));
+  return value;
+}
+
+std::string_view ModuleInterface::string(uint32_t index) const {
+  if (index >= num_strings_) {
+    corrupt("string index out of range");
+  }
+  uint32_t begin = entry<uint32_t>(string_offsets_, index);
+  uint32_t end = entry<uint32_t>(string_offsets_, index + 1);
+  if (begin > end || end > buffer_->getBufferSize() - string_data_) {
+    corrupt("string out of range");
+  }
+  return {buffer_->getBufferStart() + string_data_ + begin, end - begin};
+}
+
+ConstVarTypePtr ModuleInterface::decodeType(uint32_t index) {
+  if (index >= num_types_) {
+    corrupt("type index out of range");
+  }
+  if (types_[index]) {
+    return types_[index];
+  }
+  auto type_entry = entry<TypeEntry>(types_offset_, index);
+  if (type_entry.type_category >
+          static_cast<uint8_t>(VarType::TypeCat::SLICE) ||
+      type_entry.value_category >
+          static_cast<uint8_t>(VarType::ValCat::PrValue) ||
+      type_entry.align > 63 || (type_entry.flags & ~kReorder) != 0 ||
+      type_entry.member_begin > num_members_ ||
+      type_entry.member_count > num_members_ - type_entry.member_begin) {
+    corrupt("bad type entry");
+  }
+
+  VarType::MemberTypes members;
+  VarType::MemberNameToIndex member_name_to_index;
+  for (uint32_t i = 0; i < type_entry.member_count; i++) {
+    auto member =
+        entry<MemberEntry>(members_offset_, type_entry.member_begin + i);
+    // members come first, this also rules out cycles
+    if (member.type >= index) {
+      corrupt("member defined after its type");
+    }
+    members.push_back(decodeType(member.type));
+    if (member.name != kNoName) {
+      member_name_to_index[Symbol(string(member.name))] = i;
+    }
+  }
+  VarType::TypeIdentifier type_id(
+      Symbol(string(type_entry.name)), type_entry.n_dims, type_entry.size,
+      static_cast<VarType::TypeCat>(type_entry.type_category),
+      static_cast<VarType::ValCat>(type_entry.value_category));
+  VarType::StructAttributes attributes;
+  if (type_entry.align != 0) {
+    attributes.align = int64_t{1} << (type_entry.align - 1);
+  }
+  attributes.reorder = (type_entry.flags & kReorder) != 0;
+  ConstVarTypePtr type = VarType::findVarTypeOrCreate(
+      table_, type_id, members, member_name_to_index, attributes);
+  // a struct the importing program already knows under the same name
+  if (type->isStruct() &&
+      (type->members_ != members || type->attributes_ != attributes)) {
+    FRONTEND_ERROR("struct " + std::string(type_id.type_name.str()) +
+                   " of module " + std::string(name_.str()) +
+                   " does not match the struct of the same name");
+  }
+  types_[index] = type;
+  return type;
+}
+
+const ast::Function* ModuleInterface::findFunction(Symbol name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string_view text = name.str();
+  uint32_t low = 0;
+  uint32_t high = num_functions_;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    std::string_view middle_name =
+        string(entry<FunctionEntry>(functions_offset_, middle).name);
+    if (middle_name == text) {
+      return decodeFunction(middle);
+    }
+    if (middle_name < text) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return nullptr;
+}
+
+const ast::Function* ModuleInterface::decodeFunction(uint32_t index) {
+  auto it = declarations_.find(index);
+  if (it != declarations_.end()) {
+    return it->second;
+  }
+  auto function_entry = entry<FunctionEntry>(functions_offset_, index);
+  if (function_entry.param_begin > num_params_ ||
+      function_entry.param_count > num_params_ - function_entry.param_begin) {
+    corrupt("bad function entry");
+  }
+  auto* f = arena_.make<ast::Function>();
+  f->name = Symbol(string(function_entry.name));
+  f->type = decodeType(function_entry.return_type);
+  for (uint32_t i = 0; i < function_entry.param_count; i++) {
+    auto param =
+        entry<MemberEntry>(params_offset_, function_entry.param_begin + i);
+    auto* arg = f->getVariable(Symbol(string(param.name)), arena_);
+    arg->type = decodeType(param.type);
+    f->args.push_back(arg);
+  }
+  declarations_.emplace(index, f);
+  return f;
+}
+
+std::string findModuleInterface(std::string_view name,
+                                std::string_view importing_file,
+                                std::span<const std::string> search_paths) {
+  std::string file_name =
+      std::string(name) + std::string(kModuleInterfaceExtension);
+  std::vector<std::filesystem::path> candidates;
+  candidates.push_back(
+      std::filesystem::path(importing_file).parent_path() / file_name);
+  for (const auto& search_path : search_paths) {
+    candidates.push_back(std::filesystem::path(search_path) / file_name);
+  }
+  for (const auto& candidate : candidates) {
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(candidate, ec)) {
+      return candidate.string();
+    }
+  }
+  return {};
+}
+
+}  // namespace frontend
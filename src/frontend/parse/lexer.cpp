@@ -0,0 +1,174 @@
+#include "frontend/parse/lexer.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace frontend::lexer {
+namespace {
+bool isIdentStart(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' ||
+         c == '\f';
+}
+
+// length of the punctuator starting at source[pos]
+uint32_t punctuatorLength(std::string_view source, size_t pos) {
+  if (pos + 1 < source.size()) {
+    char c = source[pos];
+    char next = source[pos + 1];
+    if ((c == '<' && (next == '=' || next == '<')) ||
+        (c == '>' && (next == '=' || next == '>')) ||
+        (c == '=' && next == '=')) {
+      return 2;
+    }
+  }
+  return 1;
+}
+
+// number of tokens taken by the import declarations at the start of tokens,
+// each one is the keyword followed by the module name
+size_t countImportTokens(std::string_view source,
+                         std::span<const Token> tokens) {
+  size_t count = 0;
+  while (count + 1 < tokens.size() &&
+         tokenText(source, tokens[count]) == "import" &&
+         tokens[count + 1].kind == TokenKind::Identifier) {
+    count += 2;
+  }
+  return count;
+}
+}  // namespace
+
+std::vector<Token> tokenize(std::string_view source) {
+  std::vector<Token> tokens;
+  // most tokens are short, this avoids most regrowth without a second pass
+  tokens.reserve(source.size() / 4);
+
+  uint32_t line = 1;
+  size_t pos = 0;
+  while (pos < source.size()) {
+    char c = source[pos];
+    if (c == '\n') {
+      line++;
+      pos++;
+    } else if (isSpace(c)) {
+      pos++;
+    } else if (c == '/' && pos + 1 < source.size() && source[pos + 1] == '/') {
+      // comment runs until the end of the line, the newline itself is
+      // handled above so line numbers stay correct
+      while (pos < source.size() && source[pos] != '\n') {
+        pos++;
+      }
+    } else if (isIdentStart(c)) {
+      size_t start = pos;
+      while (pos < source.size() &&
+             (isIdentStart(source[pos]) || isDigit(source[pos]))) {
+        pos++;
+      }
+      tokens.push_back({TokenKind::Identifier, static_cast<uint32_t>(start),
+                        static_cast<uint32_t>(pos - start), line});
+    } else if (isDigit(c)) {
+      size_t start = pos;
+      while (pos < source.size() && isDigit(source[pos])) {
+        pos++;
+      }
+      // the fraction of a floating-point literal
+      if (pos + 1 < source.size() && source[pos] == '.' &&
+          isDigit(source[pos + 1])) {
+        pos++;
+        while (pos < source.size() && isDigit(source[pos])) {
+          pos++;
+        }
+      }
+      tokens.push_back({TokenKind::Number, static_cast<uint32_t>(start),
+                        static_cast<uint32_t>(pos - start), line});
+    } else {
+      uint32_t length = punctuatorLength(source, pos);
+      tokens.push_back(
+          {TokenKind::Punctuator, static_cast<uint32_t>(pos), length, line});
+      pos += length;
+    }
+  }
+  return tokens;
+}
+
+std::string renderTokens(std::string_view source,
+                         std::span<const Token> tokens, uint32_t line,
+                         size_t offset) {
+  std::string out;
+  out.reserve(source.size() - offset);
+
+  size_t prev_end = offset;
+  for (const Token& tok : tokens) {
+    if (tok.offset != prev_end) {
+      // the grammar only cares that a separator exists, not what it was
+      if (tok.line == line) {
+        out.push_back(' ');
+      } else {
+        out.append(tok.line - line, '\n');
+        line = tok.line;
+      }
+    }
+    out.append(tokenText(source, tok));
+    prev_end = tok.offset + tok.length;
+  }
+  return out;
+}
+
+std::vector<Definition> splitDefinitions(std::string_view source,
+                                         std::span<const Token> tokens) {
+  std::vector<Definition> definitions;
+  size_t first_token = 0;
+  int64_t depth = 0;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    const Token& tok = tokens[i];
+    if (tok.kind != TokenKind::Punctuator) {
+      continue;
+    }
+    std::string_view text = tokenText(source, tok);
+    if (text == "{") {
+      depth++;
+    } else if (text == "}" && --depth == 0) {
+      size_t begin = definitions.empty() ? 0 : definitions.back().end;
+      uint32_t line = definitions.empty() ? 1 : tokens[first_token - 1].line;
+      // the first definition comes after the imports
+      size_t head = definitions.empty()
+                        ? countImportTokens(source, tokens.subspan(0, i))
+                        : first_token;
+      bool is_struct = tokenText(source, tokens[head]) == "struct";
+      definitions.push_back({begin, tok.offset + tok.length, line, is_struct,
+                             tokens.subspan(first_token, i + 1 - first_token)});
+      first_token = i + 1;
+    }
+  }
+  // trailing text stays with the last definition, so the grammar treats it
+  // exactly as it would when parsing the whole file
+  if (!definitions.empty()) {
+    Definition& last = definitions.back();
+    last.end = source.size();
+    last.tokens = tokens.subspan(last.tokens.data() - tokens.data());
+  }
+  return definitions;
+}
+
+std::vector<std::string_view> importedModules(std::string_view source,
+                                              std::span<const Token> tokens) {
+  std::vector<std::string_view> modules;
+  size_t count = countImportTokens(source, tokens);
+  for (size_t i = 1; i < count; i += 2) {
+    modules.push_back(tokenText(source, tokens[i]));
+  }
+  return modules;
+}
+
+}  // namespace frontend::lexer
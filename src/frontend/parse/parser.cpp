@@ -1,17 +1,33 @@
 #include "frontend/parse/parser.h"
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <ostream>
+#include <span>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <tao/pegtl.hpp>
+#include <tao/pegtl/mmap_input.hpp>
 #include <tao/pegtl/contrib/analyze.hpp>
 #include <tao/pegtl/contrib/raw_string.hpp>
 #include "frontend/ast/ast.h"
+#include "frontend/compilation_context.h"
 #include "frontend/diagnostic/debug.h"
+#include "frontend/module/ModuleInterface.h"
+#include "frontend/parse/lexer.h"
+#include "frontend/symbol/Symbol.h"
 #include "frontend/types/VarType.h"
 
 #undef FIRING_DEBUG
@@ -50,22 +66,204 @@ namespace frontend {
 namespace parser {
 
 struct State {
-  std::vector<std::unique_ptr<ast::Scope>> parsed_scopes;
+  // the compilation the parsed program belongs to, owns its types
+  CompilationContext* compilation = nullptr;
+
+  // for imports: interfaces are looked up next to the parsed file, then in
+  // the module paths
+  const char* file_name = "";
+  std::span<const std::string> module_paths;
+  std::unordered_set<const ast::Function*> imported_functions;
+
+  std::vector<ast::Scope*> parsed_scopes;
   std::vector<ast::ValuePtr> parsed_items;
   std::vector<std::vector<ast::ConstValuePtr>> parsed_function_args;
   std::vector<ast::Value> parsed_defined_function_args;
   std::vector<ast::ValuePtr> parsed_declared_vars;
-  ast::BinOpId parsed_binop = ast::BinOpId::NONE;
+
+  // for expressions: operands are pushed onto parsed_items and operators onto
+  // parsed_binops, each mark records where an expression's operands begin
+  struct ExpressionMark {
+    size_t first_item;
+    size_t first_binop;
+  };
+  std::vector<ast::BinOpId> parsed_binops;
+  std::vector<ExpressionMark> parsed_expression_marks;
 
   // for types
   std::vector<ConstVarTypePtr> parsed_vartypes;
-  std::vector<std::string> parsed_type_names;
+  std::vector<Symbol> parsed_type_names;
 
   // for structs
-  std::vector<std::string> parsed_struct_member_names;
-  std::string parsed_struct_name;
+  std::vector<Symbol> parsed_struct_member_names;
+  Symbol parsed_struct_name;
+  VarType::StructAttributes parsed_struct_attributes;
+
+  // for memoized parsing (see parser::control), results of memoized rules
+  // keyed by (rule, position)
+  struct MemoKey {
+    const void* rule;
+    const char* position;
+    bool operator==(const MemoKey&) const = default;
+  };
+  struct MemoKeyHash {
+    size_t operator()(const MemoKey& key) const {
+      return std::hash<const void*>()(key.rule) ^
+             (std::hash<const char*>()(key.position) * 31);
+    }
+  };
+  struct MemoEntry {
+    bool matched;
+    const char* end;
+  };
+  bool memoize = false;
+  std::unordered_map<MemoKey, MemoEntry, MemoKeyHash> memo;
+  // stats.rule_invocations is only counted when the caller asked for stats
+  bool count_rules = false;
+  ParseStats stats;
+
+  // for parsing a file in chunks: calls to functions defined in another
+  // chunk are resolved once all chunks are merged (see resolveCalls)
+  bool defer_unresolved_calls = false;
+  std::vector<ast::FunctionName*> unresolved_function_names;
+  std::vector<ast::FunctionCall*> unresolved_calls;
 };
 
+namespace {
+// type names may be written with whitespace between their tokens (e.g.
+// "int64 [10]"), the canonical name used for type lookup has none
+Symbol canonicalTypeName(std::string_view text) {
+  if (text.find(' ') == std::string_view::npos) {
+    return Symbol(text);
+  }
+  std::string type_name;
+  type_name.reserve(text.size());
+  for (char c : text) {
+    if (c != ' ') {
+      type_name.push_back(c);
+    }
+  }
+  return Symbol(type_name);
+}
+
+// the indices of an array access, those of accesses nested in an index are
+// not counted
+int64_t countIndices(std::string_view access) {
+  int64_t count = 0;
+  int64_t depth = 0;
+  for (char c : access) {
+    if (c == '[' && depth++ == 0) {
+      count++;
+    } else if (c == ']') {
+      depth--;
+    }
+  }
+  return count;
+}
+
+Symbol int64Name() {
+  static const Symbol name("int64");
+  return name;
+}
+
+Symbol float64Name() {
+  static const Symbol name("float64");
+  return name;
+}
+
+ModuleInterface* loadModule(CompilationContext& compilation,
+                            std::string_view name, const char* file_name,
+                            std::span<const std::string> module_paths) {
+  std::string path = findModuleInterface(name, file_name, module_paths);
+  if (path.empty()) {
+    FRONTEND_ERROR("could not find the interface of module " +
+                   std::string(name));
+  }
+  return &compilation.importModule(path);
+}
+
+void addImport(Program& p, ModuleInterface* module) {
+  if (std::find(p.imports.begin(), p.imports.end(), module) ==
+      p.imports.end()) {
+    p.imports.push_back(module);
+  }
+}
+
+// the declaration of an imported function, recorded in p the first time it
+// is called
+const ast::Function* findImportedFunction(Program& p, State& state,
+                                          Symbol name) {
+  for (ModuleInterface* module : p.imports) {
+    if (const ast::Function* f = module->findFunction(name)) {
+      if (state.imported_functions.insert(f).second) {
+        p.imported_functions.push_back(f);
+      }
+      return f;
+    }
+  }
+  return nullptr;
+}
+
+int64_t parseInteger(std::string_view text) {
+  // from_chars does not accept a leading '+'
+  if (!text.empty() && text.front() == '+') {
+    text.remove_prefix(1);
+  }
+  int64_t value = 0;
+  auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc() || ptr != text.data() + text.size()) {
+    FRONTEND_ERROR("invalid integer literal: " + std::string(text));
+  }
+  return value;
+}
+
+double parseFloat(std::string_view text) {
+  if (!text.empty() && text.front() == '+') {
+    text.remove_prefix(1);
+  }
+  double value = 0;
+  auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc() || ptr != text.data() + text.size()) {
+    FRONTEND_ERROR("invalid floating-point literal: " + std::string(text));
+  }
+  return value;
+}
+
+// the line of the first token of in, most rules start with seps so the
+// whitespace and comments before it are skipped
+template <typename Input>
+uint32_t firstTokenLine(const Input& in) {
+  auto line = static_cast<uint32_t>(in.position().line);
+  const char* c = in.begin();
+  const char* end = in.end();
+  while (c != end) {
+    if (*c == '\n') {
+      line++;
+      c++;
+    } else if (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\v' ||
+               *c == '\f') {
+      c++;
+    } else if (end - c >= 2 && c[0] == '/' && c[1] == '/') {
+      while (c != end && *c != '\n') {
+        c++;
+      }
+    } else {
+      break;
+    }
+  }
+  return line;
+}
+
+// sets the source line of a node the action made
+template <typename Input, typename T>
+T* atLine(const Input& in, T* node) {
+  node->line = firstTokenLine(in);
+  return node;
+}
+}  // namespace
+
 /*
  * Grammar rules from now on.
  */
@@ -95,6 +293,7 @@ struct str_and : TAO_PEGTL_STRING("&") {};
 
 struct str_print : TAO_PEGTL_STRING("print") {};
 struct str_input : TAO_PEGTL_STRING("input") {};
+struct str_length : TAO_PEGTL_STRING("length") {};
 
 struct keywords : pegtl::sor<str_return> {};
 
@@ -106,6 +305,12 @@ struct number
     : pegtl::seq<pegtl::opt<pegtl::sor<pegtl::one<'-'>, pegtl::one<'+'>>>,
                  pegtl::plus<pegtl::digit>> {};
 
+// a float64 literal, digits are required on both sides of the point
+struct float_number
+    : pegtl::seq<pegtl::opt<pegtl::sor<pegtl::one<'-'>, pegtl::one<'+'>>>,
+                 pegtl::plus<pegtl::digit>, pegtl::one<'.'>,
+                 pegtl::plus<pegtl::digit>> {};
+
 struct function_name_as_label_rule : function_name_rule {};
 
 struct library_function : pegtl::sor<str_print, str_input> {};
@@ -121,30 +326,33 @@ struct binop_rule : pegtl::sor<str_leq, str_geq, str_shl, str_shr, str_eq,
                                str_and> {};
 // attempt at adding more than 2 operands
 struct array_access_rule;
+struct array_length_rule;
 struct function_call_rule;
 struct array_allocate_rule;
-struct binary_operation_rule;
 
 struct single_expression_rule
     : pegtl::seq<pegtl::sor<
           pegtl::seq<pegtl::at<array_access_rule>, array_access_rule>,
+          pegtl::seq<pegtl::at<array_length_rule>, array_length_rule>,
           pegtl::seq<pegtl::at<function_call_rule>, function_call_rule>,
           pegtl::seq<pegtl::at<array_allocate_rule>, array_allocate_rule>,
-          variable_rule, number>> {};
+          variable_rule, float_number, number>> {};
 
+// The first operand of an expression. Once it has matched, the enclosing
+// expression_rule cannot fail anymore, so its action marks where the
+// expression's operands start.
+struct expression_head_rule : single_expression_rule {};
+
+struct binary_operand_rule
+    : pegtl::seq<seps, binop_rule, seps, single_expression_rule> {};
+
+// An expression is matched as a flat chain of operands and operators, every
+// operand is parsed exactly once. The tree is built with operator precedence
+// when the whole chain has been matched (see action<expression_rule>).
 struct expression_rule
-    : pegtl::seq<seps,
-                 pegtl::sor<binary_operation_rule, single_expression_rule>,
+    : pegtl::seq<seps, expression_head_rule, pegtl::star<binary_operand_rule>,
                  seps> {};
 
-struct binary_operation_rule
-    : pegtl::seq<
-          pegtl::seq<
-              pegtl::at<pegtl::seq<seps, single_expression_rule, seps,
-                                   binop_rule, seps>>,
-              pegtl::seq<seps, single_expression_rule, seps, binop_rule, seps>>,
-          pegtl::sor<binary_operation_rule, single_expression_rule>, seps> {};
-
 struct type_rule;
 struct type_name_rule : pegtl::seq<pegtl::not_at<keywords>, name> {};
 struct basic_type_rule
@@ -159,6 +367,10 @@ struct array_type_rule
                  seps,
                  pegtl::plus<TAO_PEGTL_STRING("["), seps, number, seps,
                              TAO_PEGTL_STRING("]")>> {};
+// T[], a slice of T
+struct slice_type_rule
+    : pegtl::seq<basic_type_rule, seps, TAO_PEGTL_STRING("["), seps,
+                 TAO_PEGTL_STRING("]")> {};
 struct reference_type_rule
     : pegtl::seq<pegtl::at<pegtl::sor<array_type_rule, basic_type_rule>>,
                  pegtl::sor<array_type_rule, basic_type_rule>, seps,
@@ -167,6 +379,7 @@ struct type_rule
     : pegtl::sor<
           pegtl::seq<pegtl::at<reference_type_rule>, reference_type_rule>,
           pegtl::seq<pegtl::at<array_type_rule>, array_type_rule>,
+          pegtl::seq<pegtl::at<slice_type_rule>, slice_type_rule>,
           basic_type_rule> {};
 
 struct variable_in_declaration_rule : variable_rule {};
@@ -201,6 +414,11 @@ struct array_access_rule
                                         TAO_PEGTL_STRING("]"), seps>>,
                  seps> {};
 
+// length(array), taken before a call to a function called length
+struct array_length_rule
+    : pegtl::seq<seps, str_length, seps, TAO_PEGTL_STRING("("), seps,
+                 expression_rule, seps, TAO_PEGTL_STRING(")"), seps> {};
+
 struct array_allocate_rule
     : pegtl::seq<seps, TAO_PEGTL_STRING("["), seps,
                  pegtl::seq<expression_rule, seps, TAO_PEGTL_STRING(";"), seps,
@@ -227,12 +445,12 @@ struct Instruction_function_call_rule
 struct Scope_rule;
 struct Instruction_while_rule
     : pegtl::seq<seps, TAO_PEGTL_STRING("while"), seps, TAO_PEGTL_STRING("("),
-                 seps, binary_operation_rule, seps, TAO_PEGTL_STRING(")"), seps,
+                 seps, expression_rule, seps, TAO_PEGTL_STRING(")"), seps,
                  Scope_rule, seps> {};
 
 struct Instruction_if_rule
     : pegtl::seq<seps, TAO_PEGTL_STRING("if"), seps, TAO_PEGTL_STRING("("),
-                 seps, binary_operation_rule, seps, TAO_PEGTL_STRING(")"), seps,
+                 seps, expression_rule, seps, TAO_PEGTL_STRING(")"), seps,
                  Scope_rule, seps> {};
 
 struct Instruction_break_rule
@@ -284,8 +502,16 @@ struct struct_member_name_rule : pegtl::seq<name> {};
 struct struct_definition_member_rule
     : pegtl::seq<seps, type_rule, seps, struct_member_name_rule, seps> {};
 struct struct_name_rule : pegtl::seq<name> {};
+// struct Name align(16) reorder { ... }
+struct struct_align_rule : pegtl::plus<pegtl::digit> {};
+struct struct_reorder_rule : TAO_PEGTL_KEYWORD("reorder") {};
+struct struct_attribute_rule
+    : pegtl::sor<pegtl::seq<TAO_PEGTL_KEYWORD("align"), seps, pegtl::one<'('>,
+                            seps, struct_align_rule, seps, pegtl::one<')'>>,
+                 struct_reorder_rule> {};
 struct Struct_rule
     : pegtl::seq<TAO_PEGTL_STRING("struct"), seps, struct_name_rule, seps,
+                 pegtl::star<struct_attribute_rule, seps>,
                  TAO_PEGTL_STRING("{"), seps,
                  pegtl::star<struct_definition_member_rule>, seps,
                  TAO_PEGTL_STRING("}")> {};
@@ -293,9 +519,15 @@ struct Struct_rule
 struct Functions_rule
     : pegtl::plus<seps, pegtl::sor<Struct_rule, Function_rule>, seps> {};
 
-struct entry_point_rule : Functions_rule {};
+struct module_name_rule : pegtl::seq<name> {};
+struct import_rule
+    : pegtl::seq<TAO_PEGTL_KEYWORD("import"), seps, module_name_rule> {};
+struct Imports_rule : pegtl::star<seps, import_rule, seps> {};
+
+struct entry_point_rule : pegtl::seq<Imports_rule, Functions_rule> {};
 
-struct grammar : pegtl::must<entry_point_rule> {};
+// the whole input must be definitions, a partial match is an error
+struct grammar : pegtl::must<entry_point_rule, pegtl::eof> {};
 
 /*
  * Actions attached to grammar rules.
@@ -303,20 +535,31 @@ struct grammar : pegtl::must<entry_point_rule> {};
 template <typename Rule>
 struct action : pegtl::nothing<Rule> {};
 
+template <>
+struct action<module_name_rule> {
+  template <typename Input>
+  static void apply(const Input& in, Program& p, State& state) {
+    PEGTL_PRINT_RULE(module_name_rule);
+    addImport(p, loadModule(*state.compilation, in.string_view(),
+                            state.file_name, state.module_paths));
+  }
+};
+
 template <>
 struct action<function_name_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE("function_name_rule");
-    auto new_f = std::make_unique<ast::Function>();
-    new_f->name = in.string();
+    auto* new_f = p.arena->make<ast::Function>();
+    new_f->name = Symbol(in.string_view());
+    new_f->line = static_cast<uint32_t>(in.position().line);
     new_f->type = state.parsed_vartypes.back();
     state.parsed_vartypes.pop_back();
     //    if (new_f->return_type->is_array()) {
     //      new_f->return_dim = state.parsed_dims.back();
     //      state.parsed_dims.pop_back();
     //    }
-    p.functions.push_back(std::move(new_f));
+    p.functions.push_back(new_f);
   }
 };
 
@@ -334,7 +577,7 @@ struct action<struct_member_name_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(struct_member_name_rule);
-    state.parsed_struct_member_names.push_back(in.string());
+    state.parsed_struct_member_names.emplace_back(in.string_view());
   }
 };
 template <>
@@ -349,7 +592,30 @@ struct action<struct_name_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(struct_name_rule);
-    state.parsed_struct_name = in.string();
+    state.parsed_struct_name = Symbol(in.string_view());
+  }
+};
+template <>
+struct action<struct_align_rule> {
+  template <typename Input>
+  static void apply(const Input& in, Program& p, State& state) {
+    PEGTL_PRINT_RULE(struct_align_rule);
+    int64_t align = 0;
+    auto [end, ec] = std::from_chars(in.begin(), in.end(), align);
+    if (ec != std::errc() || end != in.end() || align <= 0 ||
+        (align & (align - 1)) != 0) {
+      FRONTEND_ERROR("struct " + std::string(state.parsed_struct_name.str()) +
+                     ": align must be a power of two, not " + in.string());
+    }
+    state.parsed_struct_attributes.align = align;
+  }
+};
+template <>
+struct action<struct_reorder_rule> {
+  template <typename Input>
+  static void apply(const Input& in, Program& p, State& state) {
+    PEGTL_PRINT_RULE(struct_reorder_rule);
+    state.parsed_struct_attributes.reorder = true;
   }
 };
 template <>
@@ -357,17 +623,21 @@ struct action<Struct_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(Struct_rule);
-    auto struct_decl = std::make_unique<ast::StructDecl>();
+    auto* struct_decl = p.arena->make<ast::StructDecl>();
     struct_decl->name = state.parsed_struct_name;
     struct_decl->member_types = std::move(state.parsed_vartypes);
     for (int i = 0; i < state.parsed_struct_member_names.size(); i++) {
       auto& mem_name = state.parsed_struct_member_names[i];
       struct_decl->member_name_to_index[mem_name] = i;
     }
-    struct_decl->type =
-        VarType::getStructType(struct_decl->name, struct_decl->member_types,
-                               struct_decl->member_name_to_index);
-    p.structs.push_back(std::move(struct_decl));
+    struct_decl->attributes = state.parsed_struct_attributes;
+    struct_decl->type = VarType::getStructType(
+        state.compilation->types(), struct_decl->name,
+        struct_decl->member_types, struct_decl->member_name_to_index,
+        struct_decl->attributes);
+    p.structs.push_back(struct_decl);
+    state.parsed_struct_member_names.clear();
+    state.parsed_struct_attributes = {};
 
     //    VarType::get_struct_type();
   }
@@ -377,8 +647,7 @@ struct action<type_name_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(type_name_rule);
-    const std::string& type_name = in.string();
-    state.parsed_type_names.push_back(type_name);
+    state.parsed_type_names.emplace_back(in.string_view());
   }
 };
 
@@ -387,10 +656,8 @@ struct action<basic_type_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(basic_type_rule);
-    std::string type_name = in.string();
-    type_name.erase(std::remove(type_name.begin(), type_name.end(), ' '),
-                    type_name.end());
-    state.parsed_vartypes.push_back(VarType::findTypeByName(type_name));
+    state.parsed_vartypes.push_back(VarType::findTypeByName(
+        state.compilation->types(), canonicalTypeName(in.string_view())));
   }
 };
 
@@ -399,15 +666,46 @@ struct action<array_type_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(array_type_rule);
-    auto* size = dynamic_cast<ast::Integer*>(state.parsed_items.back().get());
-    ASSERT(size != nullptr, "size of array is not an integer");
-    std::string type_name = in.string();
-    type_name.erase(std::remove(type_name.begin(), type_name.end(), ' '),
-                    type_name.end());
+    // T[2][3] is an array of 2 T[3], the sizes follow the last template
+    // argument
+    Symbol type_name = canonicalTypeName(in.string_view());
+    std::string_view name = type_name.str();
+    size_t templates_end = name.rfind('>');
+    size_t dims_begin = name.find(
+        '[', templates_end == std::string_view::npos ? 0 : templates_end);
+    auto n_dims = std::count(name.begin() + dims_begin, name.end(), '[');
+    std::vector<int64_t> sizes(n_dims);
+    for (auto i = n_dims - 1; i >= 0; i--) {
+      auto* size = ast::dyn_cast<ast::Integer>(state.parsed_items.back());
+      ASSERT(size != nullptr, "size of array is not an integer");
+      sizes[i] = size->value;
+      state.parsed_items.pop_back();
+    }
+    auto elem_type = std::move(state.parsed_vartypes.back());
+    state.parsed_vartypes.pop_back();
+    // from the innermost dimension out, every dimension is one block of the
+    // one inside it
+    std::string dims;
+    for (auto i = n_dims - 1; i >= 0; i--) {
+      dims = "[" + std::to_string(sizes[i]) + "]" + dims;
+      Symbol dim_name(std::string(name.substr(0, dims_begin)) + dims);
+      elem_type = VarType::getArrayType(state.compilation->types(), dim_name,
+                                        n_dims - i, sizes[i], elem_type);
+    }
+    state.parsed_vartypes.push_back(std::move(elem_type));
+  }
+};
+
+template <>
+struct action<slice_type_rule> {
+  template <typename Input>
+  static void apply(const Input& in, Program& p, State& state) {
+    PEGTL_PRINT_RULE(slice_type_rule);
+    Symbol type_name = canonicalTypeName(in.string_view());
     auto elem_type = std::move(state.parsed_vartypes.back());
     state.parsed_vartypes.pop_back();
-    state.parsed_vartypes.emplace_back(
-        VarType::getArrayType(type_name, 1, size->value, elem_type));
+    state.parsed_vartypes.push_back(VarType::getSliceType(
+        state.compilation->types(), type_name, elem_type));
   }
 };
 
@@ -428,15 +726,27 @@ struct action<function_name_as_label_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(function_name_as_label_rule);
-    auto& current_f = p.functions.back();
+    Symbol name(in.string_view());
     for (auto& f : p.functions) {
-      if (f->name == in.string()) {
-        state.parsed_items.emplace_back(
-            std::make_shared<ast::FunctionName>(in.string(), f->type));
+      if (f->name == name) {
+        state.parsed_items.push_back(
+            p.arena->make<ast::FunctionName>(name, f->type));
         return;
       }
     }
-    FRONTEND_ERROR("could not find called function! " + in.string());
+    if (const ast::Function* f = findImportedFunction(p, state, name)) {
+      state.parsed_items.push_back(
+          p.arena->make<ast::FunctionName>(name, f->type));
+      return;
+    }
+    if (state.defer_unresolved_calls) {
+      auto* function_name = p.arena->make<ast::FunctionName>(name, nullptr);
+      state.unresolved_function_names.push_back(function_name);
+      state.parsed_items.push_back(function_name);
+      return;
+    }
+    FRONTEND_ERROR("could not find called function! " +
+                   std::string(name.str()));
   }
 };
 
@@ -445,8 +755,20 @@ struct action<number> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(number);
-    state.parsed_items.push_back(
-        std::make_shared<ast::Integer>(std::stoll(in.string())));
+    state.parsed_items.push_back(p.arena->make<ast::Integer>(
+        parseInteger(in.string_view()),
+        VarType::getLiteralType(state.compilation->types(), int64Name())));
+  }
+};
+
+template <>
+struct action<float_number> {
+  template <typename Input>
+  static void apply(const Input& in, Program& p, State& state) {
+    PEGTL_PRINT_RULE(float_number);
+    state.parsed_items.push_back(p.arena->make<ast::Float>(
+        parseFloat(in.string_view()),
+        VarType::getLiteralType(state.compilation->types(), float64Name())));
   }
 };
 
@@ -455,10 +777,9 @@ struct action<variable_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(variable_rule);
-    auto& current_f = p.functions.back();
-    auto v = ast::Variable::get(in.string(), current_f.get());
-    v->name = in.string();
-    state.parsed_items.push_back(std::move(v));
+    auto* current_f = p.functions.back();
+    state.parsed_items.push_back(
+        current_f->getVariable(Symbol(in.string_view()), *p.arena));
   }
 };
 
@@ -468,7 +789,7 @@ struct action<library_function> {
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(library_function);
     state.parsed_items.push_back(
-        std::make_shared<ast::FunctionName>(in.string(), nullptr));
+        p.arena->make<ast::FunctionName>(Symbol(in.string_view()), nullptr));
   }
 };
 
@@ -477,8 +798,7 @@ struct action<function_argument_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(function_argument_rule);
-    state.parsed_function_args.back().push_back(
-        std::move(state.parsed_items.back()));
+    state.parsed_function_args.back().push_back(state.parsed_items.back());
     state.parsed_items.pop_back();
   }
 };
@@ -488,23 +808,69 @@ struct action<binop_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(binop_rule);
-    state.parsed_binop = ast::stringToBinop(in.string());
+    state.parsed_binops.push_back(ast::stringToBinop(in.string_view()));
   }
 };
 
 template <>
-struct action<binary_operation_rule> {
+struct action<expression_head_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
-    PEGTL_PRINT_RULE(binary_operation_rule);
-    auto& current_f = p.functions.back();
-    auto& rhs = state.parsed_items.back();
-    auto& lhs = state.parsed_items[state.parsed_items.size() - 2];
-    auto binop = std::make_shared<ast::BinaryOperation>(
-        state.parsed_binop, std::move(lhs), std::move(rhs));
-    state.parsed_items.pop_back();
-    state.parsed_items.pop_back();
-    state.parsed_items.push_back(std::move(binop));
+    PEGTL_PRINT_RULE(expression_head_rule);
+    state.parsed_expression_marks.push_back(
+        {state.parsed_items.size() - 1, state.parsed_binops.size()});
+  }
+};
+
+template <>
+struct action<expression_rule> {
+  template <typename Input>
+  static void apply(const Input& in, Program& p, State& state) {
+    PEGTL_PRINT_RULE(expression_rule);
+    State::ExpressionMark mark = state.parsed_expression_marks.back();
+    state.parsed_expression_marks.pop_back();
+
+    size_t num_operands = state.parsed_items.size() - mark.first_item;
+    // a trailing operator whose operand failed to match is left behind by
+    // the star in expression_rule, it does not belong to the expression
+    state.parsed_binops.resize(mark.first_binop + num_operands - 1);
+    if (num_operands == 1) {
+      return;
+    }
+
+    // operator precedence parsing over the flat operand/operator chain, each
+    // operand and operator is pushed and popped once so this is linear in
+    // the length of the expression
+    std::vector<ast::ValuePtr> values;
+    std::vector<ast::BinOpId> ops;
+    auto reduce = [&]() {
+      ast::ValuePtr rhs = values.back();
+      values.pop_back();
+      ast::ValuePtr lhs = values.back();
+      values.pop_back();
+      values.push_back(
+          p.arena->make<ast::BinaryOperation>(ops.back(), lhs, rhs));
+      ops.pop_back();
+    };
+
+    values.push_back(state.parsed_items[mark.first_item]);
+    for (size_t i = 1; i < num_operands; i++) {
+      ast::BinOpId op = state.parsed_binops[mark.first_binop + i - 1];
+      // >= makes operators of equal precedence left associative
+      while (!ops.empty() &&
+             ast::binopPrecedence(ops.back()) >= ast::binopPrecedence(op)) {
+        reduce();
+      }
+      ops.push_back(op);
+      values.push_back(state.parsed_items[mark.first_item + i]);
+    }
+    while (!ops.empty()) {
+      reduce();
+    }
+
+    state.parsed_items.resize(mark.first_item);
+    state.parsed_binops.resize(mark.first_binop);
+    state.parsed_items.push_back(values.back());
   }
 };
 
@@ -513,20 +879,28 @@ struct action<array_access_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(array_access_rule);
-    std::string str = in.string();
-    int64_t num_args = std::count(str.begin(), str.end(), '[');
-    auto& current_f = p.functions.back();
+    int64_t num_args = countIndices(in.string_view());
     std::vector<ast::ConstValuePtr> indices;
     for (int i = 0; i < num_args; i++) {
       indices.push_back(state.parsed_items.back());
       state.parsed_items.pop_back();
     }
     std::reverse(indices.begin(), indices.end());
-    auto& var = state.parsed_items.back();
-    auto array_access = std::make_shared<ast::ArrayAccess>(
-        std::move(var), std::move(indices), in.position().line);
+    ast::ValuePtr var = state.parsed_items.back();
+    state.parsed_items.pop_back();
+    state.parsed_items.push_back(p.arena->make<ast::ArrayAccess>(
+        var, std::move(indices), firstTokenLine(in)));
+  }
+};
+
+template <>
+struct action<array_length_rule> {
+  template <typename Input>
+  static void apply(const Input& in, Program& p, State& state) {
+    PEGTL_PRINT_RULE(array_length_rule);
+    ast::ConstValuePtr array = state.parsed_items.back();
     state.parsed_items.pop_back();
-    state.parsed_items.push_back(std::move(array_access));
+    state.parsed_items.push_back(p.arena->make<ast::ArrayLength>(array));
   }
 };
 
@@ -535,12 +909,12 @@ struct action<array_allocate_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(array_allocate_rule);
-    ast::ConstValuePtr length = std::move(state.parsed_items.back());
+    ast::ConstValuePtr length = state.parsed_items.back();
     state.parsed_items.pop_back();
-    ast::ConstValuePtr init_value = std::move(state.parsed_items.back());
+    ast::ConstValuePtr init_value = state.parsed_items.back();
     state.parsed_items.pop_back();
-    state.parsed_items.push_back(std::make_shared<ast::ArrayAllocate>(
-        std::move(length), std::move(init_value)));
+    state.parsed_items.push_back(
+        p.arena->make<ast::ArrayAllocate>(length, init_value));
   }
 };
 
@@ -549,14 +923,17 @@ struct action<function_definition_argument_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(function_definition_argument_rule);
-    ast::ValuePtr i = std::move(state.parsed_items.back());
+    ast::ValuePtr i = state.parsed_items.back();
     state.parsed_items.pop_back();
 
-    auto var = dynamic_cast<ast::Variable*>(i.get());
+    auto var = ast::dyn_cast<ast::Variable>(i);
     ASSERT(var != nullptr,
            "Expected variable in function definition argument rule");
     var->type = std::move(state.parsed_vartypes.back());
     state.parsed_vartypes.pop_back();
+    if (var->line == 0) {
+      var->line = firstTokenLine(in);
+    }
 
     p.functions.back()->args.push_back(i);
   }
@@ -567,9 +944,9 @@ struct action<Instruction_return_rule_value> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(Instruction_return_rule_value);
-    auto& current_f = p.functions.back();
     state.parsed_scopes.back()->instructions.push_back(
-        std::make_unique<ast::InstructionReturn>(state.parsed_items.back()));
+        atLine(in, p.arena->make<ast::InstructionReturn>(
+                       state.parsed_items.back())));
     state.parsed_items.pop_back();
   }
 };
@@ -579,9 +956,8 @@ struct action<Instruction_return_rule_void> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(Instruction_return_rule_void);
-    auto& current_f = p.functions.back();
     state.parsed_scopes.back()->instructions.push_back(
-        std::make_unique<ast::InstructionReturn>());
+        atLine(in, p.arena->make<ast::InstructionReturn>()));
   }
 };
 
@@ -590,9 +966,12 @@ struct action<variable_in_declaration_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(variable_in_declaration_rule);
-    auto& current_f = p.functions.back();
-    auto var = ast::Variable::get(in.string(), current_f.get());
-    state.parsed_declared_vars.push_back(std::move(var));
+    auto* current_f = p.functions.back();
+    auto* var = current_f->getVariable(Symbol(in.string_view()), *p.arena);
+    if (var->line == 0) {
+      var->line = static_cast<uint32_t>(in.position().line);
+    }
+    state.parsed_declared_vars.push_back(var);
   }
 };
 
@@ -602,7 +981,7 @@ struct action<Instruction_variable_declaration_rule> {
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(Instruction_variable_declaration_rule);
     for (auto& v : state.parsed_declared_vars) {
-      auto var = dynamic_cast<ast::Variable*>(v.get());
+      auto var = ast::dyn_cast<ast::Variable>(v);
       var->type = state.parsed_vartypes.back()
                       ->getLValueFrom();  // need to copy sharedptr to each var
       //      if (var->type->is_array()) {
@@ -611,8 +990,8 @@ struct action<Instruction_variable_declaration_rule> {
     }
     state.parsed_vartypes.pop_back();
     state.parsed_scopes.back()->instructions.push_back(
-        std::make_unique<ast::InstructionDecl>(
-            std::move(state.parsed_declared_vars)));
+        atLine(in, p.arena->make<ast::InstructionDecl>(
+                       std::move(state.parsed_declared_vars))));
   }
 };
 
@@ -621,16 +1000,14 @@ struct action<Instruction_while_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(Instruction_while_rule);
-    auto& current_f = p.functions.back();
+    auto* body = state.parsed_scopes.back()->instructions.back();
+    auto* cond = state.parsed_items.back();
 
-    auto& body = state.parsed_scopes.back()->instructions.back();
-    auto& cond = state.parsed_items.back();
-
-    auto loop = std::make_unique<ast::InstructionWhileLoop>(std::move(cond),
-                                                            std::move(body));
+    auto* loop =
+        atLine(in, p.arena->make<ast::InstructionWhileLoop>(cond, body));
     state.parsed_scopes.back()->instructions.pop_back();
     state.parsed_items.pop_back();
-    state.parsed_scopes.back()->instructions.push_back(std::move(loop));
+    state.parsed_scopes.back()->instructions.push_back(loop);
   }
 };
 
@@ -639,17 +1016,15 @@ struct action<Instruction_if_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(Instruction_if_rule);
-    auto& current_f = p.functions.back();
-    auto i = std::make_unique<ast::InstructionIfStatement>();
+    auto* i = atLine(in, p.arena->make<ast::InstructionIfStatement>());
     ASSERT(
-        dynamic_cast<const ast::Scope*>(
-            state.parsed_scopes.back()->instructions.back().get()) != nullptr,
+        ast::isa<ast::Scope>(state.parsed_scopes.back()->instructions.back()),
         "Expected scope in if rule");
-    i->true_scope = std::move(state.parsed_scopes.back()->instructions.back());
+    i->true_scope = state.parsed_scopes.back()->instructions.back();
     state.parsed_scopes.back()->instructions.pop_back();
     i->cond = state.parsed_items.back();
     state.parsed_items.pop_back();
-    state.parsed_scopes.back()->instructions.push_back(std::move(i));
+    state.parsed_scopes.back()->instructions.push_back(i);
   }
 };
 
@@ -658,9 +1033,8 @@ struct action<Instruction_break_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(Instruction_break_rule);
-    auto& current_f = p.functions.back();
-    auto i = std::make_unique<ast::InstructionBreak>();
-    state.parsed_scopes.back()->instructions.push_back(std::move(i));
+    state.parsed_scopes.back()->instructions.push_back(
+        atLine(in, p.arena->make<ast::InstructionBreak>()));
   }
 };
 
@@ -669,9 +1043,8 @@ struct action<Instruction_continue_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(Instruction_continue_rule);
-    auto& current_f = p.functions.back();
-    auto i = std::make_unique<ast::InstructionContinue>();
-    state.parsed_scopes.back()->instructions.push_back(std::move(i));
+    state.parsed_scopes.back()->instructions.push_back(
+        atLine(in, p.arena->make<ast::InstructionContinue>()));
   }
 };
 
@@ -680,19 +1053,17 @@ struct action<Instruction_assignment_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(Instruction_assignment_rule);
-    auto& current_f = p.functions.back();
-    auto& src = state.parsed_items.back();
-    auto& dst = state.parsed_items[state.parsed_items.size() - 2];
+    auto* src = state.parsed_items.back();
+    auto* dst = state.parsed_items[state.parsed_items.size() - 2];
     if (dst == nullptr && src == nullptr) {
       FRONTEND_ERROR("dst and src are nullptr");
     }
-    auto i = std::make_unique<ast::InstructionAssignment>(std::move(dst),
-                                                          std::move(src));
+    auto* i = atLine(in, p.arena->make<ast::InstructionAssignment>(dst, src));
     state.parsed_items.pop_back();
     state.parsed_items.pop_back();
 
     // check if i->dst is a variable and has type "code"
-    auto* dst_raw = dynamic_cast<const ast::Variable*>(i->dst.get());
+    auto* dst_raw = ast::dyn_cast<ast::Variable>(i->dst);
     // if (dst_raw != nullptr && dst_raw->type->is_code()) {
     //   // change src to a functionName
     //   auto src = dynamic_cast<const Variable *>(i->src.get());
@@ -709,7 +1080,7 @@ struct action<Instruction_assignment_rule> {
     //  }
     //}
 
-    state.parsed_scopes.back()->instructions.push_back(std::move(i));
+    state.parsed_scopes.back()->instructions.push_back(i);
   }
 };
 
@@ -727,23 +1098,34 @@ struct action<function_call_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(function_call_rule);
-    auto& current_f = p.functions.back();
-    auto f_call = std::make_shared<ast::FunctionCall>(
-        std::move(state.parsed_items.back()),
+    auto* f_call = p.arena->make<ast::FunctionCall>(
+        state.parsed_items.back(),
         std::move(state.parsed_function_args.back()));
-    auto f_name =
-        dynamic_cast<const ast::FunctionName*>(f_call->function.get())->name;
+    auto f_name = ast::cast<ast::FunctionName>(f_call->function)->name;
+    bool found = false;
     for (auto& func : p.functions) {
       if (func->name == f_name) {
         for (auto& param : func->args) {
           f_call->arg_types.push_back(param->type);
         }
+        found = true;
         break;
       }
     }
+    if (!found) {
+      if (const ast::Function* f = findImportedFunction(p, state, f_name)) {
+        for (auto& param : f->args) {
+          f_call->arg_types.push_back(param->type);
+        }
+        found = true;
+      }
+    }
+    if (!found && state.defer_unresolved_calls) {
+      state.unresolved_calls.push_back(f_call);
+    }
     state.parsed_function_args.pop_back();
     state.parsed_items.pop_back();
-    state.parsed_items.push_back(std::move(f_call));
+    state.parsed_items.push_back(f_call);
   }
 };
 
@@ -752,10 +1134,9 @@ struct action<Instruction_function_call_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(Instruction_function_call_rule);
-    auto& current_f = p.functions.back();
     state.parsed_scopes.back()->instructions.push_back(
-        std::make_unique<ast::InstructionFunctionCall>(
-            state.parsed_items.back()));
+        atLine(in, p.arena->make<ast::InstructionFunctionCall>(
+                       state.parsed_items.back())));
 
     state.parsed_items.pop_back();
   }
@@ -766,8 +1147,7 @@ struct action<new_scope_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(new_scope_rule);
-    auto& current_f = p.functions.back();
-    state.parsed_scopes.emplace_back(std::make_unique<ast::Scope>());
+    state.parsed_scopes.push_back(p.arena->make<ast::Scope>());
   }
 };
 
@@ -776,21 +1156,339 @@ struct action<end_scope_rule> {
   template <typename Input>
   static void apply(const Input& in, Program& p, State& state) {
     PEGTL_PRINT_RULE(end_scope_rule);
-    auto& current_f = p.functions.back();
-    if (state.parsed_scopes.size() == 1) {
-      current_f->scope = std::move(state.parsed_scopes.back());
-      state.parsed_scopes.pop_back();
+    auto* current_f = p.functions.back();
+    ast::Scope* scope = state.parsed_scopes.back();
+    state.parsed_scopes.pop_back();
+    if (state.parsed_scopes.empty()) {
+      current_f->scope = scope;
     } else {
-      auto scope = std::move(state.parsed_scopes.back());
-      state.parsed_scopes.pop_back();
-      state.parsed_scopes.back()->instructions.push_back(std::move(scope));
+      state.parsed_scopes.back()->instructions.push_back(scope);
     }
   }
 };
 
+/*
+ * Control attached to the grammar.
+ *
+ * Counts every rule invocation when State::count_rules is set and, when
+ * State::memoize is set, memoizes the rules below. The grammar guards its
+ * alternatives with seq<at<X>, X>, so X is first matched without actions and
+ * then again with actions, and every lookahead nested in X is repeated as
+ * well. Matching never depends on the actions, so a memoized failure answers
+ * any later attempt, and a memoized success answers any later attempt
+ * without actions. Each (rule, position) pair is therefore matched at most
+ * once without actions, plus once more when its actions have to run. The
+ * Program built is the same either way.
+ */
+template <typename Rule>
+struct memoized : std::false_type {};
+
+template <>
+struct memoized<Instruction_while_rule> : std::true_type {};
+template <>
+struct memoized<Instruction_if_rule> : std::true_type {};
+template <>
+struct memoized<Instruction_break_rule> : std::true_type {};
+template <>
+struct memoized<Instruction_continue_rule> : std::true_type {};
+template <>
+struct memoized<Scope_rule> : std::true_type {};
+template <>
+struct memoized<Instruction_function_call_rule> : std::true_type {};
+template <>
+struct memoized<Instruction_assignment_rule> : std::true_type {};
+template <>
+struct memoized<Instruction_variable_declaration_rule> : std::true_type {};
+template <>
+struct memoized<Instruction_return_rule_value> : std::true_type {};
+template <>
+struct memoized<Instruction_return_rule_void> : std::true_type {};
+template <>
+struct memoized<array_access_rule> : std::true_type {};
+template <>
+struct memoized<function_call_rule> : std::true_type {};
+template <>
+struct memoized<array_allocate_rule> : std::true_type {};
+template <>
+struct memoized<array_length_rule> : std::true_type {};
+template <>
+struct memoized<single_expression_rule> : std::true_type {};
+template <>
+struct memoized<expression_rule> : std::true_type {};
+template <>
+struct memoized<type_rule> : std::true_type {};
+template <>
+struct memoized<reference_type_rule> : std::true_type {};
+template <>
+struct memoized<array_type_rule> : std::true_type {};
+template <>
+struct memoized<slice_type_rule> : std::true_type {};
+template <>
+struct memoized<basic_type_rule> : std::true_type {};
+
+// unique address per rule, used as the rule part of the memo key
+template <typename Rule>
+inline constexpr char memo_tag = 0;
+
+template <typename Rule>
+struct control : pegtl::normal<Rule> {
+  template <apply_mode A, rewind_mode M, template <typename...> class Action,
+            template <typename...> class Control, typename ParseInput>
+  [[nodiscard]] static bool match(ParseInput& in, Program& p, State& state) {
+    if (state.count_rules) {
+      state.stats.rule_invocations++;
+    }
+    if constexpr (memoized<Rule>::value) {
+      if (state.memoize) {
+        return matchMemoized<A, M, Action, Control>(in, p, state);
+      }
+    }
+    return pegtl::normal<Rule>::template match<A, M, Action, Control>(in, p,
+                                                                      state);
+  }
+
+ private:
+  template <apply_mode A, rewind_mode M, template <typename...> class Action,
+            template <typename...> class Control, typename ParseInput>
+  static bool matchMemoized(ParseInput& in, Program& p, State& state) {
+    const char* position = in.current();
+    State::MemoKey key{&memo_tag<Rule>, position};
+    auto it = state.memo.find(key);
+    if (it != state.memo.end()) {
+      if (!it->second.matched) {
+        state.stats.memo_hits++;
+        return false;
+      }
+      if constexpr (A == apply_mode::nothing) {
+        state.stats.memo_hits++;
+        in.bump(static_cast<size_t>(it->second.end - position));
+        return true;
+      }
+    }
+    bool matched = pegtl::normal<Rule>::template match<A, M, Action, Control>(
+        in, p, state);
+    state.memo[key] = {matched, in.current()};
+    return matched;
+  }
+};
+
+template <>
+struct action<Function_rule> {
+  template <typename Input>
+  static void apply(const Input& in, Program& p, State& state) {
+    PEGTL_PRINT_RULE(Function_rule);
+    // the parse never backtracks into a finished function
+    state.memo.clear();
+  }
+};
+
 }  // namespace parser
 
-Program parseFile(const char* file_name) {
+namespace {
+template <typename Input>
+void parseInput(Input& in, Program& p, parser::State& state) {
+  bool ret = false;
+  try {
+    ret = parse<parser::grammar, parser::action, parser::control>(in, p, state);
+  } catch (const parse_error& e) {
+    FRONTEND_ERROR(e.what());
+  }
+  if (!ret) {
+    FRONTEND_ERROR("parse failed");
+  }
+}
+
+struct ChunkResult {
+  Program program;
+  parser::State state;
+  // what FRONTEND_ERROR raised on the worker thread, if anything
+  std::optional<FrontendError> error;
+};
+
+void parseChunk(CompilationContext& compilation, std::string_view source,
+                const lexer::Definition& chunk, const char* file_name,
+                std::span<ModuleInterface* const> imports,
+                const ParseOptions& options, ChunkResult& result) {
+  result.state.compilation = &compilation;
+  result.state.file_name = file_name;
+  result.state.module_paths = options.module_paths;
+  result.program.imports.assign(imports.begin(), imports.end());
+  result.state.memoize = options.memoize;
+  result.state.defer_unresolved_calls = true;
+  if (!options.use_lexer) {
+    memory_input<> in(source.data() + chunk.begin, source.data() + chunk.end,
+                      file_name, chunk.begin, chunk.line, 1);
+    parseInput(in, result.program, result.state);
+    return;
+  }
+  std::string normalized =
+      lexer::renderTokens(source, chunk.tokens, chunk.line, chunk.begin);
+  memory_input<> in(normalized.data(), normalized.data() + normalized.size(),
+                    file_name, 0, chunk.line, 1);
+  parseInput(in, result.program, result.state);
+}
+
+// fills in the callee types of calls to functions defined in other chunks
+void resolveCalls(const Program& p,
+                  std::span<const ast::Function* const> known_functions,
+                  std::vector<ChunkResult>& results) {
+  std::unordered_map<Symbol, const ast::Function*> functions;
+  for (const auto& f : p.functions) {
+    functions.emplace(f->name, f);
+  }
+  for (const ast::Function* f : known_functions) {
+    functions.emplace(f->name, f);
+  }
+  for (auto& result : results) {
+    for (auto& function_name : result.state.unresolved_function_names) {
+      auto it = functions.find(function_name->name);
+      if (it == functions.end()) {
+        FRONTEND_ERROR("could not find called function! " +
+                       std::string(function_name->name.str()));
+      }
+      function_name->return_type = it->second->type;
+    }
+    for (auto& call : result.state.unresolved_calls) {
+      Symbol name = ast::cast<ast::FunctionName>(call->function)->name;
+      auto it = functions.find(name);
+      if (it == functions.end()) {
+        continue;  // library function
+      }
+      for (const auto& param : it->second->args) {
+        call->arg_types.push_back(param->type);
+      }
+    }
+  }
+}
+
+Program parseChunks(CompilationContext& compilation, std::string_view source,
+                    const char* file_name,
+                    std::span<const lexer::Definition> chunks,
+                    std::span<const std::string_view> imports,
+                    std::span<const ast::Function* const> known_functions,
+                    const ParseOptions& options, ParseStats* stats) {
+  std::vector<ChunkResult> results(chunks.size());
+  for (auto& result : results) {
+    result.state.count_rules = stats != nullptr;
+  }
+
+  // imported structs and functions are known to every chunk, whether or not
+  // it holds the import declarations
+  std::vector<ModuleInterface*> modules;
+  for (std::string_view name : imports) {
+    ModuleInterface* module =
+        parser::loadModule(compilation, name, file_name, options.module_paths);
+    if (std::find(modules.begin(), modules.end(), module) == modules.end()) {
+      modules.push_back(module);
+    }
+  }
+
+  // struct types must exist before any function refers to them by name, so
+  // structs are parsed first, in source order
+  for (size_t i = 0; i < chunks.size(); i++) {
+    if (chunks[i].is_struct) {
+      parseChunk(compilation, source, chunks[i], file_name, modules, options,
+                 results[i]);
+    }
+  }
+
+  // errors in a function are kept with its chunk and reported below, after
+  // every thread is done
+  std::atomic<size_t> next_chunk = 0;
+  auto worker = [&]() {
+    RecoverableErrors recoverable;
+    for (size_t i = next_chunk++; i < chunks.size(); i = next_chunk++) {
+      if (chunks[i].is_struct) {
+        continue;
+      }
+      try {
+        parseChunk(compilation, source, chunks[i], file_name, modules,
+                   options, results[i]);
+      } catch (const FrontendError& e) {
+        results[i].error = e;
+      }
+    }
+  };
+  size_t num_threads = std::min<size_t>(options.num_threads, chunks.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // errors are reported in source order: all of them, or only the first if
+  // the caller recovers from it
+  bool failed = false;
+  for (auto& result : results) {
+    if (!result.error) {
+      continue;
+    }
+    if (RecoverableErrors::active()) {
+      throw *result.error;
+    }
+    printError(*result.error);
+    failed = true;
+  }
+  if (failed) {
+    exit(1);
+  }
+
+  // merge in source order
+  Program p;
+  p.imports = modules;
+  std::unordered_set<const ast::Function*> imported_functions;
+  for (auto& result : results) {
+    p.arena->adopt(std::move(*result.program.arena));
+    p.functions.insert(p.functions.end(), result.program.functions.begin(),
+                       result.program.functions.end());
+    p.structs.insert(p.structs.end(), result.program.structs.begin(),
+                     result.program.structs.end());
+    for (const ast::Function* f : result.program.imported_functions) {
+      if (imported_functions.insert(f).second) {
+        p.imported_functions.push_back(f);
+      }
+    }
+    if (stats != nullptr) {
+      stats->rule_invocations += result.state.stats.rule_invocations;
+      stats->memo_hits += result.state.stats.memo_hits;
+    }
+  }
+  resolveCalls(p, known_functions, results);
+  return p;
+}
+
+Program parseInParallel(CompilationContext& compilation,
+                        std::string_view source, const char* file_name,
+                        const ParseOptions& options, ParseStats* stats) {
+  std::vector<lexer::Token> tokens = lexer::tokenize(source);
+  std::vector<lexer::Definition> chunks =
+      lexer::splitDefinitions(source, tokens);
+  if (chunks.empty()) {
+    // nothing to split, let the grammar report what is wrong
+    chunks.push_back({0, source.size(), 1, false, tokens});
+  }
+  std::vector<std::string_view> imports =
+      lexer::importedModules(source, tokens);
+  return parseChunks(compilation, source, file_name, chunks, imports, {},
+                     options, stats);
+}
+}  // namespace
+
+Program parseDefinitions(CompilationContext& compilation,
+                         std::string_view source, const char* file_name,
+                         std::span<const lexer::Definition> definitions,
+                         std::span<const std::string_view> imports,
+                         std::span<const ast::Function* const> known_functions,
+                         const ParseOptions& options) {
+  return parseChunks(compilation, source, file_name, definitions, imports,
+                     known_functions, options, nullptr);
+}
+
+Program parseFile(CompilationContext& compilation, const char* file_name,
+                  const ParseOptions& options, ParseStats* stats) {
   /*
    * Check the grammar for some possible issues.
    */
@@ -798,13 +1496,39 @@ Program parseFile(const char* file_name) {
 
   /*
    * Parse.
+   * The source is memory mapped and actions read token text through
+   * string_views into the mapping, so only names that end up in the AST are
+   * copied.
    */
-  file_input<> file_input(file_name);
+  mmap_input<> input(file_name);
+  std::string_view source(input.begin(), input.size());
+  if (options.num_threads > 1) {
+    if (stats != nullptr) {
+      *stats = ParseStats();
+    }
+    return parseInParallel(compilation, source, file_name, options, stats);
+  }
+
   Program p;
   parser::State state;
-  bool ret = parse<parser::grammar, parser::action>(file_input, p, state);
-  ASSERT(ret, "parse failed");
-
+  state.compilation = &compilation;
+  state.file_name = file_name;
+  state.module_paths = options.module_paths;
+  state.memoize = options.memoize;
+  state.count_rules = stats != nullptr;
+  if (!options.use_lexer) {
+    parseInput(input, p, state);
+  } else {
+    // the normalized buffer keeps the original line numbers, so positions
+    // reported by the grammar still refer to the source file
+    std::string normalized =
+        lexer::renderTokens(source, lexer::tokenize(source));
+    memory_input<> token_input(normalized, file_name);
+    parseInput(token_input, p, state);
+  }
+  if (stats != nullptr) {
+    *stats = state.stats;
+  }
   return p;
 }
 }  // namespace frontend
@@ -0,0 +1,160 @@
+#include "frontend/symbol/Symbol.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace frontend {
+namespace {
+// chunk c of the texts holds the kFirstChunk << c ids from
+// kFirstChunk * (2^c - 1) on, so 32 chunks cover every 32-bit id
+constexpr uint64_t kFirstChunk = 1024;
+constexpr size_t kNumChunks = 32;
+constexpr size_t kFirstIdTable = 4096;
+
+struct TextPosition {
+  size_t chunk;
+  size_t offset;
+};
+
+TextPosition positionOf(uint32_t id) {
+  size_t chunk = std::bit_width(id / kFirstChunk + 1) - 1;
+  return {chunk, id - kFirstChunk * ((uint64_t(1) << chunk) - 1)};
+}
+
+// an open-addressing table of ids, hashed by their text and never more than
+// half full. 0 marks an empty slot, the empty string is not in it.
+struct IdTable {
+  explicit IdTable(size_t capacity)
+      : mask(capacity - 1),
+        slots(std::make_unique<std::atomic<uint32_t>[]>(capacity)) {}
+
+  size_t capacity() const { return mask + 1; }
+
+  size_t mask;
+  std::unique_ptr<std::atomic<uint32_t>[]> slots;
+};
+
+// Symbols are made and read on every parse thread, so neither str() nor
+// finding a text interned before takes a lock. Only interning a new text
+// does. A text is written before its id goes into the id table with a
+// release store, and the id table and chunks never move, so whoever got an
+// id from the table or from the thread that interned it can read the text.
+struct SymbolTable {
+  SymbolTable() {
+    chunks[0] = std::make_unique<std::string_view[]>(kFirstChunk);
+    id_tables.push_back(std::make_unique<IdTable>(kFirstIdTable));
+    ids.store(id_tables.back().get(), std::memory_order_release);
+  }
+
+  std::string_view text(uint32_t id) const {
+    TextPosition position = positionOf(id);
+    return chunks[position.chunk][position.offset];
+  }
+
+  // the id of text in table, 0 if it is not in there
+  uint32_t find(const IdTable& table, std::string_view text,
+                size_t hash) const {
+    for (size_t i = hash & table.mask;; i = (i + 1) & table.mask) {
+      uint32_t id = table.slots[i].load(std::memory_order_acquire);
+      if (id == 0 || this->text(id) == text) {
+        return id;
+      }
+    }
+  }
+
+  static void insert(IdTable& table, uint32_t id, size_t hash) {
+    size_t i = hash & table.mask;
+    while (table.slots[i].load(std::memory_order_relaxed) != 0) {
+      i = (i + 1) & table.mask;
+    }
+    table.slots[i].store(id, std::memory_order_release);
+  }
+
+  // interns text, under mutex
+  uint32_t add(std::string_view text, size_t hash) {
+    auto id = size.load(std::memory_order_relaxed);
+    TextPosition position = positionOf(id);
+    if (!chunks[position.chunk]) {
+      chunks[position.chunk] = std::make_unique<std::string_view[]>(
+          kFirstChunk << position.chunk);
+    }
+    chunks[position.chunk][position.offset] = storage.emplace_back(text);
+
+    IdTable* table = ids.load(std::memory_order_relaxed);
+    if (2 * size_t(id) >= table->capacity()) {
+      // a thread still probing the old table only misses the newest texts,
+      // and looks again under the lock
+      auto grown = std::make_unique<IdTable>(2 * table->capacity());
+      for (uint32_t old = 1; old < id; old++) {
+        insert(*grown, old, std::hash<std::string_view>()(this->text(old)));
+      }
+      table = grown.get();
+      id_tables.push_back(std::move(grown));
+      ids.store(table, std::memory_order_release);
+    }
+    insert(*table, id, hash);
+    size.store(id + 1, std::memory_order_release);
+    return id;
+  }
+
+  // taken to intern a new text
+  std::mutex mutex;
+  // a deque never moves its elements, so the views into them stay valid
+  std::deque<std::string> storage;
+  std::array<std::unique_ptr<std::string_view[]>, kNumChunks> chunks;
+  // the current id table, the ones it replaced are kept for the threads
+  // that may still be reading them
+  std::atomic<IdTable*> ids;
+  std::vector<std::unique_ptr<IdTable>> id_tables;
+  // texts interned so far, the empty one at id 0 included
+  std::atomic<uint32_t> size{1};
+};
+
+SymbolTable& table() {
+  static SymbolTable symbols;
+  return symbols;
+}
+}  // namespace
+
+Symbol::Symbol(std::string_view text) {
+  if (text.empty()) {
+    return;
+  }
+  SymbolTable& symbols = table();
+  size_t hash = std::hash<std::string_view>()(text);
+  id_ = symbols.find(*symbols.ids.load(std::memory_order_acquire), text, hash);
+  if (id_ != 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(symbols.mutex);
+  // another thread may have interned it in between
+  id_ = symbols.find(*symbols.ids.load(std::memory_order_relaxed), text, hash);
+  if (id_ == 0) {
+    id_ = symbols.add(text, hash);
+  }
+}
+
+std::string_view Symbol::str() const {
+  return table().text(id_);
+}
+
+size_t Symbol::tableSize() {
+  return table().size.load(std::memory_order_acquire);
+}
+
+std::ostream& operator<<(std::ostream& os, Symbol symbol) {
+  return os << symbol.str();
+}
+
+}  // namespace frontend
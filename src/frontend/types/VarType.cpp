@@ -4,7 +4,9 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Type.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -12,95 +14,168 @@
 
 namespace frontend {
 
-ConstVarTypePtr VarType::getArrayType(const std::string& type_name,
+ConstVarTypePtr VarType::getArrayType(TypeTable& table, Symbol type_name,
                                       int64_t n_dims, int64_t n_size,
                                       ConstVarTypePtr& elem_type) {
   TypeIdentifier typeIdentifier(type_name, n_dims, n_size, TypeCat::ARRAY,
                                 ValCat::NONE);
-  return findVarTypeOrCreate(typeIdentifier, MemberTypes{std::move(elem_type)},
+  return findVarTypeOrCreate(table, typeIdentifier,
+                             MemberTypes{std::move(elem_type)}, {});
+}
+
+ConstVarTypePtr VarType::getSliceType(TypeTable& table, Symbol type_name,
+                                      const ConstVarTypePtr& elem_type) {
+  TypeIdentifier typeIdentifier(type_name, kNonArrayDim, kNonArraySize,
+                                TypeCat::SLICE, ValCat::NONE);
+  return findVarTypeOrCreate(table, typeIdentifier, MemberTypes{elem_type},
                              {});
 }
-ConstVarTypePtr VarType::getAtomicType(const std::string& type_name) {
+
+namespace {
+const Symbol kVoidName("void");
+const Symbol kInt64Name("int64");
+
+struct IntegerType {
+  Symbol name;
+  int bits;
+  bool is_signed;
+};
+
+// the integer types by name, bool is an unsigned 1 bit integer
+const IntegerType* findIntegerType(Symbol type_name) {
+  static const IntegerType kIntegerTypes[] = {
+      {kInt64Name, 64, true},          {Symbol("int32"), 32, true},
+      {Symbol("int16"), 16, true},     {Symbol("int8"), 8, true},
+      {Symbol("uint64"), 64, false},   {Symbol("uint32"), 32, false},
+      {Symbol("uint16"), 16, false},   {Symbol("uint8"), 8, false},
+      {Symbol("bool"), 1, false},
+  };
+  for (const IntegerType& type : kIntegerTypes) {
+    if (type.name == type_name) {
+      return &type;
+    }
+  }
+  return nullptr;
+}
+
+// the width of a floating-point type by name, 0 for other names
+int floatBits(Symbol type_name) {
+  static const Symbol kFloat32Name("float32");
+  static const Symbol kFloat64Name("float64");
+  if (type_name == kFloat32Name) {
+    return 32;
+  }
+  return type_name == kFloat64Name ? 64 : 0;
+}
+}  // namespace
+
+ConstVarTypePtr VarType::getAtomicType(TypeTable& table, Symbol type_name) {
   TypeCat category;
 
-  if (type_name == "void") {
+  if (type_name == kVoidName) {
     category = TypeCat::VOID;
-  } else if (type_name == "int64") {
+  } else if (findIntegerType(type_name) != nullptr) {
     category = TypeCat::INTEGER;
+  } else if (floatBits(type_name) != 0) {
+    category = TypeCat::FLOAT;
   } else {
     FRONTEND_ERROR("no matching category for type!");
   }
   TypeIdentifier typeIdentifier(type_name, kNonArrayDim, kNonArraySize,
                                 category, ValCat::NONE);
 
-  return findVarTypeOrCreate(typeIdentifier, {}, {});
+  return findVarTypeOrCreate(table, typeIdentifier, {}, {});
 }
 
-ConstVarTypePtr VarType::findTypeByName(const std::string& type_name) {
+ConstVarTypePtr VarType::findTypeByName(TypeTable& table, Symbol type_name) {
   TypeCat category;
-  if (type_name == "void") {
+  if (type_name == kVoidName) {
     category = TypeCat::VOID;
-  } else if (type_name == "int64") {
+  } else if (findIntegerType(type_name) != nullptr) {
     category = TypeCat::INTEGER;
+  } else if (floatBits(type_name) != 0) {
+    category = TypeCat::FLOAT;
   } else {
     category = TypeCat::STRUCTURE;
   }
   TypeIdentifier typeIdentifier(type_name, kNonArrayDim, kNonArraySize,
                                 category, ValCat::NONE);
 
-  return findVarTypeOrCreate(typeIdentifier, {}, {});
+  return findVarTypeOrCreate(table, typeIdentifier, {}, {});
 }
 
 ConstVarTypePtr VarType::getStructType(
-    const std::string& type_name, const MemberTypes& member_types,
-    const MemberNameToIndex& member_name_to_index) {
+    TypeTable& table, Symbol type_name, const MemberTypes& member_types,
+    const MemberNameToIndex& member_name_to_index,
+    const StructAttributes& attributes) {
   TypeCat category = TypeCat::STRUCTURE;
   TypeIdentifier typeIdentifier(type_name, kNonArrayDim, kNonArraySize,
                                 category, ValCat::NONE);
 
-  return findVarTypeOrCreate(typeIdentifier, member_types,
-                             member_name_to_index);
+  return findVarTypeOrCreate(table, typeIdentifier, member_types,
+                             member_name_to_index, attributes);
 }
 
-ConstVarTypePtr VarType::getLiteralType(const std::string& type_name) {
+ConstVarTypePtr VarType::getLiteralType(TypeTable& table, Symbol type_name) {
+  TypeCat category =
+      floatBits(type_name) != 0 ? TypeCat::FLOAT : TypeCat::INTEGER;
   TypeIdentifier typeIdentifier(type_name, kNonArrayDim, kNonArraySize,
-                                TypeCat::INTEGER, ValCat::PrValue);
+                                category, ValCat::PrValue);
 
-  return findVarTypeOrCreate(typeIdentifier, {}, {});
+  return findVarTypeOrCreate(table, typeIdentifier, {}, {});
 }
 
 ConstVarTypePtr VarType::getRefTypeFrom() const {
-  TypeIdentifier typeIdentifier(this->type_id_.type_name + "&", kNonArrayDim,
-                                kNonArraySize, TypeCat::REFERENCE,
-                                ValCat::NONE);
+  TypeIdentifier typeIdentifier(
+      Symbol(std::string(this->type_id_.type_name.str()) + "&"), kNonArrayDim,
+      kNonArraySize, TypeCat::REFERENCE, ValCat::NONE);
   auto res = findVarTypeOrCreate(
-      typeIdentifier,
-      MemberTypes{findVarTypeOrCreate(this->type_id_, this->members_,
-                                      this->member_name_to_index_)},
+      *table_, typeIdentifier,
+      MemberTypes{findVarTypeOrCreate(*table_, this->type_id_, this->members_,
+                                      this->member_name_to_index_,
+                                      this->attributes_)},
       {});
   return res;
 }
 ConstVarTypePtr VarType::getPrValueFrom() const {
   TypeIdentifier typeIdentifier = this->type_id_;
   typeIdentifier.value_category = ValCat::PrValue;
-  return findVarTypeOrCreate(typeIdentifier, this->members_,
-                             this->member_name_to_index_);
+  return findVarTypeOrCreate(*table_, typeIdentifier, this->members_,
+                             this->member_name_to_index_, this->attributes_);
 }
 ConstVarTypePtr VarType::getLValueFrom() const {
   TypeIdentifier typeIdentifier = this->type_id_;
   typeIdentifier.value_category = ValCat::LValue;
-  return findVarTypeOrCreate(typeIdentifier, this->members_,
-                             this->member_name_to_index_);
+  return findVarTypeOrCreate(*table_, typeIdentifier, this->members_,
+                             this->member_name_to_index_, this->attributes_);
 }
 
 ConstVarTypePtr VarType::getXValueFrom() const {
   TypeIdentifier typeIdentifier = this->type_id_;
   typeIdentifier.value_category = ValCat::XValue;
-  return findVarTypeOrCreate(typeIdentifier, this->members_,
-                             this->member_name_to_index_);
+  return findVarTypeOrCreate(*table_, typeIdentifier, this->members_,
+                             this->member_name_to_index_, this->attributes_);
 }
 
 llvm::Type* VarType::getLlvmInRegType(llvm::LLVMContext& context) const {
+  if (llvm::Type* cached = table_->findLlvmType(context, id_, false)) {
+    return cached;
+  }
+  llvm::Type* type = lowerInRegType(context);
+  table_->cacheLlvmType(context, id_, false, type);
+  return type;
+}
+
+llvm::Type* VarType::getLlvmStackAllocTy(llvm::LLVMContext& context) const {
+  if (llvm::Type* cached = table_->findLlvmType(context, id_, true)) {
+    return cached;
+  }
+  llvm::Type* type = lowerStackAllocTy(context);
+  table_->cacheLlvmType(context, id_, true, type);
+  return type;
+}
+
+llvm::Type* VarType::lowerInRegType(llvm::LLVMContext& context) const {
   // TODO(ian): rename this func
   switch (type_id_.type_category) {
     case TypeCat::REFERENCE:
@@ -110,7 +185,15 @@ llvm::Type* VarType::getLlvmInRegType(llvm::LLVMContext& context) const {
     case TypeCat::STRUCTURE:
       return llvm::PointerType::get(context, kDefaultAddressSpace);
     case TypeCat::INTEGER:
-      return llvm::Type::getInt64Ty(context);
+      return llvm::Type::getIntNTy(context, int_bits_);
+    case TypeCat::FLOAT:
+      return float_bits_ == 32 ? llvm::Type::getFloatTy(context)
+                               : llvm::Type::getDoubleTy(context);
+    case TypeCat::SLICE:
+      // the address of the first element and the length
+      return llvm::StructType::get(
+          llvm::PointerType::get(context, kDefaultAddressSpace),
+          llvm::Type::getInt64Ty(context));
     case TypeCat::VOID:
       return llvm::Type::getVoidTy(context);
     default:
@@ -118,63 +201,157 @@ llvm::Type* VarType::getLlvmInRegType(llvm::LLVMContext& context) const {
   }
 }
 
-llvm::Type* VarType::getLlvmStackAllocTy(llvm::LLVMContext& context) const {
+llvm::Type* VarType::lowerStackAllocTy(llvm::LLVMContext& context) const {
   // TODO(): rename this func
-  std::vector<llvm::Type*> llvmMembers(members_.size());
   switch (type_id_.type_category) {
     case TypeCat::REFERENCE:
       return llvm::PointerType::get(context, kDefaultAddressSpace);
     case TypeCat::ARRAY:
-      return llvm::ArrayType::get(getElemType()->getLlvmInRegType(context),
+      // the elements are stored in place, an array of structs holds structs
+      return llvm::ArrayType::get(getElemType()->getLlvmStackAllocTy(context),
                                   type_id_.size);
     case TypeCat::INTEGER:
-      return llvm::Type::getInt64Ty(context);
+      // a bool is an i1 in memory too, stored in a byte
+      return llvm::Type::getIntNTy(context, int_bits_);
+    case TypeCat::FLOAT:
+    case TypeCat::SLICE:
+      return getLlvmInRegType(context);
     case TypeCat::VOID:
       return llvm::Type::getVoidTy(context);
-    case TypeCat::STRUCTURE:
-      // todo: refactor to func
-      std::transform(members_.begin(), members_.end(), llvmMembers.begin(),
-                     [&](const ConstVarTypePtr& ptr) {
-                       return ptr->getLlvmStackAllocTy(context);
-                     });
-      return llvm::StructType::create(llvmMembers, "test", false);
+    case TypeCat::STRUCTURE: {
+      // every value category of the struct is lowered to the same type
+      llvm::StringRef name = type_id_.type_name.str();
+      if (auto* existing = llvm::StructType::getTypeByName(context, name)) {
+        return existing;
+      }
+      // the members in layout order, with byte arrays wherever the layout
+      // puts a member further than it would naturally go
+      std::vector<llvm::Type*> llvmMembers;
+      int64_t offset = 0;
+      auto pad_to = [&](int64_t target) {
+        if (target > offset) {
+          llvmMembers.push_back(llvm::ArrayType::get(
+              llvm::Type::getInt8Ty(context), target - offset));
+          offset = target;
+        }
+      };
+      for (uint32_t index : layout_order_) {
+        const VarType& member = *members_[index];
+        pad_to(member_offsets_[index]);
+        llvmMembers.push_back(member.getLlvmStackAllocTy(context));
+        offset += member.getObjectSize();
+      }
+      pad_to(getObjectSize());
+      return llvm::StructType::create(context, llvmMembers, name);
+    }
     default:
       FRONTEND_ERROR("unknown type");
   }
 }
 
 int64_t VarType::getObjectSize() const {
+  if (object_size_ == kUnknownSize) {
+    FRONTEND_ERROR("unknown type");
+  }
+  return object_size_;
+}
+
+int64_t VarType::getMemberOffset(Symbol member_name) const {
+  ASSERT(is_struct(), "type is not of struct type");
+  if (object_size_ == kUnknownSize) {
+    FRONTEND_ERROR("unknown type");
+  }
+  return member_offsets_[member_name_to_index_.at(member_name)];
+}
+
+namespace {
+int64_t alignTo(int64_t offset, int64_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+void VarType::computeLayout() {
   switch (type_id_.type_category) {
     case TypeCat::STRUCTURE:
-      return getStructSize();
+      computeStructLayout();
+      break;
     case TypeCat::ARRAY:
-      return type_id_.size * getElemType()->getObjectSize();
-    case TypeCat::INTEGER:
+      alignment_ = members_.back()->alignment_;
+      if (members_.back()->object_size_ != kUnknownSize) {
+        object_size_ = type_id_.size * members_.back()->object_size_;
+      }
+      break;
+    case TypeCat::INTEGER: {
+      // an integer type no table knows, e.g. from a corrupt interface, is
+      // an int64
+      const IntegerType* integer = findIntegerType(type_id_.type_name);
+      int_bits_ = integer != nullptr ? integer->bits : 64;
+      is_signed_ = integer != nullptr ? integer->is_signed : true;
+      object_size_ = std::max(int_bits_ / 8, 1);
+      alignment_ = object_size_;
+      break;
+    }
+    case TypeCat::FLOAT:
+      // a floating-point type no table knows is a float64
+      float_bits_ = floatBits(type_id_.type_name) == 32 ? 32 : 64;
+      object_size_ = float_bits_ / 8;
+      alignment_ = object_size_;
+      break;
     case TypeCat::VOID:
     case TypeCat::REFERENCE:
-      return 8;
+      object_size_ = 8;
+      alignment_ = 8;
+      break;
+    case TypeCat::SLICE:
+      object_size_ = 16;
+      alignment_ = 8;
+      break;
     default:
-      FRONTEND_ERROR("unknown type");
+      break;
   }
 }
-int64_t VarType::getStructSize() const {
-  int64_t totalSize = 0;
-  for (const auto& memberType : members_) {
-    totalSize += memberType->getObjectSize();
+
+void VarType::computeStructLayout() {
+  layout_order_.resize(members_.size());
+  for (uint32_t i = 0; i < layout_order_.size(); i++) {
+    layout_order_[i] = i;
+  }
+  // the most aligned members first leave no holes between the members, the
+  // declaration order breaks ties
+  if (attributes_.reorder) {
+    std::stable_sort(layout_order_.begin(), layout_order_.end(),
+                     [&](uint32_t a, uint32_t b) {
+                       return members_[a]->alignment_ >
+                              members_[b]->alignment_;
+                     });
   }
-  return totalSize;
+  alignment_ = std::max<int64_t>(attributes_.align, 1);
+  member_offsets_.assign(members_.size(), 0);
+  int64_t offset = 0;
+  for (uint32_t index : layout_order_) {
+    const VarType& member = *members_[index];
+    if (member.object_size_ == kUnknownSize) {
+      return;
+    }
+    alignment_ = std::max(alignment_, member.alignment_);
+    offset = alignTo(offset, member.alignment_);
+    member_offsets_[index] = offset;
+    offset += member.object_size_;
+  }
+  object_size_ = alignTo(offset, alignment_);
 }
 
 const ConstVarTypePtr& VarType::getElemType() const {
-  ASSERT(is_array() || (is_ref() || get_referenced_type()->is_array()),
+  ASSERT(is_array() || is_slice() ||
+             (is_ref() || get_referenced_type()->is_array()),
          "type is not of array type");
-  if (isArray()) {
+  if (isArray() || isSlice()) {
     return members_.back();
   }
   return getReferencedType()->members_.back();
 }
 
-const VarType& VarType::getMemberType(const std::string& member_name) const {
+const VarType& VarType::getMemberType(Symbol member_name) const {
   ASSERT(is_struct(), "type is not of struct type");
   return *members_[member_name_to_index_.at(member_name)];
 }
@@ -197,13 +374,17 @@ std::string VarType::getTypeName() const {
     default:
       FRONTEND_ERROR("no matching category found");
   }
-  return type_id_.type_name + " " + valueCategory;
+  return std::string(type_id_.type_name.str()) + " " + valueCategory;
 }
 
 bool VarType::isArray() const {
   return type_id_.type_category == TypeCat::ARRAY;
 }
 
+bool VarType::isSlice() const {
+  return type_id_.type_category == TypeCat::SLICE;
+}
+
 bool VarType::isStruct() const {
   return type_id_.type_category == TypeCat::STRUCTURE;
 }
@@ -213,13 +394,53 @@ bool VarType::isRef() const {
 }
 
 bool VarType::isPrimitive() const {
-  return isInt() || isVoid();
+  return isNumeric() || isVoid();
 }
 
 bool VarType::isInt() const {
   return type_id_.type_category == TypeCat::INTEGER;
 }
 
+bool VarType::isBool() const {
+  return isInt() && int_bits_ == 1;
+}
+
+bool VarType::isFloat() const {
+  return type_id_.type_category == TypeCat::FLOAT;
+}
+
+bool VarType::isNumeric() const {
+  return isInt() || isFloat();
+}
+
+VarType::Conversion VarType::getConversion(const VarType& from,
+                                           const VarType& to) {
+  ASSERT(from.is_numeric() && to.is_numeric(), "converting a non number");
+  if (to.isBool()) {
+    return from.isBool() ? Conversion::NONE : Conversion::TO_BOOL;
+  }
+  if (from.isFloat() && to.isFloat()) {
+    if (to.float_bits_ == from.float_bits_) {
+      return Conversion::NONE;
+    }
+    return to.float_bits_ < from.float_bits_ ? Conversion::FP_TRUNC
+                                             : Conversion::FP_EXT;
+  }
+  if (from.isFloat()) {
+    return to.is_signed_ ? Conversion::FP_TO_SI : Conversion::FP_TO_UI;
+  }
+  if (to.isFloat()) {
+    return from.is_signed_ ? Conversion::SI_TO_FP : Conversion::UI_TO_FP;
+  }
+  if (to.int_bits_ == from.int_bits_) {
+    return Conversion::NONE;
+  }
+  if (to.int_bits_ < from.int_bits_) {
+    return Conversion::TRUNC;
+  }
+  return from.is_signed_ ? Conversion::SEXT : Conversion::ZEXT;
+}
+
 bool VarType::isVoid() const {
   return type_id_.type_category == TypeCat::VOID;
 }
@@ -234,46 +455,94 @@ bool VarType::isPrValue() const {
   return type_id_.value_category == ValCat::PrValue;
 }
 
-VarType::TypeIdentifier::TypeIdentifier(std::string type_name, int64_t n_dims,
+VarType::TypeIdentifier::TypeIdentifier(Symbol type_name, int64_t n_dims,
                                         int64_t n_size, TypeCat type_category,
                                         ValCat value_category)
     : n_dims(n_dims),
       size(n_size),
-      type_name(std::move(type_name)),
+      type_name(type_name),
       type_category(type_category),
       value_category(value_category) {}
 
 VarType::VarType(TypeIdentifier type_identifier, MemberTypes members,
-                 MemberNameToIndex member_name_to_index)
+                 MemberNameToIndex member_name_to_index,
+                 StructAttributes attributes)
     : type_id_(std::move(type_identifier)),
+      attributes_(attributes),
       members_(std::move(members)),
-      member_name_to_index_(std::move(member_name_to_index)) {}
+      member_name_to_index_(std::move(member_name_to_index)) {
+  // the members are created first and never change
+  computeLayout();
+}
+
+size_t VarType::TypeIdentifierHash::operator()(
+    const TypeIdentifier& id) const {
+  uint64_t hash = id.type_name.id();
+  for (uint64_t field :
+       {static_cast<uint64_t>(id.n_dims), static_cast<uint64_t>(id.size),
+        static_cast<uint64_t>(id.type_category),
+        static_cast<uint64_t>(id.value_category)}) {
+    hash ^= field + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  }
+  return static_cast<size_t>(hash);
+}
 
 ConstVarTypePtr VarType::findVarTypeOrCreate(
-    const TypeIdentifier& type_identifier, MemberTypes members,
-    MemberNameToIndex member_name_to_index) {
-
-  static std::vector<ConstVarTypePtr> allocatedVarTypes = {
-      // primitive types
-      ConstVarTypePtr(new VarType(
-          VarType::TypeIdentifier("int64", kNonArrayDim, kNonArraySize,
-                                  TypeCat::INTEGER, ValCat::NONE),
-          {}, {})),
-      ConstVarTypePtr(new VarType(
-          VarType::TypeIdentifier("void", kNonArrayDim, kNonArraySize,
-                                  TypeCat::VOID, ValCat::NONE),
-          {}, {}))};
-
-  // try to find if it exists in the map
-  for (auto& type : allocatedVarTypes) {
-    if (type->type_id_ == type_identifier) {
-      return type;
-    }
+    TypeTable& table, const TypeIdentifier& type_identifier,
+    const MemberTypes& members, const MemberNameToIndex& member_name_to_index,
+    const StructAttributes& attributes) {
+  std::lock_guard<std::mutex> lock(table.mutex_);
+
+  auto [it, inserted] = table.index_.try_emplace(
+      type_identifier, static_cast<uint32_t>(table.types_.size()));
+  if (!inserted) {
+    return table.types_[it->second];
+  }
+  auto* type = new VarType(type_identifier, members, member_name_to_index,
+                           attributes);
+  type->table_ = &table;
+  type->id_ = it->second;
+  table.types_.emplace_back(type);
+  return table.types_.back();
+}
+
+size_t TypeTable::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return types_.size();
+}
+
+void TypeTable::releaseLlvmTypes(const llvm::LLVMContext& context) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  llvm_types_.erase(&context);
+}
+
+// Types are lowered outside the lock, so this only guards the cache itself.
+// An LLVMContext must not be used by two threads at once, and lowering into
+// one concurrently is not supported: the StructType::create in
+// lowerStackAllocTy could then make a second, renamed %Name.0 type. Threads
+// that generate code each use a context, and a cache, of their own.
+llvm::Type* TypeTable::findLlvmType(const llvm::LLVMContext& context,
+                                    uint32_t id, bool stack) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = llvm_types_.find(&context);
+  if (it == llvm_types_.end()) {
+    return nullptr;
   }
-  allocatedVarTypes.emplace_back(new VarType(
-      type_identifier, std::move(members), std::move(member_name_to_index)));
-  return allocatedVarTypes.back();
+  const auto& types = stack ? it->second.stack : it->second.in_reg;
+  return id < types.size() ? types[id] : nullptr;
 }
+
+void TypeTable::cacheLlvmType(const llvm::LLVMContext& context, uint32_t id,
+                              bool stack, llvm::Type* type) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LlvmTypes& cache = llvm_types_[&context];
+  auto& types = stack ? cache.stack : cache.in_reg;
+  if (types.size() <= id) {
+    types.resize(types_.size(), nullptr);
+  }
+  types[id] = type;
+}
+
 VarType::ValCat VarType::getValueCategory() const {
   return type_id_.value_category;
 }
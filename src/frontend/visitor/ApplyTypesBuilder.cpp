@@ -4,57 +4,258 @@
 
 #include "frontend/visitor/ApplyTypesBuilder.h"
 #include <cassert>
+#include <type_traits>
+#include "frontend/compilation_context.h"
 #include "frontend/diagnostic/debug.h"
 #include "frontend/types/VarType.h"
 
 namespace frontend {
+namespace {
+Symbol voidName() {
+  static const Symbol name("void");
+  return name;
+}
+Symbol boolName() {
+  static const Symbol name("bool");
+  return name;
+}
+Symbol int64Name() {
+  static const Symbol name("int64");
+  return name;
+}
+
+// a binary operation dereferences its operands
+const VarType& valueType(const VarType& type) {
+  return type.isRef() ? *type.getReferencedType() : type;
+}
+
+bool isComparison(ast::BinOpId op) {
+  return op == ast::BinOpId::LT || op == ast::BinOpId::GT ||
+         op == ast::BinOpId::EQ || op == ast::BinOpId::LEQ ||
+         op == ast::BinOpId::GEQ;
+}
+
+// a literal takes the type of the other operand, but a floating-point one
+// only that of another floating-point operand
+bool isLiteralFor(const ast::Value& value, const VarType& other) {
+  return ast::isa<ast::Integer>(&value) ||
+         (ast::isa<ast::Float>(&value) && other.isFloat());
+}
+
+// The type both operands of bin_op are converted to. A literal takes the
+// type of the other operand. Otherwise a floating-point type wins over an
+// integer one, the wider of two types of the same kind wins, and between
+// integer types of the same width the unsigned one. A shift keeps the type
+// of the value shifted.
+ConstVarTypePtr operandType(const ast::BinaryOperation& bin_op) {
+  const VarType& lhs = valueType(*bin_op.lhs->type);
+  const VarType& rhs = valueType(*bin_op.rhs->type);
+  bool shift = bin_op.op == ast::BinOpId::SHL || bin_op.op == ast::BinOpId::SHR;
+  if (shift || !lhs.isNumeric() || !rhs.isNumeric() ||
+      isLiteralFor(*bin_op.rhs, lhs)) {
+    return lhs.getPrValueFrom();
+  }
+  if (isLiteralFor(*bin_op.lhs, rhs)) {
+    return rhs.getPrValueFrom();
+  }
+  if (lhs.isFloat() || rhs.isFloat()) {
+    if (!rhs.isFloat() || (lhs.isFloat() &&
+                           lhs.getFloatBits() >= rhs.getFloatBits())) {
+      return lhs.getPrValueFrom();
+    }
+    return rhs.getPrValueFrom();
+  }
+  if (lhs.getIntBits() != rhs.getIntBits()) {
+    return lhs.getIntBits() > rhs.getIntBits() ? lhs.getPrValueFrom()
+                                               : rhs.getPrValueFrom();
+  }
+  return lhs.isSigned() ? rhs.getPrValueFrom() : lhs.getPrValueFrom();
+}
+
+// todo: doesnt support difference between references and nonref
+// every index selects one dimension, an access names one element, so it
+// indexes all of them. A slice has one dimension.
+ConstVarTypePtr arrayAccessType(const ast::ArrayAccess& access) {
+  ConstVarTypePtr type = access.var->type;
+  for (const auto& index : access.indices) {
+    if (!valueType(*index->type).isInt()) {
+      FRONTEND_ERROR("array index is not an integer");
+    }
+    if (!valueType(*type).isArray() && !valueType(*type).isSlice()) {
+      FRONTEND_ERROR("too many indices for array " +
+                     access.var->type->getTypeName());
+    }
+    type = type->getElemType();
+  }
+  if (type->isArray()) {
+    FRONTEND_ERROR("too few indices for array " +
+                   access.var->type->getTypeName());
+  }
+  return type->getRefTypeFrom();
+}
+
+// a slice is only stored to a slice, and a value stored to a slice is an
+// array or a slice of the same elements, an array converts to a slice of all
+// its elements
+void checkSliceConversion(const VarType& from, const VarType& to) {
+  const VarType& from_value = valueType(from);
+  const VarType& to_value = valueType(to);
+  if (!to_value.isSlice() && !from_value.isSlice()) {
+    return;
+  }
+  if (!to_value.isSlice() ||
+      (!from_value.isArray() && !from_value.isSlice()) ||
+      from_value.getElemType() != to_value.getElemType()) {
+    FRONTEND_ERROR("cannot convert " + from.getTypeName() + " to " +
+                   to.getTypeName());
+  }
+}
+
+// calls fn with inst and every instruction nested in it
+template <typename Fn>
+void forEachInstruction(const ast::Instruction& inst, Fn&& fn) {
+  fn(inst);
+  if (const auto* scope = ast::dyn_cast<ast::Scope>(&inst)) {
+    for (const auto& child : scope->instructions) {
+      forEachInstruction(*child, fn);
+    }
+  } else if (const auto* loop =
+                 ast::dyn_cast<ast::InstructionWhileLoop>(&inst)) {
+    forEachInstruction(*loop->body, fn);
+  } else if (const auto* if_stmt =
+                 ast::dyn_cast<ast::InstructionIfStatement>(&inst)) {
+    forEachInstruction(*if_stmt->true_scope, fn);
+  }
+}
+
+// a slice returned by function must not point into its frame, where its local
+// arrays, the arrays passed to it by value and the arrays [v; n] makes all
+// live. Only what a reference parameter refers to outlives the call. The
+// assignments are followed regardless of their order, so a variable that is
+// ever made to point into the frame is never returned as a slice.
+void checkReturnedSlices(const ast::Function& function) {
+  // by variable index, whether the variable may point into the frame
+  std::vector<bool> into_frame(function.variables.size());
+  for (const auto& [name, var] : function.variables) {
+    into_frame[var->index] = var->type != nullptr && var->type->isArray();
+  }
+  auto intoFrame = [&](const ast::Value& value, auto& self) -> bool {
+    if (const auto* var = ast::dyn_cast<ast::Variable>(&value)) {
+      return into_frame[var->index];
+    } else if (const auto* access = ast::dyn_cast<ast::ArrayAccess>(&value)) {
+      return self(*access->var, self);
+    } else if (const auto* call = ast::dyn_cast<ast::FunctionCall>(&value)) {
+      // a returned array is written to a slot of this frame, and a returned
+      // slice may be of any argument
+      if (call->type->isArray()) {
+        return true;
+      }
+      for (const auto& arg : call->args) {
+        if (self(*arg, self)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    return ast::isa<ast::ArrayAllocate>(&value);
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    forEachInstruction(*function.scope, [&](const ast::Instruction& inst) {
+      const auto* assign = ast::dyn_cast<ast::InstructionAssignment>(&inst);
+      // only a slice or a reference is made to point elsewhere
+      if (assign == nullptr ||
+          (!valueType(*assign->dst->type).isSlice() &&
+           !valueType(*assign->dst->type).isArray()) ||
+          !intoFrame(*assign->src, intoFrame)) {
+        return;
+      }
+      const ast::Value* dst = assign->dst;
+      while (const auto* access = ast::dyn_cast<ast::ArrayAccess>(dst)) {
+        dst = access->var;
+      }
+      const auto* var = ast::dyn_cast<ast::Variable>(dst);
+      if (var != nullptr && !into_frame[var->index]) {
+        into_frame[var->index] = true;
+        changed = true;
+      }
+    });
+  }
+
+  forEachInstruction(*function.scope, [&](const ast::Instruction& inst) {
+    const auto* ret = ast::dyn_cast<ast::InstructionReturn>(&inst);
+    if (ret != nullptr && ret->val != nullptr &&
+        valueType(*ret->type).isSlice() && intoFrame(*ret->val, intoFrame)) {
+      FRONTEND_ERROR("cannot return " + ret->val->type->getTypeName() +
+                     " from " + std::string(function.name.str()) +
+                     ", it may point into the returning frame");
+    }
+  });
+}
+}  // namespace
+
+ApplyTypesBuilder::ApplyTypesBuilder(CompilationContext& compilation)
+    : compilation_(compilation) {}
+
 Program ApplyTypesBuilder::build_program(const Program& program) {
-  return traverse_program(program);
+  Program typed = traverse_program(program);
+  for (const ast::Function* function : typed.functions) {
+    checkReturnedSlices(*function);
+  }
+  return typed;
 }
 
 ast::ConstValuePtr ApplyTypesBuilder::visit_val(
     const ast::Variable& var, TraverseAst::TraversalState& state) {
-  auto newVar = ast::Variable::get(var.name, state.new_function);
+  auto newVar =
+      state.new_function->getVariable(var.name, *state.new_program->arena);
   if (newVar->type == nullptr)
     newVar->type = var.type;
+  if (newVar->line == 0)
+    newVar->line = var.line;
   return newVar;
 }
 
 ast::ConstValuePtr ApplyTypesBuilder::visit_val(const ast::Integer& num,
                                                 TraverseAst::TraversalState&) {
-  return std::make_shared<ast::Integer>(num.value);
+  return make<ast::Integer>(num.value, num.type);
+}
+
+ast::ConstValuePtr ApplyTypesBuilder::visit_val(const ast::Float& num,
+                                                TraverseAst::TraversalState&) {
+  return make<ast::Float>(num.value, num.type);
 }
 
 ast::ConstValuePtr ApplyTypesBuilder::visit_val(
     const ast::FunctionName& func_name, TraverseAst::TraversalState&) {
   // todo: maybe functions dont always return prvalues
-  auto newFunc = std::make_shared<ast::FunctionName>(
-      std::string(func_name.name), func_name.return_type->getPrValueFrom());
+  auto newFunc = make<ast::FunctionName>(
+      func_name.name, func_name.return_type->getPrValueFrom());
   newFunc->type = newFunc->return_type;
   return newFunc;
 }
 
 ast::ConstValuePtr ApplyTypesBuilder::visit_val(
     const ast::BinaryOperation& bin_op, TraverseAst::TraversalState&) {
-  auto newBinOp = std::make_shared<ast::BinaryOperation>(
+  auto newBinOp = make<ast::BinaryOperation>(
       bin_op.op, get(*bin_op.lhs), get(*bin_op.rhs));
-  // todo: work needed in the type class to support
-  if (newBinOp->lhs->type->isRef()) {
-    // binop dereferences
-    newBinOp->type = newBinOp->lhs->type->getReferencedType()->getPrValueFrom();
-  } else {
-    newBinOp->type = newBinOp->lhs->type->getPrValueFrom();
-  }
+  typeBinaryOperation(*newBinOp);
   return newBinOp;
 }
 ast::ConstValuePtr ApplyTypesBuilder::visit_val(const ast::FunctionCall& call,
                                                 TraverseAst::TraversalState&) {
-  auto newCall = std::make_unique<ast::FunctionCall>(
+  auto newCall = make<ast::FunctionCall>(
       get(*call.function), std::vector<ast::ConstValuePtr>{});
   for (const auto& arg : call.args) {
     newCall->args.push_back(get(*arg));
   }
   newCall->arg_types = call.arg_types;
+  for (size_t i = 0; i < newCall->args.size() && i < call.arg_types.size();
+       i++) {
+    checkSliceConversion(*newCall->args[i]->type, *call.arg_types[i]);
+  }
 
   // todo: only handle pr value returns
   // careful when changing!!!!, load value expects uses the fact that references are returned as rvalues
@@ -64,35 +265,71 @@ ast::ConstValuePtr ApplyTypesBuilder::visit_val(const ast::FunctionCall& call,
 }
 ast::ConstValuePtr ApplyTypesBuilder::visit_val(const ast::ArrayAccess& access,
                                                 TraverseAst::TraversalState&) {
-  assert(access.indices.size() == 1 && "Only 1d array supported");
   std::vector<ast::ConstValuePtr> indices;
-  indices.push_back(get(*access.indices.back()));
-  auto newAccess = std::make_shared<ast::ArrayAccess>(
-      std::move(get(*access.var)), std::move(indices), 1);
-  // todo: doesnt support difference between references and nonref
-  newAccess->type = newAccess->var->type->getElemType()->getRefTypeFrom();
+  for (const auto& index : access.indices) {
+    indices.push_back(get(*index));
+  }
+  auto newAccess = make<ast::ArrayAccess>(get(*access.var), std::move(indices),
+                                          access.line);
+  newAccess->type = arrayAccessType(*newAccess);
   return newAccess;
 }
 ast::ConstValuePtr ApplyTypesBuilder::visit_val(const ast::ArrayAllocate& alloc,
                                                 TraverseAst::TraversalState&) {
   auto elem = get(*alloc.elem_value);
-  auto elemType = elem->type;
-  auto arrayType = VarType::getArrayType(
-      elem->type->getTypeName(), 1,
-      dynamic_cast<const ast::Integer&>(*alloc.length).value, elemType);
-  auto newAlloc =
-      std::make_shared<ast::ArrayAllocate>(get(*alloc.length), std::move(elem));
-  newAlloc->type = arrayType;
+  auto newAlloc = make<ast::ArrayAllocate>(get(*alloc.length), elem);
+  newAlloc->type = arrayAllocateType(elem->type, *alloc.length);
   return newAlloc;
 }
+ast::ConstValuePtr ApplyTypesBuilder::visit_val(const ast::ArrayLength& length,
+                                                TraverseAst::TraversalState&) {
+  auto newLength = make<ast::ArrayLength>(get(*length.array));
+  newLength->type = arrayLengthType(*newLength->array);
+  return newLength;
+}
+void ApplyTypesBuilder::typeBinaryOperation(ast::BinaryOperation& bin_op) {
+  bin_op.operand_type = operandType(bin_op);
+  bool bitwise = bin_op.op == ast::BinOpId::AND ||
+                 bin_op.op == ast::BinOpId::SHL ||
+                 bin_op.op == ast::BinOpId::SHR;
+  if (bitwise && bin_op.operand_type->isFloat()) {
+    FRONTEND_ERROR("operator " + ast::binopToString(bin_op.op) +
+                   " needs integer operands");
+  }
+  bin_op.type = isComparison(bin_op.op)
+                    ? VarType::getAtomicType(compilation_.types(), boolName())
+                          ->getPrValueFrom()
+                    : bin_op.operand_type;
+}
+ConstVarTypePtr ApplyTypesBuilder::arrayLengthType(const ast::Value& array) {
+  const VarType& array_type = valueType(*array.type);
+  if (!array_type.isArray() && !array_type.isSlice()) {
+    FRONTEND_ERROR("length of " + array.type->getTypeName() +
+                   ", which is not an array");
+  }
+  return VarType::getAtomicType(compilation_.types(), int64Name())
+      ->getPrValueFrom();
+}
+ConstVarTypePtr ApplyTypesBuilder::arrayAllocateType(
+    const ConstVarTypePtr& elem_type, const ast::Value& length) {
+  ConstVarTypePtr elemType = elem_type;
+  return VarType::getArrayType(compilation_.types(),
+                               Symbol(elem_type->getTypeName()), 1,
+                               ast::cast<ast::Integer>(&length)->value,
+                               elemType);
+}
 ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(
-    const ast::InstructionReturn& ret, TraverseAst::TraversalState&) {
-  auto newRet = std::make_unique<ast::InstructionReturn>();
+    const ast::InstructionReturn& ret, TraverseAst::TraversalState& state) {
+  auto newRet = make<ast::InstructionReturn>();
+  newRet->line = ret.line;
   if (ret.val != nullptr) {
     newRet->val = get(*ret.val);
-    newRet->type = newRet->val->type;
+    // the value is converted to the function's return type
+    newRet->type = state.old_function->type;
+    checkSliceConversion(*newRet->val->type, *newRet->type);
   } else {
-    newRet->type = VarType::getAtomicType("void");
+    newRet->type =
+        VarType::getAtomicType(compilation_.types(), voidName());
   }
   return newRet;
 }
@@ -100,14 +337,15 @@ ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(
     const ast::InstructionAssignment& assign, TraverseAst::TraversalState&) {
   auto newSrc = get(*assign.src);
   auto newDst = get(*assign.dst);
-  auto newAssign = std::make_unique<ast::InstructionAssignment>(
-      std::move(newDst), std::move(newSrc));
+  checkSliceConversion(*newSrc->type, *newDst->type);
+  auto newAssign = make<ast::InstructionAssignment>(newDst, newSrc);
+  newAssign->line = assign.line;
   return newAssign;
 }
 ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(
     const ast::InstructionFunctionCall& call, TraverseAst::TraversalState&) {
-  auto newCall =
-      std::make_unique<ast::InstructionFunctionCall>(get(*call.function_call));
+  auto newCall = make<ast::InstructionFunctionCall>(get(*call.function_call));
+  newCall->line = call.line;
   // TODO(ian): could warn about unused result???
 
   newCall->type = call.function_call->type;
@@ -115,14 +353,16 @@ ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(
 }
 ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(
     const ast::InstructionWhileLoop& loop, TraverseAst::TraversalState&) {
-  auto newLoop = std::make_unique<ast::InstructionWhileLoop>(get(*loop.cond),
-                                                             get(*loop.body));
+  auto newLoop =
+      make<ast::InstructionWhileLoop>(get(*loop.cond), get(*loop.body));
+  newLoop->line = loop.line;
   return newLoop;  // no type associated
 }
 ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(
     const ast::InstructionIfStatement& if_stmt, TraverseAst::TraversalState&) {
-  auto newIfStmt = std::make_unique<ast::InstructionIfStatement>(
+  auto newIfStmt = make<ast::InstructionIfStatement>(
       get(*if_stmt.cond), get(*if_stmt.true_scope));
+  newIfStmt->line = if_stmt.line;
   return newIfStmt;  // no type associated
 }
 ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(const ast::InstructionBreak&,
@@ -135,8 +375,8 @@ ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(
 }
 ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(
     const ast::InstructionDecl& decl, TraverseAst::TraversalState&) {
-  auto newDecl =
-      std::make_unique<ast::InstructionDecl>(std::vector<ast::ValuePtr>{});
+  auto newDecl = make<ast::InstructionDecl>(std::vector<ast::ValuePtr>{});
+  newDecl->line = decl.line;
   for (const auto& var : decl.variables) {
     newDecl->variables.push_back(get(*var));
   }
@@ -144,11 +384,123 @@ ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(
 }
 ast::ConstInstrPtr ApplyTypesBuilder::visit_inst(const ast::Scope& scope,
                                                  TraverseAst::TraversalState&) {
-  auto newScope = std::make_unique<ast::Scope>();
-  newScope->type = VarType::getAtomicType("void");
+  auto newScope = make<ast::Scope>();
+  newScope->type =
+      VarType::getAtomicType(compilation_.types(), voidName());
   for (const auto& inst : scope.instructions) {
     newScope->instructions.push_back(get(*inst));
   }
   return newScope;
 }
+
+// ========== In place ==========
+void ApplyTypesBuilder::apply_types(Program& program) {
+  for (ast::Function* function : program.functions) {
+    function_ = function;
+    for (const auto& arg : function->args) {
+      annotate(*arg);
+    }
+    annotate(*function->scope);
+    checkReturnedSlices(*function);
+  }
+}
+
+// Every node is made non-const in its Program's arena, the tree only links
+// nodes through const pointers. Writing a type through one is fine here since
+// the caller handed over the Program itself.
+void ApplyTypesBuilder::annotate(const ast::Value& value) {
+  ast::visit(value, [this](const auto& node) {
+    annotate_node(const_cast<std::remove_cvref_t<decltype(node)>&>(node));
+  });
+}
+void ApplyTypesBuilder::annotate(const ast::Instruction& inst) {
+  ast::visit(inst, [this](const auto& node) {
+    annotate_node(const_cast<std::remove_cvref_t<decltype(node)>&>(node));
+  });
+}
+
+void ApplyTypesBuilder::annotate_node(ast::Variable&) {
+  // variables are typed where they are declared
+}
+void ApplyTypesBuilder::annotate_node(ast::Integer&) {}
+void ApplyTypesBuilder::annotate_node(ast::Float&) {}
+void ApplyTypesBuilder::annotate_node(ast::FunctionName& func_name) {
+  func_name.return_type = func_name.return_type->getPrValueFrom();
+  func_name.type = func_name.return_type;
+}
+void ApplyTypesBuilder::annotate_node(ast::BinaryOperation& bin_op) {
+  annotate(*bin_op.lhs);
+  annotate(*bin_op.rhs);
+  typeBinaryOperation(bin_op);
+}
+void ApplyTypesBuilder::annotate_node(ast::FunctionCall& call) {
+  annotate(*call.function);
+  for (const auto& arg : call.args) {
+    annotate(*arg);
+  }
+  for (size_t i = 0; i < call.args.size() && i < call.arg_types.size(); i++) {
+    checkSliceConversion(*call.args[i]->type, *call.arg_types[i]);
+  }
+  call.type = call.function->type->getPrValueFrom();
+}
+void ApplyTypesBuilder::annotate_node(ast::ArrayAccess& access) {
+  annotate(*access.var);
+  for (const auto& index : access.indices) {
+    annotate(*index);
+  }
+  access.type = arrayAccessType(access);
+}
+void ApplyTypesBuilder::annotate_node(ast::ArrayAllocate& alloc) {
+  annotate(*alloc.elem_value);
+  annotate(*alloc.length);
+  alloc.type = arrayAllocateType(alloc.elem_value->type, *alloc.length);
+}
+void ApplyTypesBuilder::annotate_node(ast::ArrayLength& length) {
+  annotate(*length.array);
+  length.type = arrayLengthType(*length.array);
+}
+void ApplyTypesBuilder::annotate_node(ast::InstructionReturn& ret) {
+  if (ret.val != nullptr) {
+    annotate(*ret.val);
+    // the value is converted to the function's return type
+    ret.type = function_->type;
+    checkSliceConversion(*ret.val->type, *ret.type);
+  } else {
+    ret.type = VarType::getAtomicType(compilation_.types(), voidName());
+  }
+}
+void ApplyTypesBuilder::annotate_node(ast::InstructionAssignment& assign) {
+  annotate(*assign.src);
+  annotate(*assign.dst);
+  checkSliceConversion(*assign.src->type, *assign.dst->type);
+}
+void ApplyTypesBuilder::annotate_node(ast::InstructionFunctionCall& call) {
+  annotate(*call.function_call);
+  call.type = call.function_call->type;
+}
+void ApplyTypesBuilder::annotate_node(ast::InstructionWhileLoop& loop) {
+  annotate(*loop.cond);
+  annotate(*loop.body);
+}
+void ApplyTypesBuilder::annotate_node(ast::InstructionIfStatement& if_stmt) {
+  annotate(*if_stmt.cond);
+  annotate(*if_stmt.true_scope);
+}
+void ApplyTypesBuilder::annotate_node(ast::InstructionBreak&) {
+  FRONTEND_ERROR("break is not supported");
+}
+void ApplyTypesBuilder::annotate_node(ast::InstructionContinue&) {
+  FRONTEND_ERROR("continue is not supported");
+}
+void ApplyTypesBuilder::annotate_node(ast::InstructionDecl& decl) {
+  for (const auto& var : decl.variables) {
+    annotate(*var);
+  }
+}
+void ApplyTypesBuilder::annotate_node(ast::Scope& scope) {
+  scope.type = VarType::getAtomicType(compilation_.types(), voidName());
+  for (const auto& inst : scope.instructions) {
+    annotate(*inst);
+  }
+}
 }  // namespace frontend
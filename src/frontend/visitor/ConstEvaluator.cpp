@@ -0,0 +1,707 @@
+#include "frontend/visitor/ConstEvaluator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "frontend/types/VarType.h"
+
+namespace frontend {
+namespace {
+using Functions = std::unordered_map<Symbol, const ast::Function*>;
+
+// a value is used through a reference the same way codegen loads it
+const VarType& valueType(const VarType& type) {
+  return type.isRef() ? *type.getReferencedType() : type;
+}
+
+// an array of integers or of such arrays, held flattened in row-major order
+bool isIntArray(const VarType& type) {
+  return type.isArray() &&
+         (type.getElemType()->isInt() || isIntArray(*type.getElemType()));
+}
+
+// the integers in an array of type
+size_t flatSize(const VarType& type) {
+  if (!type.isArray()) {
+    return 1;
+  }
+  return type.getArraySize() * flatSize(*type.getElemType());
+}
+
+// the bits of an integer of type, the ones above its width cleared
+uint64_t unsignedBits(int64_t value, const VarType& type) {
+  int bits = type.getIntBits();
+  uint64_t mask = bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+  return static_cast<uint64_t>(value) & mask;
+}
+
+// value truncated to the width of type, then extended back to 64 bits by
+// its signedness. Every integer is held that way, so it is also the value
+// of a 64-bit register holding it after sext or zext.
+int64_t wrap(uint64_t value, const VarType& type) {
+  int bits = type.getIntBits();
+  uint64_t truncated = unsignedBits(static_cast<int64_t>(value), type);
+  if (bits < 64 && type.isSigned() && (truncated >> (bits - 1)) != 0) {
+    truncated |= ~uint64_t{0} << bits;
+  }
+  return static_cast<int64_t>(truncated);
+}
+
+// the integer conversions of IRValueGen::convert, nullopt for any other
+std::optional<int64_t> convert(int64_t value, const VarType& from,
+                               const VarType& to) {
+  const VarType& from_value = valueType(from);
+  const VarType& to_value = valueType(to);
+  if (!from_value.isInt() || !to_value.isInt()) {
+    return std::nullopt;
+  }
+  if (VarType::getConversion(from_value, to_value) ==
+      VarType::Conversion::TO_BOOL) {
+    return value != 0;
+  }
+  // extending by the signedness of from is already done, see wrap
+  return wrap(static_cast<uint64_t>(value), to_value);
+}
+
+// an integer or an array of integers
+struct Object {
+  int64_t scalar = 0;
+  std::vector<int64_t> elements;
+};
+
+// Runs functions of the program on their own locals. Every evaluation
+// returns nullopt (or GIVE_UP) once it meets something it does not model or
+// runs out of steps, memory or depth, and the whole call is given up.
+class Interpreter {
+ public:
+  Interpreter(const Functions& functions, const ConstEvalLimits& limits)
+      : functions_(functions), limits_(limits) {}
+
+  // the integer function returns for args, within fresh limits
+  std::optional<int64_t> run(const ast::Function& function,
+                             const std::vector<int64_t>& args) {
+    steps_ = 0;
+    memory_ = 0;
+    depth_ = 0;
+    std::vector<Object> objects(args.size());
+    for (size_t i = 0; i < args.size(); i++) {
+      objects[i].scalar = args[i];
+    }
+    std::optional<Object> result = invoke(function, std::move(objects));
+    if (!result || !function.type->isInt()) {
+      return std::nullopt;
+    }
+    return result->scalar;
+  }
+
+ private:
+  enum class Flow { NEXT, RETURN, GIVE_UP };
+  struct Frame {
+    std::vector<Object> slots;  // by Variable::index
+    Object result;
+  };
+
+  std::optional<Object> invoke(const ast::Function& function,
+                               std::vector<Object> args);
+
+  Flow exec(const ast::Instruction& inst, Frame& frame);
+  Flow execNode(const ast::InstructionReturn& ret, Frame& frame);
+  Flow execNode(const ast::InstructionAssignment& assign, Frame& frame);
+  Flow execNode(const ast::InstructionFunctionCall& call, Frame& frame);
+  Flow execNode(const ast::InstructionWhileLoop& loop, Frame& frame);
+  Flow execNode(const ast::InstructionIfStatement& if_stmt, Frame& frame);
+  Flow execNode(const ast::InstructionBreak& brk, Frame& frame);
+  Flow execNode(const ast::InstructionContinue& cont, Frame& frame);
+  Flow execNode(const ast::InstructionDecl& decl, Frame& frame);
+  Flow execNode(const ast::Scope& scope, Frame& frame);
+
+  // the value of an integer expression, in its own type
+  std::optional<int64_t> eval(const ast::Value& value, Frame& frame);
+  std::optional<int64_t> evalNode(const ast::Variable& var, Frame& frame);
+  std::optional<int64_t> evalNode(const ast::Integer& num, Frame& frame);
+  std::optional<int64_t> evalNode(const ast::Float& num, Frame& frame);
+  std::optional<int64_t> evalNode(const ast::FunctionName& func_name,
+                                  Frame& frame);
+  std::optional<int64_t> evalNode(const ast::BinaryOperation& bin_op,
+                                  Frame& frame);
+  std::optional<int64_t> evalNode(const ast::FunctionCall& call, Frame& frame);
+  std::optional<int64_t> evalNode(const ast::ArrayAccess& access,
+                                  Frame& frame);
+  std::optional<int64_t> evalNode(const ast::ArrayAllocate& alloc,
+                                  Frame& frame);
+  std::optional<int64_t> evalNode(const ast::ArrayLength& length,
+                                  Frame& frame);
+
+  std::optional<int64_t> evalConverted(const ast::Value& value,
+                                       const VarType& to, Frame& frame);
+  // the value is true when it is not zero
+  std::optional<bool> evalCondition(const ast::Value& value, Frame& frame);
+  // the elements of an array expression, copied
+  std::optional<std::vector<int64_t>> evalArray(const ast::Value& value,
+                                                Frame& frame);
+  std::optional<Object> evalCall(const ast::FunctionCall& call, Frame& frame);
+  // the element an access names, nullptr if it is out of bounds
+  int64_t* element(const ast::ArrayAccess& access, Frame& frame);
+
+  // counts one step, false once the limit is reached
+  bool step() { return ++steps_ <= limits_.steps; }
+
+  const Functions& functions_;
+  const ConstEvalLimits& limits_;
+  uint64_t steps_ = 0;
+  uint64_t memory_ = 0;
+  uint32_t depth_ = 0;
+};
+
+std::optional<Object> Interpreter::invoke(const ast::Function& function,
+                                          std::vector<Object> args) {
+  const VarType& ret = *function.type;
+  if (function.scope == nullptr || depth_ >= limits_.depth ||
+      args.size() != function.args.size() ||
+      !(ret.isVoid() || ret.isInt() || isIntArray(ret))) {
+    return std::nullopt;
+  }
+  // every local lives for the whole call, only integers and arrays of them
+  uint64_t bytes = 0;
+  for (const auto& [name, var] : function.variables) {
+    if (var->type == nullptr ||
+        !(var->type->isInt() || isIntArray(*var->type))) {
+      return std::nullopt;
+    }
+    bytes += var->type->getObjectSize();
+  }
+  if (bytes > limits_.memory - std::min(memory_, limits_.memory)) {
+    return std::nullopt;
+  }
+
+  Frame frame;
+  frame.slots.resize(function.variables.size());
+  for (const auto& [name, var] : function.variables) {
+    if (var->type->isArray()) {
+      frame.slots[var->index].elements.assign(flatSize(*var->type), 0);
+    }
+  }
+  for (size_t i = 0; i < args.size(); i++) {
+    const auto* param = ast::cast<ast::Variable>(function.args[i]);
+    Object& slot = frame.slots[param->index];
+    if (slot.elements.size() != args[i].elements.size()) {
+      return std::nullopt;
+    }
+    slot = std::move(args[i]);
+  }
+
+  memory_ += bytes;
+  depth_++;
+  Flow flow = exec(*function.scope, frame);
+  depth_--;
+  memory_ -= bytes;
+  // a function that returns a value and ends without return has no result
+  if (flow == Flow::GIVE_UP || (flow == Flow::NEXT && !ret.isVoid())) {
+    return std::nullopt;
+  }
+  return std::move(frame.result);
+}
+
+Interpreter::Flow Interpreter::exec(const ast::Instruction& inst,
+                                    Frame& frame) {
+  if (!step()) {
+    return Flow::GIVE_UP;
+  }
+  return ast::visit(inst, [&](const auto& node) {
+    return execNode(node, frame);
+  });
+}
+
+Interpreter::Flow Interpreter::execNode(const ast::InstructionReturn& ret,
+                                        Frame& frame) {
+  if (ret.val == nullptr) {
+    return Flow::RETURN;
+  }
+  // ret.type is the function's return type
+  if (isIntArray(*ret.type)) {
+    std::optional<std::vector<int64_t>> elements = evalArray(*ret.val, frame);
+    if (!elements) {
+      return Flow::GIVE_UP;
+    }
+    frame.result.elements = std::move(*elements);
+    return Flow::RETURN;
+  }
+  std::optional<int64_t> value = evalConverted(*ret.val, *ret.type, frame);
+  if (!value) {
+    return Flow::GIVE_UP;
+  }
+  frame.result.scalar = *value;
+  return Flow::RETURN;
+}
+
+Interpreter::Flow Interpreter::execNode(
+    const ast::InstructionAssignment& assign, Frame& frame) {
+  if (const auto* access = ast::dyn_cast<ast::ArrayAccess>(assign.dst)) {
+    std::optional<int64_t> value =
+        evalConverted(*assign.src, *access->type, frame);
+    int64_t* dst = value ? element(*access, frame) : nullptr;
+    if (dst == nullptr) {
+      return Flow::GIVE_UP;
+    }
+    *dst = *value;
+    return Flow::NEXT;
+  }
+  const auto* var = ast::dyn_cast<ast::Variable>(assign.dst);
+  if (var == nullptr) {
+    return Flow::GIVE_UP;
+  }
+  Object& slot = frame.slots[var->index];
+  if (var->type->isArray()) {
+    std::optional<std::vector<int64_t>> elements = evalArray(*assign.src, frame);
+    if (!elements || elements->size() != slot.elements.size()) {
+      return Flow::GIVE_UP;
+    }
+    slot.elements = std::move(*elements);
+    return Flow::NEXT;
+  }
+  std::optional<int64_t> value = evalConverted(*assign.src, *var->type, frame);
+  if (!value) {
+    return Flow::GIVE_UP;
+  }
+  slot.scalar = *value;
+  return Flow::NEXT;
+}
+
+Interpreter::Flow Interpreter::execNode(
+    const ast::InstructionFunctionCall& call, Frame& frame) {
+  const auto* function_call =
+      ast::dyn_cast<ast::FunctionCall>(call.function_call);
+  if (function_call == nullptr || !evalCall(*function_call, frame)) {
+    return Flow::GIVE_UP;
+  }
+  return Flow::NEXT;
+}
+
+Interpreter::Flow Interpreter::execNode(const ast::InstructionWhileLoop& loop,
+                                        Frame& frame) {
+  while (true) {
+    std::optional<bool> cond = evalCondition(*loop.cond, frame);
+    if (!cond) {
+      return Flow::GIVE_UP;
+    }
+    if (!*cond) {
+      return Flow::NEXT;
+    }
+    Flow flow = exec(*loop.body, frame);
+    if (flow != Flow::NEXT) {
+      return flow;
+    }
+  }
+}
+
+Interpreter::Flow Interpreter::execNode(
+    const ast::InstructionIfStatement& if_stmt, Frame& frame) {
+  std::optional<bool> cond = evalCondition(*if_stmt.cond, frame);
+  if (!cond) {
+    return Flow::GIVE_UP;
+  }
+  return *cond ? exec(*if_stmt.true_scope, frame) : Flow::NEXT;
+}
+
+Interpreter::Flow Interpreter::execNode(const ast::InstructionBreak&,
+                                        Frame&) {
+  return Flow::GIVE_UP;
+}
+
+Interpreter::Flow Interpreter::execNode(const ast::InstructionContinue&,
+                                        Frame&) {
+  return Flow::GIVE_UP;
+}
+
+Interpreter::Flow Interpreter::execNode(const ast::InstructionDecl& decl,
+                                        Frame& frame) {
+  // integers start at zero every time their declaration runs, like the
+  // store codegen emits there. Arrays are left uninitialized, so zero is as
+  // good as anything.
+  for (const auto& value : decl.variables) {
+    Object& slot = frame.slots[ast::cast<ast::Variable>(value)->index];
+    slot.scalar = 0;
+    std::fill(slot.elements.begin(), slot.elements.end(), 0);
+  }
+  return Flow::NEXT;
+}
+
+Interpreter::Flow Interpreter::execNode(const ast::Scope& scope,
+                                        Frame& frame) {
+  for (const auto& inst : scope.instructions) {
+    Flow flow = exec(*inst, frame);
+    if (flow != Flow::NEXT) {
+      return flow;
+    }
+  }
+  return Flow::NEXT;
+}
+
+std::optional<int64_t> Interpreter::eval(const ast::Value& value,
+                                         Frame& frame) {
+  if (!step()) {
+    return std::nullopt;
+  }
+  return ast::visit(value, [&](const auto& node) {
+    return evalNode(node, frame);
+  });
+}
+
+std::optional<int64_t> Interpreter::evalNode(const ast::Variable& var,
+                                             Frame& frame) {
+  if (!var.type->isInt()) {
+    return std::nullopt;
+  }
+  return frame.slots[var.index].scalar;
+}
+
+std::optional<int64_t> Interpreter::evalNode(const ast::Integer& num,
+                                             Frame&) {
+  return num.value;
+}
+
+std::optional<int64_t> Interpreter::evalNode(const ast::Float&, Frame&) {
+  return std::nullopt;
+}
+
+std::optional<int64_t> Interpreter::evalNode(const ast::FunctionName&,
+                                             Frame&) {
+  return std::nullopt;
+}
+
+// the operations of IRValueGen on the operands converted to operand_type,
+// so they wrap at its width and compare by its signedness
+std::optional<int64_t> Interpreter::evalNode(const ast::BinaryOperation& bin_op,
+                                             Frame& frame) {
+  const VarType& type = *bin_op.operand_type;
+  std::optional<int64_t> lhs = evalConverted(*bin_op.lhs, type, frame);
+  std::optional<int64_t> rhs =
+      lhs ? evalConverted(*bin_op.rhs, type, frame) : std::nullopt;
+  if (!rhs) {
+    return std::nullopt;
+  }
+  uint64_t l = unsignedBits(*lhs, type);
+  uint64_t r = unsignedBits(*rhs, type);
+  bool is_signed = type.isSigned();
+  switch (bin_op.op) {
+    case ast::BinOpId::ADD:
+      return wrap(l + r, type);
+    case ast::BinOpId::SUB:
+      return wrap(l - r, type);
+    case ast::BinOpId::MUL:
+      return wrap(l * r, type);
+    case ast::BinOpId::AND:
+      return wrap(l & r, type);
+    case ast::BinOpId::SHL:
+    case ast::BinOpId::SHR:
+      // the generated shift is poison for these
+      if (r >= static_cast<uint64_t>(type.getIntBits())) {
+        return std::nullopt;
+      }
+      // >> is a logical shift for signed types too
+      return wrap(bin_op.op == ast::BinOpId::SHL ? l << r : l >> r, type);
+    case ast::BinOpId::LT:
+      return is_signed ? *lhs < *rhs : l < r;
+    case ast::BinOpId::GT:
+      return is_signed ? *lhs > *rhs : l > r;
+    case ast::BinOpId::LEQ:
+      return is_signed ? *lhs <= *rhs : l <= r;
+    case ast::BinOpId::GEQ:
+      return is_signed ? *lhs >= *rhs : l >= r;
+    case ast::BinOpId::EQ:
+      return l == r;
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<int64_t> Interpreter::evalNode(const ast::FunctionCall& call,
+                                             Frame& frame) {
+  if (!call.type->isInt()) {
+    return std::nullopt;
+  }
+  std::optional<Object> result = evalCall(call, frame);
+  if (!result) {
+    return std::nullopt;
+  }
+  return result->scalar;
+}
+
+std::optional<int64_t> Interpreter::evalNode(const ast::ArrayAccess& access,
+                                             Frame& frame) {
+  const int64_t* elem = element(access, frame);
+  if (elem == nullptr) {
+    return std::nullopt;
+  }
+  return *elem;
+}
+
+std::optional<int64_t> Interpreter::evalNode(const ast::ArrayAllocate&,
+                                             Frame&) {
+  return std::nullopt;
+}
+
+std::optional<int64_t> Interpreter::evalNode(const ast::ArrayLength& length,
+                                             Frame&) {
+  // like codegen, the length of an array is its size and the array is not
+  // evaluated, slices are never locals here
+  const VarType& array_type = valueType(*length.array->type);
+  if (!array_type.isArray()) {
+    return std::nullopt;
+  }
+  return array_type.getArraySize();
+}
+
+std::optional<int64_t> Interpreter::evalConverted(const ast::Value& value,
+                                                  const VarType& to,
+                                                  Frame& frame) {
+  std::optional<int64_t> result = eval(value, frame);
+  if (!result) {
+    return std::nullopt;
+  }
+  return convert(*result, *value.type, to);
+}
+
+std::optional<bool> Interpreter::evalCondition(const ast::Value& value,
+                                               Frame& frame) {
+  std::optional<int64_t> result = eval(value, frame);
+  if (!result) {
+    return std::nullopt;
+  }
+  return *result != 0;
+}
+
+std::optional<std::vector<int64_t>> Interpreter::evalArray(
+    const ast::Value& value, Frame& frame) {
+  if (!step() || !isIntArray(*value.type)) {
+    return std::nullopt;
+  }
+  if (const auto* var = ast::dyn_cast<ast::Variable>(&value)) {
+    return frame.slots[var->index].elements;
+  }
+  if (const auto* call = ast::dyn_cast<ast::FunctionCall>(&value)) {
+    std::optional<Object> result = evalCall(*call, frame);
+    if (!result) {
+      return std::nullopt;
+    }
+    return std::move(result->elements);
+  }
+  if (const auto* alloc = ast::dyn_cast<ast::ArrayAllocate>(&value)) {
+    if (!value.type->getElemType()->isInt()) {
+      return std::nullopt;
+    }
+    // a temporary, it only has to fit next to the locals
+    if (static_cast<uint64_t>(value.type->getObjectSize()) >
+        limits_.memory - std::min(memory_, limits_.memory)) {
+      return std::nullopt;
+    }
+    std::optional<int64_t> elem = eval(*alloc->elem_value, frame);
+    if (!elem) {
+      return std::nullopt;
+    }
+    return std::vector<int64_t>(value.type->getArraySize(), *elem);
+  }
+  return std::nullopt;
+}
+
+std::optional<Object> Interpreter::evalCall(const ast::FunctionCall& call,
+                                            Frame& frame) {
+  const auto* name = ast::dyn_cast<ast::FunctionName>(call.function);
+  auto callee = name != nullptr ? functions_.find(name->name)
+                                : functions_.end();
+  if (callee == functions_.end() ||
+      call.args.size() != call.arg_types.size()) {
+    return std::nullopt;
+  }
+  // arguments are passed by value, the callee cannot change the caller
+  std::vector<Object> args(call.args.size());
+  for (size_t i = 0; i < call.args.size(); i++) {
+    const VarType& expected = *call.arg_types[i];
+    if (expected.isInt()) {
+      std::optional<int64_t> value =
+          evalConverted(*call.args[i], expected, frame);
+      if (!value) {
+        return std::nullopt;
+      }
+      args[i].scalar = *value;
+    } else if (isIntArray(expected)) {
+      std::optional<std::vector<int64_t>> elements =
+          evalArray(*call.args[i], frame);
+      if (!elements) {
+        return std::nullopt;
+      }
+      args[i].elements = std::move(*elements);
+    } else {
+      return std::nullopt;
+    }
+  }
+  return invoke(*callee->second, std::move(args));
+}
+
+int64_t* Interpreter::element(const ast::ArrayAccess& access, Frame& frame) {
+  const auto* var = ast::dyn_cast<ast::Variable>(access.var);
+  if (var == nullptr || !isIntArray(*var->type)) {
+    return nullptr;
+  }
+  // every dimension is bounds checked on its own, as the generated code
+  // would be undefined for an index past its dimension
+  const VarType* type = var->type.get();
+  uint64_t offset = 0;
+  for (const auto& index_value : access.indices) {
+    std::optional<int64_t> index = eval(*index_value, frame);
+    if (!index || *index < 0 || *index >= type->getArraySize()) {
+      return nullptr;
+    }
+    offset = offset * type->getArraySize() + *index;
+    type = type->getElemType().get();
+  }
+  // a whole subarray is not an integer
+  if (!type->isInt()) {
+    return nullptr;
+  }
+  return &frame.slots[var->index].elements[offset];
+}
+
+// Walks a program and replaces the calls the interpreter can evaluate.
+class Folder {
+ public:
+  Folder(Program& program, const ConstEvalLimits& limits)
+      : program_(program), interpreter_(functions_, limits) {
+    for (const ast::Function* function : program.functions) {
+      functions_.emplace(function->name, function);
+    }
+  }
+
+  ConstEvalStats run() {
+    for (const ast::Function* function : program_.functions) {
+      if (function->scope != nullptr) {
+        foldInst(function->scope);
+      }
+    }
+    return stats_;
+  }
+
+ private:
+  // folds the calls inside value, returns the node that replaces it
+  ast::ConstValuePtr fold(ast::ConstValuePtr value);
+  void foldInst(ast::ConstInstrPtr inst);
+  ast::ConstValuePtr foldCall(ast::FunctionCall& call);
+
+  Program& program_;
+  Functions functions_;
+  Interpreter interpreter_;
+  // by callee and converted arguments, nullopt where the interpreter gave up
+  std::map<std::pair<const ast::Function*, std::vector<int64_t>>,
+           std::optional<int64_t>>
+      results_;
+  ConstEvalStats stats_;
+};
+
+// The tree only links nodes through const pointers, but every node is
+// non-const in the arena of the program handed over.
+ast::ConstValuePtr Folder::fold(ast::ConstValuePtr value) {
+  auto* node = const_cast<ast::Value*>(value);
+  if (auto* bin_op = ast::dyn_cast<ast::BinaryOperation>(node)) {
+    bin_op->lhs = fold(bin_op->lhs);
+    bin_op->rhs = fold(bin_op->rhs);
+  } else if (auto* access = ast::dyn_cast<ast::ArrayAccess>(node)) {
+    for (auto& index : access->indices) {
+      index = fold(index);
+    }
+  } else if (auto* call = ast::dyn_cast<ast::FunctionCall>(node)) {
+    for (auto& arg : call->args) {
+      arg = fold(arg);
+    }
+    return foldCall(*call);
+  } else if (auto* alloc = ast::dyn_cast<ast::ArrayAllocate>(node)) {
+    // the length is always a literal
+    alloc->elem_value = fold(alloc->elem_value);
+  } else if (auto* length = ast::dyn_cast<ast::ArrayLength>(node)) {
+    // an array or a slice is never replaced by a literal, only the calls in
+    // its arguments are folded
+    fold(length->array);
+  }
+  return value;
+}
+
+void Folder::foldInst(ast::ConstInstrPtr inst) {
+  auto* node = const_cast<ast::Instruction*>(inst);
+  if (auto* ret = ast::dyn_cast<ast::InstructionReturn>(node)) {
+    if (ret->val != nullptr) {
+      ret->val = fold(ret->val);
+    }
+  } else if (auto* assign = ast::dyn_cast<ast::InstructionAssignment>(node)) {
+    assign->src = fold(assign->src);
+    assign->dst = fold(assign->dst);
+  } else if (auto* call = ast::dyn_cast<ast::InstructionFunctionCall>(node)) {
+    // a call whose result is dropped stays, only its arguments are folded
+    if (auto* function_call = ast::dyn_cast<ast::FunctionCall>(
+            const_cast<ast::Value*>(call->function_call))) {
+      for (auto& arg : function_call->args) {
+        arg = fold(arg);
+      }
+    }
+  } else if (auto* loop = ast::dyn_cast<ast::InstructionWhileLoop>(node)) {
+    loop->cond = fold(loop->cond);
+    foldInst(loop->body);
+  } else if (auto* if_stmt = ast::dyn_cast<ast::InstructionIfStatement>(node)) {
+    if_stmt->cond = fold(if_stmt->cond);
+    foldInst(if_stmt->true_scope);
+  } else if (auto* scope = ast::dyn_cast<ast::Scope>(node)) {
+    for (const auto& child : scope->instructions) {
+      foldInst(child);
+    }
+  }
+}
+
+ast::ConstValuePtr Folder::foldCall(ast::FunctionCall& call) {
+  const auto* name = ast::dyn_cast<ast::FunctionName>(call.function);
+  auto callee = name != nullptr ? functions_.find(name->name)
+                                : functions_.end();
+  if (callee == functions_.end() || !call.type->isInt() ||
+      call.args.size() != call.arg_types.size()) {
+    return &call;
+  }
+  std::vector<int64_t> args;
+  for (size_t i = 0; i < call.args.size(); i++) {
+    const auto* literal = ast::dyn_cast<ast::Integer>(call.args[i]);
+    const VarType& expected = *call.arg_types[i];
+    if (literal == nullptr || expected.isRef()) {
+      return &call;
+    }
+    std::optional<int64_t> arg = convert(literal->value, *literal->type,
+                                         expected);
+    if (!arg) {
+      return &call;
+    }
+    args.push_back(*arg);
+  }
+
+  auto [result, inserted] =
+      results_.try_emplace(std::make_pair(callee->second, args));
+  if (inserted) {
+    result->second = interpreter_.run(*callee->second, args);
+  }
+  if (!result->second) {
+    stats_.gave_up++;
+    return &call;
+  }
+  stats_.folded++;
+  // the call's type, so the conversions around it stay the same
+  auto* folded = program_.arena->make<ast::Integer>(*result->second, call.type);
+  folded->line = call.line;
+  return folded;
+}
+}  // namespace
+
+ConstEvalStats evaluateConstCalls(Program& program,
+                                  const ConstEvalLimits& limits) {
+  return Folder(program, limits).run();
+}
+
+}  // namespace frontend
@@ -28,12 +28,12 @@ void DumpAST::dump_function(const ast::Function& function) {
 
 void DumpAST::dump_instruction(const ast::Instruction& instruction) {
   stream_ << prefix_;
-  instruction.accept(this);
+  ast::visit(instruction, [this](const auto& node) { visit(&node); });
 }
 
 void DumpAST::dump_value(const ast::Value& value) {
   stream_ << prefix_;
-  value.accept(this);
+  ast::visit(value, [this](const auto& node) { visit(&node); });
 }
 
 void DumpAST::visit(const ast::Variable* var) {
@@ -42,6 +42,9 @@ void DumpAST::visit(const ast::Variable* var) {
 void DumpAST::visit(const ast::Integer* num) {
   stream_ << num->value << " " << num->type->getTypeName();
 }
+void DumpAST::visit(const ast::Float* num) {
+  stream_ << num->value << " " << num->type->getTypeName();
+}
 void DumpAST::visit(const ast::FunctionName* func_name) {
   stream_ << func_name->return_type->getTypeName() << " " << func_name->name;
 }
@@ -70,7 +73,9 @@ void DumpAST::visit(const ast::ArrayAccess* access) {
   std::string saved_prefix = prefix_;
   prefix_ += " |";
   dump_value(*access->var);
-  dump_value(*access->indices.back());
+  for (const auto& index : access->indices) {
+    dump_value(*index);
+  }
   prefix_ = saved_prefix;
 }
 void DumpAST::visit(const ast::ArrayAllocate* alloc) {
@@ -81,6 +86,13 @@ void DumpAST::visit(const ast::ArrayAllocate* alloc) {
   dump_value(*alloc->elem_value);
   prefix_ = saved_prefix;
 }
+void DumpAST::visit(const ast::ArrayLength* length) {
+  stream_ << "array length" << " type: " << length->type->getTypeName();
+  std::string saved_prefix = prefix_;
+  prefix_ += " |";
+  dump_value(*length->array);
+  prefix_ = saved_prefix;
+}
 
 // ========== Instructions ==========
 void DumpAST::visit(const ast::InstructionReturn* ret) {
@@ -155,5 +167,6 @@ void DumpAST::visit(const ast::Scope* scope) {
   prefix_ = saved_prefix;
 }
 DumpAST::DumpAST() : stream_(std::cout) {}
+DumpAST::DumpAST(std::ostream& stream) : stream_(stream) {}
 
 }  // namespace frontend
@@ -1,13 +1,13 @@
 #include "frontend/visitor/IRInstructionGen.h"
 
 #include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Value.h>
 
-#include <map>
 #include <vector>
 
 #include <llvm/IR/Metadata.h>
@@ -15,17 +15,24 @@
 #include "frontend/diagnostic/debug.h"
 
 namespace frontend {
-IRInstructionGen::IRInstructionGen(
-    llvm::IRBuilder<>& builder, llvm::LLVMContext& context,
-    llvm::Module& module, std::map<const ast::Variable*, llvm::Value*>& vars)
+IRInstructionGen::IRInstructionGen(llvm::IRBuilder<>& builder,
+                                   llvm::LLVMContext& context,
+                                   llvm::Module& module, VariableSlots& vars,
+                                   llvm::DISubprogram* subprogram)
     : builder_(builder),
       context_(context),
       module_(module),
       allocated_variables_(vars),
-      value_gen_(builder_, context_, module_, vars) {}
+      value_gen_(builder_, context_, module_, vars),
+      subprogram_(subprogram) {}
 
 llvm::Value* IRInstructionGen::get(const ast::Instruction& i) {
-  i.accept(this);
+  // the location stays until an instruction on another line, scopes have none
+  if (subprogram_ != nullptr && i.line != 0) {
+    builder_.SetCurrentDebugLocation(
+        llvm::DILocation::get(context_, i.line, 0, subprogram_));
+  }
+  ast::visit(i, [this](const auto& node) { visit(&node); });
   return nullptr;
 }
 
@@ -36,15 +43,16 @@ void IRInstructionGen::visit(const ast::InstructionReturn* r) {
       llvm::Function* llvm_function = builder_.GetInsertBlock()->getParent();
       llvm::Argument* ret_arg = llvm_function->getArg(
           static_cast<unsigned int>(llvm_function->arg_size() - 1));
-      builder_.CreateMemCpy(ret_arg, llvm::MaybeAlign(),
-                            value_gen_.get_loaded_val(r->val.get()),
-                            llvm::MaybeAlign(), r->val->type->getObjectSize());
+      llvm::Align align(r->val->type->getAlignment());
+      builder_.CreateMemCpy(ret_arg, align, value_gen_.get_loaded_val(r->val),
+                            align, r->val->type->getObjectSize());
       builder_.CreateRet(ret_arg);
       //    } else if (r->val->type->is_ref()) {
       //      // no need to load
-      //      builder_.CreateRet(value_gen_.get_val(r->val.get()));
+      //      builder_.CreateRet(value_gen_.get_val(r->val));
     } else {
-      builder_.CreateRet(value_gen_.get_loaded_val(r->val.get()));
+      // r->type is the function's return type
+      builder_.CreateRet(value_gen_.get_converted_val(r->val, *r->type));
     }
   } else {
     builder_.CreateRetVoid();
@@ -52,26 +60,31 @@ void IRInstructionGen::visit(const ast::InstructionReturn* r) {
 }
 
 void IRInstructionGen::visit(const ast::InstructionAssignment* a) {
-  llvm::Value* llvm_src = value_gen_.get_loaded_val(a->src.get());
-  llvm::Value* llvm_dst = value_gen_.get_val(a->dst.get());
-
   const ConstVarTypePtr& src_type = a->src->type;
   const ConstVarTypePtr& dst_type = a->dst->type;
 
+  // an integer is stored as the integer type of the destination
+  llvm::Value* llvm_src = value_gen_.get_converted_val(a->src, *dst_type);
+  llvm::Value* llvm_dst = value_gen_.get_val(a->dst);
+
   bool prim_to_prim = src_type->isPrimitive() && src_type->isPrimitive();
   bool ref_to_prim = src_type->isRef() && dst_type->isPrimitive();
   bool stack_to_stack = src_type->isStack() && dst_type->isStack();
   bool stack_to_ref = src_type->isStack() && dst_type->isRef();
   bool ref_to_stack = src_type->isRef() && dst_type->isStack();
   bool ref_to_ref = src_type->isRef() && dst_type->isRef();
+  // the source was converted to the (pointer, length) pair
+  bool to_slice = dst_type->isSlice();
 
-  if (prim_to_prim || ref_to_prim) {
+  if (prim_to_prim || ref_to_prim || to_slice) {
     // just store
     builder_.CreateStore(llvm_src, llvm_dst);
   } else if (ref_to_stack || stack_to_stack) {
-    // need to "copy construct" aka just memcpy currently
-    builder_.CreateMemCpy(llvm_dst, llvm::MaybeAlign(), llvm_src,
-                          llvm::MaybeAlign(), src_type->getObjectSize(), false);
+    // need to "copy construct" aka just memcpy currently, the destination is
+    // the object when the source is a reference to one
+    llvm::Align align(dst_type->getAlignment());
+    builder_.CreateMemCpy(llvm_dst, align, llvm_src, align,
+                          dst_type->getObjectSize(), false);
   } else if (stack_to_ref || ref_to_ref) {
     // store pointer into ref stack loc
     builder_.CreateStore(llvm_src, llvm_dst);
@@ -80,7 +93,7 @@ void IRInstructionGen::visit(const ast::InstructionAssignment* a) {
   }
 }
 void IRInstructionGen::visit(const ast::InstructionFunctionCall* f) {
-  value_gen_.get_loaded_val(f->function_call.get());
+  value_gen_.get_loaded_val(f->function_call);
 }
 void IRInstructionGen::visit(const ast::InstructionWhileLoop* w) {
   llvm::Function* the_function = builder_.GetInsertBlock()->getParent();
@@ -94,14 +107,14 @@ void IRInstructionGen::visit(const ast::InstructionWhileLoop* w) {
   builder_.CreateBr(cond_block);
   builder_.SetInsertPoint(cond_block);
   // evaluate expression and compare to 0
-  llvm::Value* cond = value_gen_.get_loaded_val(w->cond.get());
+  llvm::Value* cond = value_gen_.get_condition_val(w->cond);
   // branch to body or continue
   builder_.CreateCondBr(cond, body_block, continue_block);
 
   // add body to body_block
   the_function->getBasicBlockList().insert(the_function->end(), body_block);
   builder_.SetInsertPoint(body_block);
-  w->body->accept(this);
+  get(*w->body);
 
   // add branch to cond_block
   builder_.CreateBr(cond_block);
@@ -112,7 +125,7 @@ void IRInstructionGen::visit(const ast::InstructionWhileLoop* w) {
 }
 void IRInstructionGen::visit(const ast::InstructionIfStatement* f) {
   // evaluate expression and compare to 0
-  llvm::Value* cond = value_gen_.get_loaded_val(f->cond.get());
+  llvm::Value* cond = value_gen_.get_condition_val(f->cond);
   llvm::Function* the_function = builder_.GetInsertBlock()->getParent();
   llvm::BasicBlock* true_block =
       llvm::BasicBlock::Create(context_, "true-block", the_function);
@@ -123,7 +136,7 @@ void IRInstructionGen::visit(const ast::InstructionIfStatement* f) {
 
   // true block
   builder_.SetInsertPoint(true_block);
-  f->true_scope->accept(this);
+  get(*f->true_scope);
   builder_.CreateBr(continue_block);
 
   // continue block
@@ -140,13 +153,13 @@ void IRInstructionGen::visit(const ast::InstructionDecl* v) {
   //// allocate in entry for var and add var to allocated_variables_
   std::vector<llvm::Value*> llvm_var(v->variables.size());
   for (int i = 0; i < v->variables.size(); i++) {
-    llvm_var[i] = value_gen_.get_val(v->variables[i].get());
+    llvm_var[i] = value_gen_.get_val(v->variables[i]);
   }
 }
 
 void IRInstructionGen::visit(const ast::Scope* s) {
   for (const ast::ConstInstrPtr& i : s->instructions) {
-    i->accept(this);
+    get(*i);
   }
 }
 }  // namespace frontend
@@ -9,7 +9,6 @@
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
 
-#include <map>
 #include <vector>
 
 #include "frontend/ast/ast.h"
@@ -19,15 +18,14 @@
 namespace frontend {
 namespace {
 int64_t get_value_of_integer(const ast::Value* val) {
-  const auto* i = dynamic_cast<const ast::Integer*>(val);
-  ASSERT(i != nullptr, "expected Integer but didnt receive one");
-  return i->value;
+  ASSERT(ast::isa<ast::Integer>(val), "expected Integer but didnt receive one");
+  return ast::cast<ast::Integer>(val)->value;
 }
 }  // namespace
 
 IRValueGen::IRValueGen(llvm::IRBuilder<>& builder, llvm::LLVMContext& context,
                        llvm::Module& module,
-                       std::map<const ast::Variable*, llvm::Value*>& vars)
+                       VariableSlots& vars)
     : builder_(builder), context_(context), module_(module), vars_(vars) {}
 
 llvm::Value* IRValueGen::get_loaded_val(const ast::Value* value) {
@@ -35,7 +33,7 @@ llvm::Value* IRValueGen::get_loaded_val(const ast::Value* value) {
   const VarType& value_type = *value->type;
   if (value_type.isPrValue()) {
     return llvm_val;  // already in virtual register
-  } else if (value_type.isInt() && !value_type.isPrValue()) {
+  } else if (value_type.isNumeric() || value_type.isSlice()) {
     return builder_.CreateLoad(value_type.getLlvmInRegType(context_), llvm_val);
   } else if (value_type.isArray() || value_type.isStruct()) {
     return llvm_val;
@@ -47,10 +45,84 @@ llvm::Value* IRValueGen::get_loaded_val(const ast::Value* value) {
   FRONTEND_ERROR("no matching type found for load");
 }
 
+llvm::Value* IRValueGen::get_converted_val(const ast::Value* value,
+                                           const VarType& to) {
+  return convert(get_loaded_val(value), *value->type, to);
+}
+
+llvm::Value* IRValueGen::get_condition_val(const ast::Value* value) {
+  llvm::Value* cond = get_loaded_val(value);
+  if (cond->getType()->isIntegerTy(1)) {
+    return cond;
+  }
+  return compare_with_zero(cond);
+}
+
+llvm::Value* IRValueGen::compare_with_zero(llvm::Value* value) {
+  llvm::Constant* zero = llvm::Constant::getNullValue(value->getType());
+  if (value->getType()->isFloatingPointTy()) {
+    // NaN is not zero either
+    return builder_.CreateFCmpUNE(value, zero);
+  }
+  return builder_.CreateICmpNE(value, zero);
+}
+
+llvm::Value* IRValueGen::get_index_val(const ast::Value* index) {
+  const VarType& type = index->type->isRef()
+                            ? *index->type->getReferencedType()
+                            : *index->type;
+  return builder_.CreateIntCast(get_loaded_val(index), builder_.getInt64Ty(),
+                                type.isSigned());
+}
+
+llvm::Value* IRValueGen::convert(llvm::Value* value, const VarType& from,
+                                 const VarType& to) {
+  const VarType& from_value = from.isRef() ? *from.getReferencedType() : from;
+  const VarType& to_value = to.isRef() ? *to.getReferencedType() : to;
+  if (to_value.isSlice() && from_value.isArray()) {
+    // an array becomes a slice of all its elements
+    llvm::Value* slice =
+        llvm::PoisonValue::get(to_value.getLlvmInRegType(context_));
+    slice = builder_.CreateInsertValue(slice, value, 0);
+    return builder_.CreateInsertValue(
+        slice, builder_.getInt64(from_value.getArraySize()), 1);
+  }
+  if (!from_value.isNumeric() || !to_value.isNumeric()) {
+    return value;
+  }
+  llvm::Type* type = to_value.getLlvmInRegType(context_);
+  switch (VarType::getConversion(from_value, to_value)) {
+    case VarType::Conversion::NONE:
+      return value;
+    case VarType::Conversion::TRUNC:
+      return builder_.CreateTrunc(value, type);
+    case VarType::Conversion::SEXT:
+      return builder_.CreateSExt(value, type);
+    case VarType::Conversion::ZEXT:
+      return builder_.CreateZExt(value, type);
+    case VarType::Conversion::TO_BOOL:
+      return compare_with_zero(value);
+    case VarType::Conversion::FP_TRUNC:
+      return builder_.CreateFPTrunc(value, type);
+    case VarType::Conversion::FP_EXT:
+      return builder_.CreateFPExt(value, type);
+    case VarType::Conversion::SI_TO_FP:
+      return builder_.CreateSIToFP(value, type);
+    case VarType::Conversion::UI_TO_FP:
+      return builder_.CreateUIToFP(value, type);
+    case VarType::Conversion::FP_TO_SI:
+      return builder_.CreateFPToSI(value, type);
+    case VarType::Conversion::FP_TO_UI:
+      return builder_.CreateFPToUI(value, type);
+    default:
+      FRONTEND_ERROR("unknown conversion");
+  }
+}
+
 llvm::Value* IRValueGen::get_val(const ast::Value* value) {
   ASSERT(value_ == nullptr, "value should be null: overwriting previous value");
   value_ = nullptr;
-  value->accept(this);
+  ast::visit(*value, [this](const auto& node) { visit(&node); });
   ASSERT(value_ != nullptr, "IRValueGen: value is null");
   llvm::Value* llvm_val = value_;
   value_ = nullptr;
@@ -58,13 +130,15 @@ llvm::Value* IRValueGen::get_val(const ast::Value* value) {
 }
 
 void IRValueGen::visit(const ast::Variable* v) {
-  if (vars_.find(v) == vars_.end()) {
+  llvm::Value*& slot = vars_[v->index];
+  if (slot == nullptr) {
     // pointers to where value in var is located
     llvm::Function* f = builder_.GetInsertBlock()->getParent();
     llvm::IRBuilder<> entry_builder_tmp(&f->getEntryBlock(),
                                         f->getEntryBlock().begin());
-    llvm::Value* var = entry_builder_tmp.CreateAlloca(
-        v->type->getLlvmStackAllocTy(context_), nullptr, v->name);
+    llvm::AllocaInst* var = entry_builder_tmp.CreateAlloca(
+        v->type->getLlvmStackAllocTy(context_), nullptr, v->name.str());
+    var->setAlignment(llvm::Align(v->type->getAlignment()));
 
     if (v->type->isRef()) {
       ASSERT(v->type->get_object_size() == 8,
@@ -73,83 +147,113 @@ void IRValueGen::visit(const ast::Variable* v) {
           llvm::ConstantPointerNull::get(
               v->type->getLlvmStackAllocTy(context_)->getPointerTo(0)),
           var);
-    } else if (v->type->isInt()) {
-      ASSERT(v->type->get_object_size() == 8,
-             "Doesnt support != 8 byte primitives or refs");
+    } else if (v->type->isNumeric() || v->type->isSlice()) {
       builder_.CreateStore(
-          llvm::ConstantInt::getSigned(llvm::Type::getInt64Ty(context_), 0),
+          llvm::Constant::getNullValue(v->type->getLlvmInRegType(context_)),
           var);
     }
     //      builder_.CreateMemSet(
     //          var, llvm::ConstantInt::getSigned(llvm::Type::getInt8Ty(context_), 0),
     //          v->type->get_object_size(), llvm::MaybeAlign());
 
-    (vars_)[v] = var;
+    slot = var;
   }
-  value_ = vars_[v];
+  value_ = slot;
 }
 
 void IRValueGen::visit(const ast::Integer* n) {
   value_ = llvm::ConstantInt::getSigned(n->type->getLlvmInRegType(context_),
                                         n->value);
 }
+void IRValueGen::visit(const ast::Float* n) {
+  value_ = llvm::ConstantFP::get(n->type->getLlvmInRegType(context_), n->value);
+}
 void IRValueGen::visit(const ast::FunctionName* b) {
   NOT_IMPLEMENTED();
 }
 void IRValueGen::visit(const ast::BinaryOperation* b) {
+  // both operands have the operation's type first, comparisons follow its
+  // signedness
+  const VarType& type = *b->operand_type;
+  llvm::Value* lhs = get_converted_val(b->lhs, type);
+  llvm::Value* rhs = get_converted_val(b->rhs, type);
+  if (type.isFloat()) {
+    value_ = float_operation(b->op, lhs, rhs);
+    return;
+  }
+  bool is_signed = type.isSigned();
   switch (b->op) {
     case ast::BinOpId::ADD:
-      value_ = builder_.CreateAdd(get_loaded_val(b->lhs.get()),
-                                  get_loaded_val(b->rhs.get()));
+      value_ = builder_.CreateAdd(lhs, rhs);
       return;
     case ast::BinOpId::SUB:
-      value_ = builder_.CreateSub(get_loaded_val(b->lhs.get()),
-                                  get_loaded_val(b->rhs.get()));
+      value_ = builder_.CreateSub(lhs, rhs);
       return;
     case ast::BinOpId::MUL:
-      value_ = builder_.CreateMul(get_loaded_val(b->lhs.get()),
-                                  get_loaded_val(b->rhs.get()));
+      value_ = builder_.CreateMul(lhs, rhs);
       return;
     case ast::BinOpId::AND:
-      value_ = builder_.CreateAnd(get_loaded_val(b->lhs.get()),
-                                  get_loaded_val(b->rhs.get()));
+      value_ = builder_.CreateAnd(lhs, rhs);
       return;
     case ast::BinOpId::LT:
-      value_ = builder_.CreateICmpSLT(get_loaded_val(b->lhs.get()),
-                                      get_loaded_val(b->rhs.get()));
+      value_ = is_signed ? builder_.CreateICmpSLT(lhs, rhs)
+                         : builder_.CreateICmpULT(lhs, rhs);
       return;
     case ast::BinOpId::GT:
-      value_ = builder_.CreateICmpSGT(get_loaded_val(b->lhs.get()),
-                                      get_loaded_val(b->rhs.get()));
+      value_ = is_signed ? builder_.CreateICmpSGT(lhs, rhs)
+                         : builder_.CreateICmpUGT(lhs, rhs);
       return;
     case ast::BinOpId::EQ:
-      value_ = builder_.CreateICmpEQ(get_loaded_val(b->lhs.get()),
-                                     get_loaded_val(b->rhs.get()));
+      value_ = builder_.CreateICmpEQ(lhs, rhs);
       return;
     case ast::BinOpId::SHL:
-      value_ = builder_.CreateShl(get_loaded_val(b->lhs.get()),
-                                  get_loaded_val(b->rhs.get()));
+      value_ = builder_.CreateShl(lhs, rhs);
       return;
     case ast::BinOpId::SHR:
-      value_ = builder_.CreateLShr(get_loaded_val(b->lhs.get()),
-                                   get_loaded_val(b->rhs.get()));
+      value_ = builder_.CreateLShr(lhs, rhs);
       return;
     case ast::BinOpId::LEQ:
-      value_ = builder_.CreateICmpSLE(get_loaded_val(b->lhs.get()),
-                                      get_loaded_val(b->rhs.get()));
+      value_ = is_signed ? builder_.CreateICmpSLE(lhs, rhs)
+                         : builder_.CreateICmpULE(lhs, rhs);
       return;
     case ast::BinOpId::GEQ:
-      value_ = builder_.CreateICmpSGE(get_loaded_val(b->lhs.get()),
-                                      get_loaded_val(b->rhs.get()));
+      value_ = is_signed ? builder_.CreateICmpSGE(lhs, rhs)
+                         : builder_.CreateICmpUGE(lhs, rhs);
       return;
     default:
       ASSERT(false, "shouldnt reach");
   }
 }
 
+// comparisons are ordered, they are false if either operand is NaN
+llvm::Value* IRValueGen::float_operation(ast::BinOpId op, llvm::Value* lhs,
+                                         llvm::Value* rhs) {
+  switch (op) {
+    case ast::BinOpId::ADD:
+      return builder_.CreateFAdd(lhs, rhs);
+    case ast::BinOpId::SUB:
+      return builder_.CreateFSub(lhs, rhs);
+    case ast::BinOpId::MUL:
+      return builder_.CreateFMul(lhs, rhs);
+    case ast::BinOpId::LT:
+      return builder_.CreateFCmpOLT(lhs, rhs);
+    case ast::BinOpId::GT:
+      return builder_.CreateFCmpOGT(lhs, rhs);
+    case ast::BinOpId::EQ:
+      return builder_.CreateFCmpOEQ(lhs, rhs);
+    case ast::BinOpId::LEQ:
+      return builder_.CreateFCmpOLE(lhs, rhs);
+    case ast::BinOpId::GEQ:
+      return builder_.CreateFCmpOGE(lhs, rhs);
+    default:
+      FRONTEND_ERROR("operator " + ast::binopToString(op) +
+                     " needs integer operands");
+  }
+}
+
 void IRValueGen::visit(const ast::FunctionCall* f) {
-  const auto* b = dynamic_cast<const ast::FunctionName*>(f->function.get());
-  auto* func = module_.getFunction(b->name);
+  const auto* b = ast::cast<ast::FunctionName>(f->function);
+  auto* func = module_.getFunction(b->name.str());
   if (!func) {
     FRONTEND_ERROR("callee function not found");
   }
@@ -159,9 +263,9 @@ void IRValueGen::visit(const ast::FunctionCall* f) {
     auto& expected_type = f->arg_types[i];
     if (expected_type->isRef()) {
       // pass the reference by value, no need to load
-      args.push_back(get_val(arg.get()));
+      args.push_back(get_val(arg));
     } else {
-      args.push_back(get_loaded_val(arg.get()));
+      args.push_back(get_converted_val(arg, *expected_type));
     }
   }
   if (f->type->isArray() || f->type->isStruct()) {
@@ -169,8 +273,9 @@ void IRValueGen::visit(const ast::FunctionCall* f) {
     llvm::Function* llvm_func = builder_.GetInsertBlock()->getParent();
     llvm::IRBuilder<> entry_builder_tmp(&llvm_func->getEntryBlock(),
                                         llvm_func->getEntryBlock().begin());
-    llvm::Value* llvm_object_ptr = entry_builder_tmp.CreateAlloca(
+    llvm::AllocaInst* llvm_object_ptr = entry_builder_tmp.CreateAlloca(
         f->type->getLlvmStackAllocTy(context_), nullptr);
+    llvm_object_ptr->setAlignment(llvm::Align(f->type->getAlignment()));
     args.push_back(llvm_object_ptr);
   }
   value_ = builder_.CreateCall(static_cast<llvm::Function*>(func), args);
@@ -180,36 +285,57 @@ void IRValueGen::visit(const ast::ArrayAccess* a) {
   const VarType& array_type = variable_type.isRef()
                                   ? *variable_type.getReferencedType()
                                   : variable_type;
-  llvm::Value* base = get_loaded_val(a->var.get());
+  llvm::Value* base = get_loaded_val(a->var);
+  if (array_type.isSlice()) {
+    // the data pointer points at the first element
+    llvm::Value* data = builder_.CreateExtractValue(base, 0);
+    value_ = builder_.CreateGEP(
+        array_type.getElemType()->getLlvmStackAllocTy(context_), data,
+        get_index_val(a->indices[0]));
+    return;
+  }
 
   // calculate offset (from list of indices)
   std::vector<llvm::Value*> indices = {builder_.getInt64(0)};
   for (auto& index : a->indices) {
-    indices.push_back(get_loaded_val(index.get()));
+    indices.push_back(get_index_val(index));
   }
   value_ = builder_.CreateGEP(array_type.getLlvmStackAllocTy(context_), base,
                               indices);
 }
 
+void IRValueGen::visit(const ast::ArrayLength* l) {
+  const VarType& array_type = l->array->type->isRef()
+                                  ? *l->array->type->getReferencedType()
+                                  : *l->array->type;
+  if (array_type.isArray()) {
+    // the size is part of the type, the array is not evaluated
+    value_ = builder_.getInt64(array_type.getArraySize());
+    return;
+  }
+  value_ = builder_.CreateExtractValue(get_loaded_val(l->array), 1);
+}
+
 void IRValueGen::visit(const ast::ArrayAllocate* a) {
   llvm::Type* llvm_elem_type =
       a->type->getElemType()->getLlvmInRegType(context_);
 
-  uint64_t size = get_value_of_integer(a->length.get());
+  uint64_t size = get_value_of_integer(a->length);
 
   llvm::Function* f = builder_.GetInsertBlock()->getParent();
   llvm::Type* llvm_arr_type = llvm::ArrayType::get(llvm_elem_type, size);
 
   llvm::IRBuilder<> entry_builder_tmp(&f->getEntryBlock(),
                                       f->getEntryBlock().begin());
-  llvm::Value* llvm_array_ptr =
+  llvm::AllocaInst* llvm_array_ptr =
       entry_builder_tmp.CreateAlloca(llvm_arr_type, nullptr);
+  llvm_array_ptr->setAlignment(llvm::Align(a->type->getAlignment()));
 
   for (uint64_t i = 0; i < size; i++) {
     llvm::Value* elem_ptr =
         builder_.CreateGEP(llvm_arr_type, llvm_array_ptr,
                            {builder_.getInt64(0), builder_.getInt64(i)});
-    builder_.CreateStore(get_loaded_val(a->elem_value.get()), elem_ptr);
+    builder_.CreateStore(get_loaded_val(a->elem_value), elem_ptr);
   }
   //  builder_.CreateMemSet(
   //      llvm_array_ptr,
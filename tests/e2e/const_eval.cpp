@@ -0,0 +1,22 @@
+#include <cstdint>
+#include "Util.h"
+
+extern "C" {
+int64_t const_eval_fib20();
+int64_t const_eval_table();
+int64_t const_eval_wrapped();
+int64_t const_eval_nested();
+int64_t const_eval_filled();
+int64_t const_eval_fib30();
+int64_t const_eval_runtime(int64_t n);
+}
+
+int main() {
+  run_test(6765, const_eval_fib20(), "const_eval_fib20");
+  run_test(1240, const_eval_table(), "const_eval_table");
+  run_test(0, const_eval_wrapped(), "const_eval_wrapped");
+  run_test(30, const_eval_nested(), "const_eval_nested");
+  run_test(110, const_eval_filled(), "const_eval_filled");
+  run_test(832040, const_eval_fib30(), "const_eval_fib30");
+  run_test(55, const_eval_runtime(10), "const_eval_runtime");
+}
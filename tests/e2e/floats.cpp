@@ -0,0 +1,36 @@
+#include <cstdint>
+#include "Util.h"
+
+extern "C" {
+double floats_dot(double* a, double* b);
+float floats_half(float x);
+double floats_mix(int32_t a, uint8_t b);
+int64_t floats_trunc(double x);
+bool floats_less(float a, double b);
+int64_t floats_nonzero(double x);
+float* floats_blur(float* a, float* out);
+}
+
+int main() {
+  // exactly representable, so the sum is the same in any order
+  double a[16], b[16];
+  for (int i = 0; i < 16; i++) {
+    a[i] = i;
+    b[i] = 0.5;
+  }
+  run_test(60.0, floats_dot(a, b), "floats_dot");
+  run_test(1.5f, floats_half(3.0f), "floats_half");
+  run_test(195.5, floats_mix(-3, 200), "floats_mix");
+  run_test(-2, floats_trunc(-2.75), "floats_trunc");
+  run_test(false, floats_less(1.5f, 1.25), "floats_less");
+  run_test(true, floats_less(1.0f, 1.25), "floats_less");
+  run_test(0, floats_nonzero(0.0), "floats_nonzero");
+  run_test(1, floats_nonzero(-0.125), "floats_nonzero");
+  float in[8] = {0, 4, 8, 4, 0, 4, 8, 4};
+  float out[8];
+  floats_blur(in, out);
+  const float expected[8] = {0, 4, 6, 4, 2, 4, 6, 0};
+  for (int i = 1; i < 7; i++) {
+    run_test(expected[i], out[i], "floats_blur");
+  }
+}
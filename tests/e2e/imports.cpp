@@ -0,0 +1,18 @@
+#include <cstdint>
+#include <vector>
+#include "Util.h"
+
+extern "C" {
+int64_t shared_square(int64_t x);
+int64_t imports_sum_of_squares(int64_t a, int64_t b);
+int64_t imports_double_sum(int64_t* vec, int64_t len);
+}
+
+int main() {
+  std::vector<int64_t> array1 = {1, 2, 3, 4, 5};
+
+  run_test(49, shared_square(7), "shared_square");
+  run_test(25, imports_sum_of_squares(3, 4), "imports_sum_of_squares");
+  run_test(30, imports_double_sum(array1.data(), array1.size()),
+           "imports_double_sum");
+}
@@ -0,0 +1,19 @@
+#include <cstdint>
+#include "Util.h"
+
+extern "C" {
+uint8_t ints_add_u8(uint8_t a, uint8_t b);
+int64_t ints_widen(int8_t a);
+bool ints_less(uint32_t a, uint32_t b);
+int64_t ints_sum_bytes(uint8_t* bytes);
+}
+
+int main() {
+  run_test(44, static_cast<int>(ints_add_u8(200, 100)), "ints_add_u8 wraps");
+  run_test(-5, ints_widen(-5), "ints_widen");
+  // unsigned, so the large value is not negative
+  run_test(true, ints_less(1, 0x80000000u), "ints_less");
+  run_test(false, ints_less(0x80000000u, 1), "ints_less");
+  uint8_t bytes[8] = {255, 255, 1, 2, 3, 4, 5, 6};
+  run_test(531, ints_sum_bytes(bytes), "ints_sum_bytes");
+}
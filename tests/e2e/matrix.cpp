@@ -0,0 +1,48 @@
+#include <cstdint>
+#include "Util.h"
+
+extern "C" {
+double* matrix_mul(double* a, double* b, double* ret);
+int32_t* matrix_transpose(int32_t* a, int32_t* ret);
+int64_t matrix_cube_sum(int16_t* c);
+int64_t matrix_trace(int64_t n);
+int64_t matrix_trace_of_two();
+}
+
+int main() {
+  // row-major, the same layout as a C array of arrays
+  double a[4][4], b[4][4], c[4][4], expected[4][4] = {};
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      a[i][j] = i * 4 + j;
+      b[i][j] = i == j ? 2 : (j == 0 ? 1 : 0);
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      for (int k = 0; k < 4; k++) {
+        expected[i][j] += a[i][k] * b[k][j];
+      }
+    }
+  }
+  matrix_mul(&a[0][0], &b[0][0], &c[0][0]);
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      run_test(expected[i][j], c[i][j], "matrix_mul");
+    }
+  }
+
+  int32_t m[2][3] = {{1, 2, 3}, {4, 5, 6}};
+  int32_t t[3][2];
+  matrix_transpose(&m[0][0], &t[0][0]);
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 3; j++) {
+      run_test(m[i][j], t[j][i], "matrix_transpose");
+    }
+  }
+
+  int16_t cube[2][2][2] = {{{1, 2}, {3, 4}}, {{5, 6}, {7, 8}}};
+  run_test(5321, matrix_cube_sum(&cube[0][0][0]), "matrix_cube_sum");
+  run_test(18, matrix_trace(2), "matrix_trace");
+  run_test(18, matrix_trace_of_two(), "matrix_trace_of_two");
+}
@@ -8,6 +8,7 @@ int64_t minitest1();
 int64_t minitest2();
 int64_t minitest3();
 int64_t minitest4();
+int64_t minitest6();
 }
 int main() {
   // std::vector<int64_t> array1 = {1, 2, 3, 4, 5};
@@ -22,6 +23,7 @@ int main() {
   run_test(115, minitest2(), "minitest2");
   run_test(15, minitest3(), "minitest3");
   run_test(10, minitest4(), "minitest4");
+  run_test(9, minitest6(), "minitest6");
 
   std::cout << "\nPassed " << total_passed << " of " << total_tests
             << " tests\n";
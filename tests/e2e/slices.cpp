@@ -0,0 +1,43 @@
+#include <cstdint>
+#include <vector>
+#include "Util.h"
+
+// the layout of a returned int64[]
+struct Int64Slice {
+  int64_t* data;
+  int64_t length;
+};
+
+extern "C" {
+int64_t slice_sum(int64_t* data, int64_t length);
+void slice_fill(int64_t* data, int64_t length, int64_t first);
+int32_t slice_max(int32_t* data, int64_t length);
+Int64Slice slice_identity(int64_t* data, int64_t length);
+int64_t slice_of_array();
+int64_t slice_assign();
+int64_t slice_through_ref();
+}
+
+int main() {
+  std::vector<int64_t> v = {1, 2, 3, 4, 5, 6, 7};
+  run_test(28, slice_sum(v.data(), v.size()), "slice_sum");
+  run_test(0, slice_sum(v.data(), 0), "slice_sum_empty");
+  run_test(9, slice_sum(v.data() + 1, 3), "slice_sum_part");
+
+  slice_fill(v.data() + 2, 3, 100);
+  run_test(2, v[1], "slice_fill_before");
+  run_test(100, v[2], "slice_fill_first");
+  run_test(102, v[4], "slice_fill_last");
+  run_test(6, v[5], "slice_fill_after");
+
+  std::vector<int32_t> w = {4, -3, 17, 9};
+  run_test(17, slice_max(w.data(), w.size()), "slice_max");
+
+  Int64Slice s = slice_identity(v.data() + 1, 4);
+  run_test(true, s.data == v.data() + 1, "slice_identity_data");
+  run_test(4, s.length, "slice_identity_length");
+
+  run_test(23, slice_of_array(), "slice_of_array");
+  run_test(8, slice_assign(), "slice_assign");
+  run_test(5, slice_through_ref(), "slice_through_ref");
+}
@@ -0,0 +1,12 @@
+#include <cstdint>
+#include "Util.h"
+
+extern "C" {
+int64_t stress_expr(int64_t x);
+}
+
+int main() {
+  // every "x * 2 - x" group contributes x when precedence and associativity
+  // are right
+  run_test(int64_t{STRESS_EXPR_GROUPS} * 7, stress_expr(7), "stress_expr");
+}
@@ -0,0 +1,29 @@
+#include <cstdint>
+#include <cstring>
+#include "Util.h"
+
+// the layouts the compiler computes for structs.program
+struct alignas(32) Inner {
+  int64_t x;
+};
+struct Outer {
+  Inner b;
+  int64_t a;
+  int64_t c;
+};
+static_assert(sizeof(Outer) == 64, "reordered Outer has tail padding only");
+
+extern "C" Outer* structs_copy(Outer* o, Outer* ret);
+
+int main() {
+  Outer o{{3}, 1, 2};
+  // the copy must not write past the returned struct
+  alignas(32) Outer ret[2];
+  std::memset(ret, 0x55, sizeof(ret));
+  Outer* copy = structs_copy(&o, &ret[0]);
+
+  run_test(1, copy->a, "structs_copy a");
+  run_test(3, copy->b.x, "structs_copy b");
+  run_test(2, copy->c, "structs_copy c");
+  run_test(0x5555555555555555, ret[1].b.x, "structs_copy bounds");
+}
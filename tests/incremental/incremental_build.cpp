@@ -0,0 +1,69 @@
+// Edits a program between rebuilds, as --watch sees it: a changed function
+// is rebuilt on its own, and edits that do not compile are reported without
+// ending the process, after which the next good edit builds again.
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "../e2e/Util.h"
+#include "frontend/incremental_build.h"
+#include "frontend/parse/parser.h"
+
+namespace {
+const char* kAdd = R"(
+int64 add(int64 a, int64 b){
+  return a + b
+}
+)";
+
+void write(const std::string& path, const std::string& text) {
+  std::ofstream file(path, std::ios::trunc);
+  file << text;
+}
+
+// the second function of the program, with body
+std::string program(const std::string& body) {
+  return std::string(kAdd) + "\nint64 twice(int64 a){\n" + body + "\n}\n";
+}
+}  // namespace
+
+int main() {
+  std::filesystem::path dir =
+      std::filesystem::temp_directory_path() / "incremental_build_test";
+  std::filesystem::create_directories(dir);
+  std::string input = (dir / "edited.program").string();
+  std::string output = (dir / "edited.o").string();
+
+  // more than one thread, so errors also come from the parser's workers
+  frontend::ParseOptions options;
+  options.num_threads = 2;
+  frontend::IncrementalBuild build(options);
+  frontend::IncrementalBuild::Stats stats;
+
+  write(input, program("  return add(a, a)"));
+  run_test(true, build.rebuild(input, output, &stats), "first build");
+  run_test(size_t{2}, stats.rebuilt, "first build rebuilds every function");
+  run_test(true, std::filesystem::exists(output), "first build writes");
+
+  write(input, program("  return a + a"));
+  run_test(true, build.rebuild(input, output, &stats), "edited body");
+  run_test(size_t{1}, stats.rebuilt, "edited body rebuilds one function");
+
+  write(input, program("  return a +"));
+  run_test(false, build.rebuild(input, output, &stats), "syntax error");
+
+  write(input, program("  return thrice(a)"));
+  run_test(false, build.rebuild(input, output, &stats), "unknown function");
+
+  write(input, program("  return a + a") + "int64");
+  run_test(false, build.rebuild(input, output, &stats), "trailing text");
+
+  write(input, program("  return add(a, add(a, 0))"));
+  run_test(true, build.rebuild(input, output, &stats), "fixed body");
+  run_test(size_t{1}, stats.rebuilt, "fixed body rebuilds one function");
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}